@@ -13,7 +13,8 @@ REM variables and invokes the compiler with the necessary flags.
 REM
 REM INTERACTION:
 REM - Sets up the MSVC environment (vcvarsall.bat).
-REM - Compiles 'src/main.cpp'.
+REM - Compiles 'src/main.cpp' (the GUI), 'src/cli.cpp' (the command line tool) and
+REM   'src/thrilldigger.cpp' (the C library, thrilldigger.dll).
 REM - Links standard Windows libraries.
 REM - Cleans up temporary object files (.obj).
 REM
@@ -42,12 +43,21 @@ REM /SUBSYSTEM:WINDOWS      : Create a GUI application (no console window).
 REM user32.lib ...          : Libraries to link against (User interface, graphics, controls).
 cl /EHsc /O2 /std:c++17 /Fe:ThrillDiggerCalculator.exe /DNDEBUG /W4 src\main.cpp /link /SUBSYSTEM:WINDOWS user32.lib gdi32.lib comctl32.lib
 
+REM Same flags for the command line tool, but as a console program (/SUBSYSTEM:CONSOLE).
+cl /EHsc /O2 /std:c++17 /Fe:ThrillDiggerCLI.exe /DNDEBUG /W4 src\cli.cpp /link /SUBSYSTEM:CONSOLE
+
+REM The C library (see src\thrilldigger.h). /LD builds a DLL: thrilldigger.dll plus the import
+REM library thrilldigger.lib that C programs link against.
+cl /EHsc /O2 /std:c++17 /LD /Fe:thrilldigger.dll /DNDEBUG /W4 src\thrilldigger.cpp
+
 REM -------------------------------------------------------------------------------------------------
 REM CLEANUP
 REM -------------------------------------------------------------------------------------------------
-REM Delete the intermediate object file (main.obj) created during compilation.
-REM It is no longer needed after the .exe is created.
+REM Delete the intermediate object files (main.obj, cli.obj, thrilldigger.obj) created during compilation.
+REM They are no longer needed after the .exe files are created.
 del main.obj 2>nul
+del cli.obj 2>nul
+del thrilldigger.obj 2>nul
 
 echo.
 echo Build complete.
@@ -0,0 +1,180 @@
+/*
+=================================================================================================
+FILE: src/advisor.h
+
+DESCRIPTION:
+This file contains the stop-or-continue advisor. In Thrill Digger you can walk away with your
+rupees at any time; this engine estimates whether digging on is still worth it, and how many
+more digs are worth making before stopping.
+
+IMPORTANCE:
+Late in a game most safe cells are gone and rupoors (-10 each) make up a bigger share of what
+is left. At some point the next dig is expected to lose rupees, and the best move is to stop.
+
+INTERACTION:
+- Includes "sampler.h": one solve is reused for drawing every simulated board.
+- Includes "planner.h" for the rupee values of each outcome.
+- Uses its own `ThrillDiggerSolver` to re-solve the boards seen along the simulated games.
+- Used by the "Suggest" button in `src/main.cpp` and the `advise` command of `src/cli.cpp`.
+
+ALGORITHM OVERVIEW:
+1. Solve the board once and draw many hidden boards consistent with the clues.
+2. On each one, play the policy and record the rupees gained after 1, 2, 3... digs (a bomb
+   ends the game; the gain so far is kept, and so is the haul collected before this position).
+   The default policy is the one a player would follow: after every dig, the board (with the
+   new clue) is solved again and the safest cell of that solve is dug next. Solved boards are
+   cached by canonical board, so the many games that share a position solve it only once.
+   A caller may instead pass a fixed dig order, which is then played as it is.
+3. Average over the samples: meanGain[k] is the expected gain of "dig k more times, then stop".
+   The best k is the optimal stopping threshold; k = 0 means "stop now".
+=================================================================================================
+*/
+
+#pragma once
+#include "sampler.h"
+#include "planner.h"
+
+// Rupees already collected on `grid` (every revealed rupee, minus 10 per rupoor)
+inline int boardHaul(const std::array<CellContent, TOTAL_CELLS>& grid) {
+    int haul = 0;
+    for (CellContent c : grid) haul += rupeeValue(c);
+    return haul;
+}
+
+// What the advisor found.
+struct StopAdvice {
+    int haul = 0;                 // Rupees collected so far
+    long long samples = 0;        // Simulated boards
+    std::vector<int> digOrder;    // Fixed order: the order played. Adaptive policy: only the first dig
+                                  // (the later ones depend on what each dig turns up)
+    std::vector<double> meanGain; // meanGain[k] = expected gain of digging k more times, then stopping
+    int bestStop = 0;             // Optimal number of further digs (0 = stop now)
+    double bestGain = 0.0;        // meanGain[bestStop]
+    double bestGainStdErr = 0.0;  // Standard error of bestGain (simulation noise)
+    double bombRisk = 0.0;        // Chance of hitting a bomb within bestStop digs
+
+    bool shouldContinue() const { return bestStop > 0; }
+    double nextDigGain() const { return meanGain.size() > 1 ? meanGain[1] : 0.0; }
+};
+
+class StopAdvisor {
+public:
+    long long maxSamples = 20000; // Simulated boards per call (fewer if the time budget runs out)
+    uint64_t seed = 0xAD71CEull;
+    size_t maxCacheEntries = 200000; // Safest-cell cache is cleared when it grows past this
+
+    /*
+     * advise
+     * ------
+     * Simulates the policy for at most `budgetMs` milliseconds. `order` is a fixed dig order
+     * to play; if empty, every simulated game digs the safest cell of its current board.
+     */
+    StopAdvice advise(const std::array<CellContent, TOTAL_CELLS>& grid, int budgetMs,
+                      std::vector<int> order = {})
+    {
+        StopAdvice advice;
+        advice.haul = boardHaul(grid);
+        if (!sampler.prepare(grid)) return advice;
+
+        bool adaptive = order.empty();
+        int len = 0;
+        for (CellContent c : grid) {
+            if (c == CellContent::Undug) len++;
+        }
+        if (adaptive) {
+            int first = safestCell(grid);
+            if (first >= 0) advice.digOrder.push_back(first);
+        } else {
+            advice.digOrder = order;
+            len = (int)order.size();
+        }
+
+        // Per number of digs k: sum and sum of squares of the gain, and bomb count
+        std::vector<double> sum(len + 1, 0.0), sumSq(len + 1, 0.0);
+        std::vector<long long> bombs(len + 1, 0);
+
+        std::mt19937_64 rng(seed);
+        std::array<CellContent, TOTAL_CELLS> hidden;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budgetMs);
+        long long n = 0;
+        while (n < maxSamples) {
+            if ((n & 255) == 0 && n > 0 && std::chrono::steady_clock::now() > deadline) break;
+            if (!sampler.sample(rng, hidden)) break;
+            n++;
+
+            int safeLeft = 0;
+            for (int i = 0; i < TOTAL_CELLS; i++) {
+                bool inPolicy = adaptive ? grid[i] == CellContent::Undug
+                                         : std::find(order.begin(), order.end(), i) != order.end();
+                if (inPolicy && !isRevealedBad(hidden[i])) safeLeft++;
+            }
+
+            // Walk the policy; once the game is over the gain stays frozen
+            std::array<CellContent, TOTAL_CELLS> board = grid; // What the player sees in this game
+            double gain = 0.0;
+            bool bombed = false;
+            for (int k = 1; k <= len; k++) {
+                if (!bombed && safeLeft > 0) {
+                    int cell = adaptive ? safestCell(board) : order[k - 1];
+                    CellContent c = hidden[cell];
+                    board[cell] = c;
+                    gain += rupeeValue(c);
+                    if (c == CellContent::Bomb) bombed = true;
+                    else if (!isRevealedBad(c)) safeLeft--;
+                }
+                sum[k] += gain;
+                sumSq[k] += gain * gain;
+                if (bombed) bombs[k]++;
+            }
+        }
+
+        advice.samples = n;
+        if (n == 0) return advice;
+        advice.meanGain.assign(len + 1, 0.0);
+        for (int k = 1; k <= len; k++) {
+            advice.meanGain[k] = sum[k] / n;
+            if (advice.meanGain[k] > advice.bestGain) {
+                advice.bestGain = advice.meanGain[k];
+                advice.bestStop = k;
+            }
+        }
+        int k = advice.bestStop;
+        if (k > 0) {
+            double var = std::max(0.0, sumSq[k] / n - advice.bestGain * advice.bestGain);
+            advice.bestGainStdErr = std::sqrt(var / n);
+            advice.bombRisk = static_cast<double>(bombs[k]) / n;
+        }
+        return advice;
+    }
+
+private:
+    PosteriorSampler sampler;
+    ThrillDiggerSolver solver;
+    // Canonical board -> its safest undug cell (in the canonical orientation)
+    std::unordered_map<PackedBoard, int, PackedBoardHash> safestCache;
+
+    /*
+     * safestCell
+     * ----------
+     * The undug cell of `grid` with the lowest bad probability (lowest index on ties).
+     * The canonical board is solved, so mirror images agree on the pick.
+     */
+    int safestCell(const std::array<CellContent, TOTAL_CELLS>& grid) {
+        int sym = 0;
+        PackedBoard key = canonicalBoard(grid, &sym);
+        auto it = safestCache.find(key);
+        if (it != safestCache.end()) return it->second < 0 ? -1 : symmetryCell(it->second, sym);
+
+        solver.reset();
+        solver.grid = unpackBoard(key);
+        solver.solve();
+        int best = -1;
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            if (solver.grid[i] != CellContent::Undug) continue;
+            if (best < 0 || solver.badProb[i] < solver.badProb[best]) best = i;
+        }
+        if (safestCache.size() >= maxCacheEntries) safestCache.clear();
+        safestCache.emplace(key, best);
+        return best < 0 ? -1 : symmetryCell(best, sym);
+    }
+};
@@ -0,0 +1,118 @@
+/*
+=================================================================================================
+FILE: src/alloc_stats.h
+
+DESCRIPTION:
+This file counts memory allocations made by the solver: how many, how many bytes, and in which
+stage of `solve()` they happened.
+
+IMPORTANCE:
+Every heap allocation costs time (often more than the arithmetic around it) and, with several
+threads, contention on the allocator. The goal for the hot path is "zero allocations once warmed
+up", and a goal is only kept if it is measured: these counters turn it into a number that a
+benchmark can print and check.
+
+INTERACTION:
+- `CountingResource` is a `std::pmr::memory_resource`: plug it in as the solver's `memory`
+  (solver.h) and it sees every allocation solve() makes for its working data.
+- Allocations that don't go through a memory resource (std::vector with the default allocator,
+  e.g. the result vectors the solver keeps between solves) can only be seen by replacing the
+  global operator new. A program that does so (the CLI does) reports them through
+  `globalAllocCounter`.
+- `StageAllocProfiler` is a `SolveStageObserver`: it splits both counts by solve() stage.
+- Used by the --alloc option of the `stress bench` command of `src/cli.cpp`.
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include <memory_resource>
+
+// A number of allocations and their total size
+struct AllocTotals {
+    long long count = 0;
+    long long bytes = 0;
+};
+
+/*
+ * CountingResource
+ * ----------------
+ * Passes every request on to an upstream resource (default: new/delete) and counts it.
+ * Not thread-safe: use one per solver.
+ */
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream(upstream) {}
+
+    AllocTotals total;       // Every allocation so far
+    long long liveBytes = 0; // Currently allocated
+    long long peakBytes = 0; // Largest liveBytes seen
+
+private:
+    std::pmr::memory_resource* upstream;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* p = upstream->allocate(bytes, alignment);
+        total.count++;
+        total.bytes += static_cast<long long>(bytes);
+        liveBytes += static_cast<long long>(bytes);
+        peakBytes = std::max(peakBytes, liveBytes);
+        return p;
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        liveBytes -= static_cast<long long>(bytes);
+        upstream->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+// Set by programs that replace the global operator new: returns the calling thread's totals.
+inline AllocTotals (*globalAllocCounter)() = nullptr;
+
+/*
+ * StageAllocProfiler
+ * ------------------
+ * Adds up allocations per solve() stage: those through `resource` (attach it as the solver's
+ * `memory`) and, if available, every operator new call of the thread. Attach with
+ * `solver.stageObserver = &profiler`.
+ */
+class StageAllocProfiler : public SolveStageObserver {
+public:
+    CountingResource resource;
+    AllocTotals viaResource[NUM_SOLVE_STAGES];
+    AllocTotals viaNew[NUM_SOLVE_STAGES];
+    long long solves = 0;
+
+    explicit StageAllocProfiler(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : resource(upstream) {}
+
+    void onStage(SolveStage stage) override {
+        AllocTotals r = resource.total;
+        AllocTotals g = globalAllocCounter ? globalAllocCounter() : AllocTotals();
+        if (current >= 0) {
+            viaResource[current].count += r.count - lastResource.count;
+            viaResource[current].bytes += r.bytes - lastResource.bytes;
+            viaNew[current].count += g.count - lastNew.count;
+            viaNew[current].bytes += g.bytes - lastNew.bytes;
+        }
+        lastResource = r;
+        lastNew = g;
+        if (stage == SolveStage::Done) {
+            current = -1;
+            solves++;
+        } else {
+            current = static_cast<int>(stage);
+        }
+    }
+
+    void clear() {
+        for (int s = 0; s < NUM_SOLVE_STAGES; s++) viaResource[s] = viaNew[s] = AllocTotals();
+        solves = 0;
+        current = -1;
+    }
+
+private:
+    int current = -1;
+    AllocTotals lastResource, lastNew;
+};
@@ -0,0 +1,386 @@
+/*
+=================================================================================================
+FILE: src/board_io.h
+
+DESCRIPTION:
+This file reads and writes boards and probabilities as text in bulk: a parser for files with
+one 40-character board per line, and a writer that prints probabilities with a fixed number
+of decimals. Both are built for files with hundreds of millions of lines.
+
+IMPORTANCE:
+A typical board solves in a few microseconds. Reading it with getline() into a std::string,
+checking it character by character and printing 40 numbers with printf("%.4f") costs about as
+much, so a batch run would spend half its time on text. Here the input is read in large
+blocks (or mapped straight from the file), a line is classified 16 characters at a time with
+SSE2 instructions, and numbers are printed from a table of digit pairs into one big output
+buffer. Text handling then costs a small fraction of the solving time.
+
+INTERACTION:
+- Includes "solver.h" (CellContent, PackedBoard, cellContentFromChar) and "mapped_file.h".
+- Used by the `solve` command of `src/cli.cpp`.
+
+INPUT FORMAT:
+One board per line, the same text as everywhere else (see boardFromText in solver.h): 40
+cells of .GBRSYPX ('?' = '.', either case), spaces, tabs and '/' allowed between cells, "\n"
+or "\r\n" line ends. Empty lines and lines starting with '#' are skipped. A line that is not
+a board becomes INVALID_BOARD, so outputs stay aligned with the input lines.
+
+HOW IT WORKS:
+1. Fast path: the line is exactly 40 characters. Three SSE2 loads (16 + 16 + 8 bytes) are
+   compared against '.' and '?', folded to lower case (OR 0x20) and compared against each of
+   the seven cell letters, 16 characters at once; each match contributes its CellContent code,
+   and a byte that matched nothing makes the line invalid. The codes are then packed 3 bits
+   each into a PackedBoard, also in SSE2 registers: pairs of cells, then 4, then 8 (24 bits),
+   and the five groups of 8 are shifted into place. (Without x86-64: a 256-entry table.)
+2. Anything else (separators, a bad character) goes through the plain one-character-at-a-time
+   rules.
+3. Output: each probability is rounded to an integer number of 10^-decimals units, and its
+   digits are copied two at a time from a 200-byte table into a 1 MiB buffer, which is
+   written out when full.
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include "mapped_file.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// SSE2 is part of every x86-64 CPU (the 64-bit lane extracts below need x86-64)
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TD_BOARD_IO_SSE2 1
+#endif
+
+// Marks a line that is not a board (lo bit 63 is never used by a real PackedBoard)
+constexpr PackedBoard INVALID_BOARD = {uint64_t(1) << 63, 0};
+
+// =================================================================================================
+// PARSING
+// =================================================================================================
+
+inline PackedBoard packCodes(const uint8_t* codes) {
+    PackedBoard b;
+    for (int i = 0; i < PACK_LO_CELLS; i++) b.lo |= uint64_t(codes[i]) << (i * PACK_BITS);
+    for (int i = PACK_LO_CELLS; i < TOTAL_CELLS; i++) b.hi |= uint64_t(codes[i]) << ((i - PACK_LO_CELLS) * PACK_BITS);
+    return b;
+}
+
+#ifdef TD_BOARD_IO_SSE2
+// 16 characters to CellContent codes; `valid` gets 0xFF for every cell character
+inline __m128i classify16(__m128i raw, __m128i& valid) {
+    // Undug ('.', '?') is code 0, so those only mark validity. They are compared before
+    // folding, which would also turn control characters 0x0E and 0x1F into '.' and '?'.
+    valid = _mm_or_si128(_mm_cmpeq_epi8(raw, _mm_set1_epi8('.')), _mm_cmpeq_epi8(raw, _mm_set1_epi8('?')));
+    __m128i chars = _mm_or_si128(raw, _mm_set1_epi8(0x20)); // Letters to lower case
+    __m128i code = _mm_setzero_si128();
+#define TD_CELL_LETTER(letter, value)                                            \
+    {                                                                            \
+        __m128i eq = _mm_cmpeq_epi8(chars, _mm_set1_epi8(letter));              \
+        valid = _mm_or_si128(valid, eq);                                         \
+        code = _mm_or_si128(code, _mm_and_si128(eq, _mm_set1_epi8(value)));      \
+    }
+    TD_CELL_LETTER('g', 1) TD_CELL_LETTER('b', 2) TD_CELL_LETTER('r', 3) TD_CELL_LETTER('s', 4)
+    TD_CELL_LETTER('y', 5) TD_CELL_LETTER('p', 6) TD_CELL_LETTER('x', 7)
+#undef TD_CELL_LETTER
+    return code;
+}
+
+// 16 codes (one per byte) to two 24-bit groups of 8 cells, one per 64-bit lane
+inline __m128i packGroups(__m128i codes) {
+    // Byte pairs -> 6 bits per 16-bit lane: even | odd << 3
+    __m128i pairs = _mm_or_si128(_mm_and_si128(codes, _mm_set1_epi16(0x00FF)),
+                                 _mm_and_si128(_mm_srli_epi16(codes, 5), _mm_set1_epi16(0x0038)));
+    // Lane pairs -> 12 bits per 32-bit lane: low + high * 64
+    __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00400001));
+    // 32-bit pairs -> 24 bits per 64-bit lane
+    return _mm_and_si128(_mm_or_si128(quads, _mm_srli_epi64(quads, 20)), _mm_set1_epi64x(0xFFFFFF));
+}
+#endif
+
+/*
+ * parseCells
+ * ----------
+ * Turns exactly TOTAL_CELLS cell characters (no separators) into a PackedBoard.
+ * Returns false if any character is not a cell character.
+ */
+inline bool parseCells(const char* text, PackedBoard& out) {
+#ifdef TD_BOARD_IO_SSE2
+    __m128i v0, v1, v2;
+    __m128i c0 = classify16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text)), v0);
+    __m128i c1 = classify16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + 16)), v1);
+    __m128i c2 = classify16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(text + 32)), v2);
+    // Only the low 8 bytes of the last load are cells
+    if (_mm_movemask_epi8(_mm_and_si128(v0, v1)) != 0xFFFF || (_mm_movemask_epi8(v2) & 0xFF) != 0xFF) return false;
+    // Groups of 8 cells (24 bits): g[k] holds cells 8k..8k+7
+    __m128i p0 = packGroups(c0), p1 = packGroups(c1), p2 = packGroups(c2);
+    uint64_t g0 = static_cast<uint64_t>(_mm_cvtsi128_si64(p0));
+    uint64_t g1 = static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(p0, p0)));
+    uint64_t g2 = static_cast<uint64_t>(_mm_cvtsi128_si64(p1));
+    uint64_t g3 = static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(p1, p1)));
+    uint64_t g4 = static_cast<uint64_t>(_mm_cvtsi128_si64(p2));
+    // The 120-bit number g0 | g1 << 24 | ... | g4 << 96, split after bit 63 (PACK_LO_CELLS * 3)
+    out.lo = (g0 | (g1 << 24) | (g2 << 48)) & ~(uint64_t(1) << 63);
+    out.hi = (g2 >> 15) | (g3 << 9) | (g4 << 33);
+    return true;
+#else
+    // 256-entry table: CellContent code, or 0xFF for "not a cell"
+    static const struct Table {
+        uint8_t code[256];
+        Table() {
+            for (int ch = 0; ch < 256; ch++) {
+                CellContent c;
+                code[ch] = cellContentFromChar(static_cast<char>(ch), c) ? static_cast<uint8_t>(c) : 0xFF;
+            }
+        }
+    } table;
+    uint8_t codes[TOTAL_CELLS];
+    uint8_t bad = 0;
+    for (int i = 0; i < TOTAL_CELLS; i++) {
+        codes[i] = table.code[static_cast<unsigned char>(text[i])];
+        bad |= codes[i] & 0x80;
+    }
+    if (bad) return false;
+    out = packCodes(codes);
+    return true;
+#endif
+}
+
+/*
+ * BoardLineParser
+ * ---------------
+ * Parses text a block at a time. The caller hands over whatever it has read; the parser takes
+ * the complete lines and says how many bytes it used, so the caller keeps the rest (a line cut
+ * at the end of the block) for the next call.
+ */
+class BoardLineParser {
+public:
+    long long lines = 0;          // Lines seen (including skipped ones)
+    long long invalid = 0;        // Lines that were not a board
+    long long firstInvalidLine = 0; // 1-based, 0 = none
+
+    /*
+     * parse
+     * -----
+     * Appends the boards of the complete lines of text[0..len) to `out`, at most `maxBoards`
+     * of them. With `final`, a last line without "\n" counts as complete.
+     * Returns the number of bytes used.
+     */
+    size_t parse(const char* text, size_t len, bool final, std::vector<PackedBoard>& out, size_t maxBoards) {
+        size_t pos = 0;
+        PackedBoard board;
+        while (pos < len && out.size() < maxBoards) {
+            // Fast path: 40 cell characters, then "\n" or "\r\n"
+            if (pos + TOTAL_CELLS < len) {
+                const char* line = text + pos;
+                char end = line[TOTAL_CELLS];
+                size_t next = 0;
+                if (end == '\n') next = pos + TOTAL_CELLS + 1;
+                else if (end == '\r' && pos + TOTAL_CELLS + 1 < len && line[TOTAL_CELLS + 1] == '\n') next = pos + TOTAL_CELLS + 2;
+                if (next && parseCells(line, board)) {
+                    out.push_back(board);
+                    lines++;
+                    pos = next;
+                    continue;
+                }
+            }
+            // General path: find the end of the line first
+            const void* nl = std::memchr(text + pos, '\n', len - pos);
+            if (!nl && !final) break; // Incomplete line: wait for more text
+            size_t lineEnd = nl ? static_cast<size_t>(static_cast<const char*>(nl) - text) : len;
+            parseSlow(text + pos, lineEnd - pos, out);
+            pos = nl ? lineEnd + 1 : len;
+        }
+        return pos;
+    }
+
+private:
+    // The full rules of boardFromText, plus empty and comment lines
+    void parseSlow(const char* line, size_t n, std::vector<PackedBoard>& out) {
+        lines++;
+        if (n > 0 && line[n - 1] == '\r') n--;
+        size_t first = 0;
+        while (first < n && (line[first] == ' ' || line[first] == '\t')) first++;
+        if (first == n || line[first] == '#') return;
+        uint8_t codes[TOTAL_CELLS];
+        int cells = 0;
+        for (size_t i = first; i < n; i++) {
+            char ch = line[i];
+            if (ch == ' ' || ch == '/' || ch == '\t') continue;
+            CellContent c;
+            if (cells >= TOTAL_CELLS || !cellContentFromChar(ch, c)) { cells = -1; break; }
+            codes[cells++] = static_cast<uint8_t>(c);
+        }
+        if (cells == TOTAL_CELLS) {
+            out.push_back(packCodes(codes));
+        } else {
+            out.push_back(INVALID_BOARD);
+            invalid++;
+            if (!firstInvalidLine) firstInvalidLine = lines;
+        }
+    }
+};
+
+/*
+ * BoardTextSource
+ * ---------------
+ * Feeds a BoardLineParser from a file or stdin. A regular file is mapped into memory and
+ * parsed in place; anything else (stdin, a pipe) is read in 4 MiB blocks.
+ */
+class BoardTextSource {
+public:
+    // path "-" = stdin. False if the file can't be opened.
+    bool open(const std::string& path) {
+        if (path != "-" && mapped.open(path)) return true; // (Fails on empty files: read those below)
+        in = path == "-" ? stdin : std::fopen(path.c_str(), "rb");
+        if (!in) return false;
+        ownsFile = in != stdin;
+        buffer.resize(BLOCK_BYTES);
+        return true;
+    }
+
+    ~BoardTextSource() {
+        if (ownsFile) std::fclose(in);
+    }
+
+    // Appends up to `maxBoards` boards; false once the input is exhausted and nothing was added
+    bool next(BoardLineParser& parser, std::vector<PackedBoard>& out, size_t maxBoards) {
+        size_t before = out.size();
+        if (mapped.isOpen()) {
+            const char* text = reinterpret_cast<const char*>(mapped.data());
+            mappedPos += parser.parse(text + mappedPos, mapped.size() - mappedPos, true, out, maxBoards);
+            return out.size() > before;
+        }
+        while (out.size() < maxBoards) {
+            if (begin == end && eof) break;
+            size_t used = parser.parse(buffer.data() + begin, end - begin, eof, out, maxBoards);
+            begin += used;
+            if (out.size() >= maxBoards || (eof && begin == end)) break;
+            // Need more text: keep the unfinished line, fill the rest of the buffer
+            std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+            if (end == buffer.size()) buffer.resize(buffer.size() * 2); // A very long line
+            size_t got = std::fread(buffer.data() + end, 1, buffer.size() - end, in);
+            end += got;
+            if (got == 0) eof = true;
+        }
+        return out.size() > before;
+    }
+
+private:
+    static constexpr size_t BLOCK_BYTES = size_t(4) << 20;
+    MappedFile mapped;
+    size_t mappedPos = 0;
+    FILE* in = nullptr;
+    bool ownsFile = false;
+    std::vector<char> buffer;
+    size_t begin = 0, end = 0;
+    bool eof = false;
+};
+
+// =================================================================================================
+// WRITING
+// =================================================================================================
+
+/*
+ * ProbabilityWriter
+ * -----------------
+ * Buffered text output with fast number formatting. Probabilities are printed as fixed-point
+ * numbers ("0.4000", "1.0000") with `decimals` digits (1-9), rounded exactly like printf("%.4f")
+ * (to nearest, halves to even: 0.40625 prints as 0.4062).
+ */
+class ProbabilityWriter {
+public:
+    explicit ProbabilityWriter(FILE* out, int decimals = 4) : out(out), buffer(BUFFER_BYTES) {
+        setDecimals(decimals);
+    }
+    ~ProbabilityWriter() { flush(); }
+    ProbabilityWriter(const ProbabilityWriter&) = delete;
+    ProbabilityWriter& operator=(const ProbabilityWriter&) = delete;
+
+    void setDecimals(int d) {
+        decimals = std::max(1, std::min(9, d));
+        unit = 1;
+        for (int i = 0; i < decimals; i++) unit *= 10;
+    }
+
+    // Room for one more line of any length this class writes
+    void reserveLine() {
+        if (used + MAX_LINE_BYTES > buffer.size()) flush();
+    }
+
+    void probability(double p) {
+        if (!(p > 0.0)) p = 0.0; // Also NaN
+        // Round half to even on the exact product, like printf: fma gives the rounding error of
+        // x, which decides the cases where x itself lands exactly on a half
+        double u = static_cast<double>(unit);
+        double x = p * u;
+        double whole = std::floor(x);
+        double frac = x - whole;
+        uint64_t v = static_cast<uint64_t>(whole);
+        if (frac > 0.5 || (frac == 0.5 && [&] { double err = std::fma(p, u, -x); return err > 0.0 || (err == 0.0 && (v & 1)); }())) v++;
+        if (v > unit) v = unit;
+        char* s = buffer.data() + used;
+        *s++ = v == unit ? '1' : '0';
+        *s++ = '.';
+        writeDigits(s, v == unit ? 0 : v, decimals);
+        used += static_cast<size_t>(2 + decimals);
+    }
+
+    void integer(uint64_t v) {
+        char tmp[20];
+        int n = 0;
+        do {
+            tmp[n++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v);
+        while (n) buffer[used++] = tmp[--n];
+    }
+
+    void text(const char* s, size_t n) {
+        std::memcpy(buffer.data() + used, s, n);
+        used += n;
+    }
+    void character(char c) { buffer[used++] = c; }
+
+    // Writes the buffer out; false if the output failed (disk full, closed pipe...)
+    bool flush() {
+        if (used && std::fwrite(buffer.data(), 1, used, out) != used) failed = true;
+        used = 0;
+        return !failed;
+    }
+
+    bool ok() const { return !failed; }
+
+private:
+    static constexpr size_t BUFFER_BYTES = size_t(1) << 20;
+    static constexpr size_t MAX_LINE_BYTES = 1024; // 40 * (11 + 1) + board + ways, with room to spare
+
+    FILE* out;
+    std::vector<char> buffer;
+    size_t used = 0;
+    int decimals = 4;
+    uint64_t unit = 10000;
+    bool failed = false;
+
+    // Exactly `width` digits of v (with leading zeros), two at a time from a table
+    static void writeDigits(char* s, uint64_t v, int width) {
+        static const char PAIRS[201] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+        int i = width;
+        while (i >= 2) {
+            uint64_t two = v % 100;
+            v /= 100;
+            s[i - 2] = PAIRS[two * 2];
+            s[i - 1] = PAIRS[two * 2 + 1];
+            i -= 2;
+        }
+        if (i == 1) s[0] = static_cast<char>('0' + v % 10);
+    }
+};
@@ -0,0 +1,194 @@
+/*
+=================================================================================================
+FILE: src/boardgen.h
+
+DESCRIPTION:
+This file generates random Expert boards (8 bombs + 8 rupoors placed uniformly at random, every
+other cell showing the rupee that matches its bad neighbors), very fast and reproducibly.
+
+IMPORTANCE:
+Simulations play millions of games to compare strategies. Board generation must never be the
+slow part, and a given (seed, game number) must always produce the same board so that runs can
+be split across threads or machines and still give identical results.
+
+INTERACTION:
+- Includes "solver.h" for the board dimensions and CellContent.
+- Used by the simulation commands of `src/cli.cpp`.
+
+HOW IT WORKS:
+1. Random numbers come from a counter-based generator: draw i of game g is a hash of
+   (seed, g, i). There is no state to carry around, so any game can be generated on its own.
+2. The board is a 64-bit "bitboard": bit (row * 8 + col) is one cell. With 8 columns, each row
+   is exactly one byte.
+3. 16 distinct cells are drawn with a partial Fisher-Yates shuffle; the first 8 are bombs.
+4. Bad neighbor counts for all 40 cells at once: shift the bad-cell bitboard in the 8
+   directions, then add the 8 shifted boards with bit-sliced adders (each bit of the count is
+   its own bitboard). The rupee colours are simple logic on those count bits.
+Apart from the 16 shuffle steps, nothing loops over cells.
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include <cstring>
+
+static_assert(COLS == 8 && ROWS * COLS <= 64, "boardgen.h assumes one byte per row");
+
+// =================================================================================================
+// COUNTER-BASED RANDOM NUMBERS
+// =================================================================================================
+
+// SplitMix64 finalizer: a fast bijective 64-bit mixer
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/*
+ * CounterRng
+ * ----------
+ * Random stream of one game: value(i) = mix64(stream + i * golden ratio), where `stream`
+ * is itself a hash of (seed, game index). Same inputs, same numbers, on any thread.
+ */
+struct CounterRng {
+    uint64_t stream;
+    uint64_t counter = 0;
+
+    CounterRng(uint64_t seed, uint64_t game) : stream(mix64(mix64(seed) ^ (game * 0xD1B54A32D192ED03ull))) {}
+
+    uint64_t next() { return mix64(stream + (++counter) * 0x9E3779B97F4A7C15ull); }
+};
+
+// =================================================================================================
+// BITBOARDS
+// =================================================================================================
+
+constexpr uint64_t BB_BOARD = (uint64_t(1) << TOTAL_CELLS) - 1; // The 40 real cells
+constexpr uint64_t BB_COL_FIRST = 0x0101010101ull;                // Column 1 of every row
+constexpr uint64_t BB_COL_LAST  = 0x8080808080ull;                // Column 8 of every row
+
+// A complete hidden board, one bitboard per kind of cell
+struct BitBoard {
+    uint64_t bombs = 0, rupoors = 0;
+    uint64_t green = 0, blue = 0, red = 0, silver = 0, gold = 0;
+
+    uint64_t bad() const { return bombs | rupoors; }
+
+    // Expands to one CellContent per cell (this one does loop over cells: it is for output)
+    std::array<CellContent, TOTAL_CELLS> toGrid() const {
+        std::array<CellContent, TOTAL_CELLS> grid;
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            uint64_t bit = uint64_t(1) << i;
+            grid[i] = (bombs & bit)   ? CellContent::Bomb
+                    : (rupoors & bit) ? CellContent::Rupoor
+                    : (green & bit)   ? CellContent::Green
+                    : (blue & bit)    ? CellContent::Blue
+                    : (red & bit)     ? CellContent::Red
+                    : (silver & bit)  ? CellContent::Silver
+                    :                   CellContent::Gold;
+        }
+        return grid;
+    }
+};
+
+// Full adder on bitboards: adds three 1-bit numbers per cell
+inline void bitFullAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t& sum, uint64_t& carry) {
+    uint64_t ab = a ^ b;
+    sum = ab ^ c;
+    carry = (a & b) | (ab & c);
+}
+
+/*
+ * colourBoard
+ * -----------
+ * Fills in the rupee bitboards of `b` from its bombs and rupoors.
+ */
+inline void colourBoard(BitBoard& b) {
+    uint64_t bad = b.bad();
+
+    // The 8 neighbor directions. Masks stop bits from wrapping into the next/previous row.
+    // (BB_BOARD also drops the bit pushed past the last cell, so it can't come back with >> 8.)
+    uint64_t west = (bad << 1) & ~BB_COL_FIRST & BB_BOARD; // Bad cell at col c counts for col c+1
+    uint64_t east = (bad >> 1) & ~BB_COL_LAST;  // ...and for col c-1
+    uint64_t n0 = west, n1 = east;
+    uint64_t n2 = bad << 8,  n3 = bad >> 8;     // Rows below / above
+    uint64_t n4 = west << 8, n5 = west >> 8;    // Diagonals
+    uint64_t n6 = east << 8, n7 = east >> 8;
+
+    // Bit-sliced addition of the 8 one-bit boards into a 4-bit count (c3 c2 c1 c0) per cell
+    uint64_t s1, k1, s2, k2, s3, k3, c0, k4;
+    bitFullAdd(n0, n1, n2, s1, k1);
+    bitFullAdd(n3, n4, n5, s2, k2);
+    s3 = n6 ^ n7;                     // Half adder
+    k3 = n6 & n7;
+    bitFullAdd(s1, s2, s3, c0, k4);   // Bit 0; k1..k4 all carry weight 2
+    uint64_t t1, d1;
+    bitFullAdd(k1, k2, k3, t1, d1);
+    uint64_t c1 = t1 ^ k4;            // Bit 1
+    uint64_t d2 = t1 & k4;            // d1, d2 carry weight 4
+    uint64_t c2 = d1 ^ d2;            // Bit 2
+    uint64_t c3 = d1 & d2;            // Bit 3 (only when all 8 neighbors are bad)
+
+    // Counts -> colours: 0 Green, 1-2 Blue, 3-4 Red, 5-6 Silver, 7-8 Gold
+    uint64_t safe = ~bad & BB_BOARD;
+    b.green  = safe & ~(c0 | c1 | c2 | c3);
+    b.blue   = safe & ~c3 & ~c2 & (c0 ^ c1);
+    b.red    = safe & ~c3 & ((~c2 & c1 & c0) | (c2 & ~c1 & ~c0));
+    b.silver = safe & ~c3 & c2 & (c0 ^ c1);
+    b.gold   = safe & ((c2 & c1 & c0) | c3);
+}
+
+/*
+ * boundedDraw
+ * -----------
+ * Maps 32 random bits to 0..range-1 without bias (Lemire's multiply-shift method).
+ * Only about 1 in 100 million draws lands in the biased zone and needs a fresh number.
+ */
+inline uint32_t boundedDraw(uint32_t x, uint32_t range, CounterRng& rng) {
+    uint64_t m = uint64_t(x) * range;
+    if (static_cast<uint32_t>(m) < range) {
+        uint32_t threshold = (0u - range) % range;
+        while (static_cast<uint32_t>(m) < threshold) m = uint64_t(static_cast<uint32_t>(rng.next())) * range;
+    }
+    return static_cast<uint32_t>(m >> 32);
+}
+
+// The cell indices 0..39, copied as the starting point of every shuffle
+struct CellIndexList {
+    uint8_t cells[TOTAL_CELLS];
+    constexpr CellIndexList() : cells() {
+        for (int i = 0; i < TOTAL_CELLS; i++) cells[i] = static_cast<uint8_t>(i);
+    }
+};
+constexpr CellIndexList CELL_INDEX_LIST;
+
+/*
+ * generateBoard
+ * -------------
+ * Board number `game` of the stream `seed`. Bomb and rupoor cells are uniformly random.
+ * A partial Fisher-Yates shuffle picks 16 distinct cells: the first 8 are bombs.
+ */
+inline BitBoard generateBoard(uint64_t seed, uint64_t game) {
+    static_assert(TOTAL_BAD % 2 == 0, "two draws per random number");
+    CounterRng rng(seed, game);
+    uint8_t cells[TOTAL_CELLS];
+    std::memcpy(cells, CELL_INDEX_LIST.cells, sizeof(cells));
+
+    BitBoard b;
+    for (int i = 0; i < TOTAL_BAD; i += 2) {
+        uint64_t r = rng.next(); // Two 32-bit draws
+        for (int half = 0; half < 2; half++) {
+            int k = i + half;
+            int j = k + (int)boundedDraw(static_cast<uint32_t>(r >> (32 * half)), TOTAL_CELLS - k, rng);
+            uint8_t cell = cells[j];
+            cells[j] = cells[k];
+            cells[k] = cell;
+            uint64_t bit = uint64_t(1) << cell;
+            if (k < TOTAL_BOMBS) b.bombs |= bit;
+            else                 b.rupoors |= bit;
+        }
+    }
+    colourBoard(b);
+    return b;
+}
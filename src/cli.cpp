@@ -0,0 +1,1437 @@
+/*
+=================================================================================================
+FILE: src/cli.cpp
+
+DESCRIPTION:
+This file is the entry point of `ThrillDiggerCLI`, the command line companion of the GUI.
+It exposes the engines that are too slow or too technical for a button click (offline policy
+solving, simulations, benchmarks...) as sub-commands:
+
+    ThrillDiggerCLI <command> [options]
+
+IMPORTANCE:
+The GUI is for playing. The CLI is for analysis: long-running jobs, scripting, and running on
+machines without a desktop (it has no Windows dependency and builds on Linux too).
+
+INTERACTION:
+- Includes the engine headers from src/ (solver, policy...).
+- Boards are passed as 40-character strings, row by row (see `boardFromText` in solver.h),
+  e.g. "B......./......../......../......../........" for a Blue rupee in the top-left corner.
+
+ADDING A COMMAND:
+Write a `static int cmdSomething(const CommandLine& cl)` function and add it to `COMMANDS`.
+=================================================================================================
+*/
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include "solver.h"
+#include "policy.h"
+#include "advisor.h"
+#include "boardgen.h"
+#include "tournament.h"
+#include "shard.h"
+#include "session_log.h"
+#include "stress.h"
+#include "perf_counters.h"
+#include "alloc_stats.h"
+#include "exact_count.h"
+#include "daemon.h"
+#include "loadgen.h"
+#include "live_publish.h"
+#include "board_io.h"
+
+// =================================================================================================
+// ALLOCATION COUNTING
+// =================================================================================================
+
+// The CLI replaces the global operator new so that `stress bench --alloc` sees every heap
+// allocation, including those that don't go through the solver's memory resource
+// (see alloc_stats.h).
+// Counting is one thread-local addition per allocation.
+static thread_local AllocTotals t_newTotals;
+
+static AllocTotals countedNew() { return t_newTotals; }
+
+void* operator new(std::size_t bytes) {
+    t_newTotals.count++;
+    t_newTotals.bytes += static_cast<long long>(bytes);
+    if (void* p = std::malloc(bytes ? bytes : 1)) return p;
+    throw std::bad_alloc();
+}
+// GCC sees delete's free() inlined next to a pointer from operator new and warns about a
+// mismatch it can't tell is intended: this operator new does get its memory from malloc
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+// Over-aligned requests (std::pmr's new/delete resource uses these)
+void* operator new(std::size_t bytes, std::align_val_t align) {
+    t_newTotals.count++;
+    t_newTotals.bytes += static_cast<long long>(bytes);
+    size_t alignment = std::max(static_cast<size_t>(align), sizeof(void*));
+#ifdef _WIN32
+    void* p = _aligned_malloc(bytes ? bytes : 1, alignment);
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment, bytes ? bytes : 1) != 0) p = nullptr;
+#endif
+    if (p) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+void operator delete(void* p, std::size_t, std::align_val_t align) noexcept { operator delete(p, align); }
+
+// =================================================================================================
+// ARGUMENT HELPERS
+// =================================================================================================
+
+/*
+ * CommandLine
+ * -----------
+ * The arguments after the command name. Options are written "--name value";
+ * flags are written "--name" alone. Anything else is a positional argument.
+ * Flags must be listed in FLAGS so positional() knows they take no value
+ * (otherwise "solve --ways boards.txt" would read "boards.txt" as the value of --ways).
+ */
+struct CommandLine {
+    static constexpr const char* FLAGS[] = {"alloc", "board-echo", "by-time", "open",  "outcomes", "perf",
+                                            "pool",  "print",      "scaled",  "stats", "verify",   "ways"};
+
+    std::string program; // argv[0], for commands that start copies of themselves
+    std::vector<std::string> args;
+
+    // Value of "--name value", or `def` if the option is missing
+    std::string get(const char* name, const std::string& def = "") const {
+        std::string key = std::string("--") + name;
+        for (size_t i = 0; i + 1 < args.size(); i++) {
+            if (args[i] == key) return args[i + 1];
+        }
+        return def;
+    }
+    long long getInt(const char* name, long long def) const {
+        std::string v = get(name);
+        return v.empty() ? def : std::strtoll(v.c_str(), nullptr, 10);
+    }
+    double getDouble(const char* name, double def) const {
+        std::string v = get(name);
+        return v.empty() ? def : std::strtod(v.c_str(), nullptr);
+    }
+    bool has(const char* name) const {
+        std::string key = std::string("--") + name;
+        for (const auto& a : args) if (a == key) return true;
+        return false;
+    }
+    // The n-th argument that is not an option, an option's value or a flag (or `def`)
+    std::string positional(size_t n, const std::string& def = "") const {
+        for (size_t i = 0; i < args.size(); i++) {
+            if (args[i].rfind("--", 0) == 0) {
+                if (!isFlag(args[i].substr(2))) i++; // Skip the option's value too
+                continue;
+            }
+            if (n-- == 0) return args[i];
+        }
+        return def;
+    }
+    static bool isFlag(const std::string& name) {
+        for (const char* f : FLAGS) if (name == f) return true;
+        return false;
+    }
+};
+
+// Reads the --board option, defaulting to an empty board. Prints an error on bad input.
+static bool readBoard(const CommandLine& cl, std::array<CellContent, TOTAL_CELLS>& grid) {
+    std::string text = cl.get("board", std::string(TOTAL_CELLS, '.'));
+    if (!boardFromText(text, grid)) {
+        std::fprintf(stderr, "error: --board must be %d cells of .GBRSYPX (got \"%s\")\n", TOTAL_CELLS, text.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Human-friendly cell name, 1-based like the GUI ("row 2, col 5")
+static std::string cellName(int idx) {
+    if (idx < 0 || idx >= TOTAL_CELLS) return "none";
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "row %d, col %d", idx / COLS + 1, idx % COLS + 1);
+    return buf;
+}
+
+// =================================================================================================
+// COMMANDS
+// =================================================================================================
+
+/*
+ * policy
+ * ------
+ * policy solve --board B [--out FILE] [--threads N] [--table-mb MB] [--split-depth D]
+ *              [--checkpoint FILE] [--checkpoint-every SECONDS] [--resume FILE]
+ * policy query --table FILE --board B
+ */
+static int cmdPolicy(const CommandLine& cl) {
+    std::string action = cl.positional(0);
+    std::array<CellContent, TOTAL_CELLS> grid;
+    if (!readBoard(cl, grid)) return 2;
+
+    if (action == "query") {
+        PolicyTable table;
+        std::string path = cl.get("table", "policy.tdp");
+        if (!table.open(path)) {
+            std::fprintf(stderr, "error: cannot open policy table %s\n", path.c_str());
+            return 1;
+        }
+        PolicyValue v;
+        if (!table.lookup(grid, v)) {
+            std::printf("Position not in table (%zu states)\n", table.size());
+            return 1;
+        }
+        std::printf("Survival: %.4f  best dig %s\n", v.survival,
+            v.bestSurvival == POLICY_NO_CELL ? "none" : cellName(v.bestSurvival).c_str());
+        std::printf("EV:       %.2f rupees  best dig %s\n", v.ev,
+            v.bestEv == POLICY_NO_CELL ? "stop" : cellName(v.bestEv).c_str());
+        return 0;
+    }
+
+    if (action != "solve") {
+        std::fprintf(stderr, "usage: policy solve|query [options]\n");
+        return 2;
+    }
+
+    size_t tableBytes = static_cast<size_t>(cl.getInt("table-mb", 1024)) << 20;
+    PolicySolver solver(tableBytes);
+    solver.threads = (int)cl.getInt("threads", 0);
+    solver.splitDepth = (int)cl.getInt("split-depth", 2);
+    solver.checkpointPath = cl.get("checkpoint");
+    solver.checkpointSeconds = cl.getDouble("checkpoint-every", 300);
+
+    std::string resume = cl.get("resume");
+    if (!resume.empty()) {
+        if (!solver.loadCheckpoint(resume)) {
+            std::fprintf(stderr, "error: cannot load checkpoint %s\n", resume.c_str());
+            return 1;
+        }
+        std::fprintf(stderr, "Resumed from %s\n", resume.c_str());
+    }
+
+    double lastPrint = -1.0;
+    solver.onProgress = [&](const PolicyProgress& p) {
+        if (p.seconds - lastPrint < 1.0 && p.tasksDone < p.tasksTotal) return;
+        lastPrint = p.seconds;
+        std::fprintf(stderr, "\r[%7.0fs] tasks %zu/%zu  states %lld  table %zu/%zu   ",
+            p.seconds, p.tasksDone, p.tasksTotal, p.statesSolved, p.tableEntries, p.tableCapacity);
+    };
+
+    PolicyValue root = solver.solve(grid);
+    std::fprintf(stderr, "\n");
+    std::printf("Survival: %.6f  best dig %s\n", root.survival,
+        root.bestSurvival == POLICY_NO_CELL ? "none" : cellName(root.bestSurvival).c_str());
+    std::printf("EV:       %.3f rupees  best dig %s\n", root.ev,
+        root.bestEv == POLICY_NO_CELL ? "stop" : cellName(root.bestEv).c_str());
+
+    std::string out = cl.get("out", "policy.tdp");
+    if (!solver.writeCheckpoint(out)) {
+        std::fprintf(stderr, "error: cannot write %s\n", out.c_str());
+        return 1;
+    }
+    std::printf("Policy table written to %s\n", out.c_str());
+    return 0;
+}
+
+/*
+ * advise
+ * ------
+ * advise --board B [--samples N] [--budget-ms MS]
+ * Should you keep digging? Prints the expected gain of stopping after k more digs.
+ */
+static int cmdAdvise(const CommandLine& cl) {
+    std::array<CellContent, TOTAL_CELLS> grid;
+    if (!readBoard(cl, grid)) return 2;
+    StopAdvisor advisor;
+    advisor.maxSamples = cl.getInt("samples", 20000);
+    StopAdvice a = advisor.advise(grid, (int)cl.getInt("budget-ms", 1000));
+    if (a.samples == 0) {
+        std::fprintf(stderr, "error: board is contradictory or has nothing to dig\n");
+        return 1;
+    }
+    std::printf("Haul so far: %d rupees   (%lld simulated games, safest cell after every re-solve)\n",
+        a.haul, a.samples);
+    std::printf("Next dig: %+.2f rupees expected\n", a.nextDigGain());
+    if (a.shouldContinue()) {
+        std::printf("Advice: keep digging, stop after %d more dig(s): %+.2f +/- %.2f rupees, %.1f%% bomb risk\n",
+            a.bestStop, a.bestGain, a.bestGainStdErr, a.bombRisk * 100.0);
+    } else {
+        std::printf("Advice: stop now\n");
+    }
+    for (size_t k = 1; k < a.meanGain.size(); k++) {
+        if (k == 1 && !a.digOrder.empty()) {
+            std::printf("  %2zu more: %+8.2f   (dig %s)\n", k, a.meanGain[k], cellName(a.digOrder[0]).c_str());
+        } else {
+            std::printf("  %2zu more: %+8.2f\n", k, a.meanGain[k]); // Later digs depend on what turns up
+        }
+    }
+    return 0;
+}
+
+/*
+ * exact
+ * -----
+ * exact --board B [--threads N] [--primes N]
+ * Counts the board's layouts exactly (modular arithmetic + CRT, see exact_count.h) and prints
+ * every undug cell's exact bad probability, plus the largest difference to the solver's.
+ * --primes forces at least N primes (a real board needs only one); the counts are then also
+ * computed with the default number and must be identical.
+ */
+static int cmdExact(const CommandLine& cl) {
+    std::array<CellContent, TOTAL_CELLS> grid;
+    if (!readBoard(cl, grid)) return 2;
+    ThrillDiggerSolver solver;
+    solver.grid = grid;
+    solver.solve();
+
+    auto start = std::chrono::steady_clock::now();
+    int threads = (int)cl.getInt("threads", 0);
+    ExactCounts exact = countExactly(solver, threads, (int)cl.getInt("primes", 0));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!exact.complete) {
+        std::fprintf(stderr, "error: a component is too big to enumerate, no exact count exists\n");
+        return 1;
+    }
+    if (exact.totalWays.isZero()) {
+        std::fprintf(stderr, "error: board is contradictory\n");
+        return 1;
+    }
+    std::printf("Layouts: %s  (%d prime(s), %d thread(s), %.2f ms)\n", exact.totalWays.toString().c_str(),
+        exact.primes, exact.threads, ms);
+
+    double maxDiff = 0.0;
+    for (int r = 0; r < ROWS; r++) {
+        for (int c = 0; c < COLS; c++) {
+            int i = r * COLS + c;
+            if (grid[i] != CellContent::Undug) {
+                std::printf("     -- ");
+                continue;
+            }
+            double p = exact.probability(i);
+            maxDiff = std::max(maxDiff, std::fabs(p - solver.badProb[i]));
+            std::printf(" %6.2f%%", p * 100.0);
+        }
+        std::printf("\n");
+    }
+    std::printf("Largest difference to the floating-point solver: %.3g\n", maxDiff);
+
+    // Forced extra primes: the CRT result must not depend on how many primes carried it
+    ExactCounts reference = countExactly(solver, threads);
+    if (reference.primes != exact.primes) {
+        bool same = reference.totalWays.toString() == exact.totalWays.toString();
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            same = same && reference.badWays[i].toString() == exact.badWays[i].toString();
+        }
+        std::printf("Same counts as with %d prime(s): %s\n", reference.primes, same ? "yes" : "NO");
+        if (!same) return 1;
+    }
+    return 0;
+}
+
+/*
+ * gen
+ * ---
+ * gen [--seed S] [--first G] [--count N] [--print]
+ * Generates boards G..G+N-1 of seed S. With --print, writes them as board text (one per line);
+ * otherwise only measures the generation speed.
+ */
+static int cmdGen(const CommandLine& cl) {
+    uint64_t seed = static_cast<uint64_t>(cl.getInt("seed", 1));
+    uint64_t first = static_cast<uint64_t>(cl.getInt("first", 0));
+    long long count = cl.getInt("count", cl.has("print") ? 10 : 100000000);
+
+    if (cl.has("print")) {
+        for (long long g = 0; g < count; g++) {
+            std::printf("%s\n", boardToText(generateBoard(seed, first + g).toGrid()).c_str());
+        }
+        return 0;
+    }
+
+    // The checksum keeps the compiler from skipping boards nobody looks at
+    auto start = std::chrono::steady_clock::now();
+    uint64_t checksum = 0;
+    for (long long g = 0; g < count; g++) {
+        BitBoard b = generateBoard(seed, first + g);
+        checksum ^= b.bombs + 3 * b.gold + 5 * b.silver + 7 * b.red;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%lld boards in %.3f s = %.1f M boards/s (checksum %016llx)\n",
+        count, secs, count / secs / 1e6, (unsigned long long)checksum);
+    return 0;
+}
+
+// The strategy options shared by `tournament` and `shard`
+static const char* const STRATEGY_OPTIONS[] = {"strategies", "ev-depth", "info-tolerance", "mcts-iterations"};
+
+// Builds the strategies named in --strategies (comma separated). Prints an error on bad input.
+static bool readStrategies(const CommandLine& cl, std::vector<std::string>& names,
+                           std::vector<StrategyFactory>& factories)
+{
+    int evDepth = (int)cl.getInt("ev-depth", 1);
+    double infoTolerance = cl.getDouble("info-tolerance", 0.02);
+    long long mctsIterations = cl.getInt("mcts-iterations", 1000);
+
+    std::string list = cl.get("strategies", "safest,ev,info");
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) comma = list.size();
+        std::string name = list.substr(pos, comma - pos);
+        pos = comma + 1;
+        if (name == "safest") {
+            factories.push_back([] { return std::unique_ptr<Strategy>(new SafestStrategy()); });
+        } else if (name == "ev") {
+            factories.push_back([=] { return std::unique_ptr<Strategy>(new ExpectimaxStrategy(evDepth)); });
+        } else if (name == "info") {
+            factories.push_back([=] { return std::unique_ptr<Strategy>(new InfoGainStrategy(infoTolerance)); });
+        } else if (name == "mcts") {
+            factories.push_back([=] { return std::unique_ptr<Strategy>(new MctsStrategy(mctsIterations)); });
+        } else {
+            std::fprintf(stderr, "error: unknown strategy \"%s\" (safest, ev, info, mcts)\n", name.c_str());
+            return false;
+        }
+        names.push_back(name);
+    }
+    return true;
+}
+
+// Prints the per-strategy table and the paired differences
+// `intervals` says what kind of intervals the pairs carry
+static void printReport(const TournamentReport& r, double confidence, const char* intervals) {
+    std::printf("%-10s %10s %8s %8s %8s %8s\n", "strategy", "rupees", "+/-", "bomb%", "clear%", "digs");
+    for (const StrategyStats& s : r.strategies) {
+        double n = static_cast<double>(std::max(1LL, r.games));
+        std::printf("%-10s %10.2f %8.2f %8.2f %8.2f %8.2f\n", s.name.c_str(), s.rupees.mean, s.rupees.stdErr(),
+            100.0 * s.bombed / n, 100.0 * s.cleared / n, s.digs / n);
+    }
+    // Per-move sketches (only the in-process tournament records them)
+    bool header = false;
+    for (const StrategyStats& s : r.strategies) {
+        const MoveStats& m = s.moves;
+        if (m.decideNs.count() == 0) continue;
+        if (!header) {
+            std::printf("\n%-10s %27s %23s %23s\n", "", "decide time us (p50/p99/p99.9)",
+                "game rupees (p10/50/90)", "chosen bad% (p50/p99)");
+            header = true;
+        }
+        std::printf("%-10s %9.1f %8.1f %8.1f   %7.0f %7.0f %7.0f", s.name.c_str(),
+            m.decideNs.valueAtPercentile(50) / 1e3, m.decideNs.valueAtPercentile(99) / 1e3,
+            m.decideNs.valueAtPercentile(99.9) / 1e3, m.gameRupees.quantile(0.1), m.gameRupees.quantile(0.5),
+            m.gameRupees.quantile(0.9));
+        if (m.chosenBadProb.count() > 0) {
+            std::printf("   %9.1f %7.1f", 100.0 * m.chosenBadProb.quantile(0.5), 100.0 * m.chosenBadProb.quantile(0.99));
+        }
+        std::printf("\n");
+    }
+    if (header) {
+        std::printf("\noutcomes per dig (%%):  %8s %8s %8s %8s %8s %8s %8s\n",
+            "green", "blue", "red", "silver", "gold", "rupoor", "bomb");
+        for (const StrategyStats& s : r.strategies) {
+            double digs = static_cast<double>(std::max<uint64_t>(1, s.moves.outcomes.total()));
+            std::printf("  %-19s", s.name.c_str());
+            for (uint64_t n : s.moves.outcomes.n) std::printf(" %8.2f", 100.0 * n / digs);
+            std::printf("\n");
+        }
+    }
+    if (!r.pairs.empty()) {
+        std::printf("\npaired differences (%.0f%% %s):\n", confidence * 100.0, intervals);
+        for (const PairStats& p : r.pairs) {
+            std::printf("  %-8s - %-8s %+9.2f  [%+.2f, %+.2f]%s\n",
+                r.strategies[p.a].name.c_str(), r.strategies[p.b].name.c_str(),
+                p.diff.mean, p.low, p.high, p.significant ? "  significant" : "");
+        }
+    }
+}
+
+/*
+ * tournament
+ * ----------
+ * tournament [--strategies safest,ev,info,mcts] [--games N] [--min-games N] [--round N]
+ *            [--seed S] [--threads N] [--confidence C]
+ *            [--ev-depth D] [--info-tolerance T] [--mcts-iterations N]
+ * Plays the strategies on the same random boards and compares them pairwise.
+ */
+static int cmdTournament(const CommandLine& cl) {
+    std::vector<std::string> names;
+    std::vector<StrategyFactory> factories;
+    if (!readStrategies(cl, names, factories)) return 2;
+    Tournament t;
+    for (size_t i = 0; i < names.size(); i++) t.add(names[i], factories[i]);
+
+    TournamentConfig cfg;
+    cfg.seed = static_cast<uint64_t>(cl.getInt("seed", 1));
+    cfg.maxGames = cl.getInt("games", 100000);
+    cfg.minGames = cl.getInt("min-games", 500);
+    cfg.roundGames = std::max(1LL, cl.getInt("round", 500));
+    cfg.threads = (int)cl.getInt("threads", 0);
+    cfg.confidence = cl.getDouble("confidence", 0.95);
+
+    auto start = std::chrono::steady_clock::now();
+    t.onRound = [&](const TournamentReport& r) {
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::fprintf(stderr, "\r[%6.0fs] %lld games   ", secs, r.games);
+    };
+    TournamentReport r = t.run(cfg);
+    std::fprintf(stderr, "\n");
+
+    std::printf("%lld games (seed %llu)%s\n\n", r.games, (unsigned long long)cfg.seed,
+        r.stoppedEarly ? ", stopped early: every difference is significant" : "");
+    printReport(r, cfg.confidence, "joint confidence sequences, valid at every round");
+    return 0;
+}
+
+/*
+ * shard
+ * -----
+ * shard run --out FILE --first G --count N [--seed S] [strategy options]
+ *     One worker: plays games G..G+N-1 into a shard file (resumes an existing one).
+ * shard launch --games N [--processes P] [--shards K] [--prefix P] [--attempts A] [--seed S]
+ *              [strategy options]
+ *     Splits games 0..N-1 into K shards (PREFIX-000.tds...), runs them in P worker processes,
+ *     restarts workers that die, then merges the results.
+ * shard merge FILE... [--confidence C]
+ * Strategy options are the ones of `tournament` (--strategies, --ev-depth...).
+ */
+static int cmdShard(const CommandLine& cl) {
+    std::string action = cl.positional(0);
+    double confidence = cl.getDouble("confidence", 0.95);
+
+    if (action == "run") {
+        ShardSpec spec;
+        std::vector<StrategyFactory> factories;
+        if (!readStrategies(cl, spec.strategies, factories)) return 2;
+        spec.seed = static_cast<uint64_t>(cl.getInt("seed", 1));
+        spec.firstGame = static_cast<uint64_t>(cl.getInt("first", 0));
+        spec.numGames = static_cast<uint64_t>(cl.getInt("count", 1000));
+        std::string error;
+        if (!runShard(cl.get("out", "shard.tds"), spec, factories, error)) {
+            std::fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    if (action == "launch") {
+        long long games = cl.getInt("games", 10000);
+        int processes = (int)std::max(1LL, cl.getInt("processes", (long long)std::max(1u, std::thread::hardware_concurrency())));
+        // More shards than processes: a restarted shard then only redoes a small range
+        int shards = (int)std::max(1LL, std::min(games, cl.getInt("shards", 4LL * processes)));
+        std::string prefix = cl.get("prefix", "shard");
+
+        std::vector<std::string> files;
+        for (int s = 0; s < shards; s++) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "-%03d.tds", s);
+            files.push_back(prefix + name);
+        }
+
+        ShardCoordinator coord;
+        coord.processes = processes;
+        coord.maxAttempts = (int)cl.getInt("attempts", 3);
+        coord.commandFor = [&](int s) {
+            long long first = games * s / shards, last = games * (s + 1) / shards;
+            std::vector<std::string> cmd = {cl.program, "shard", "run", "--out", files[s],
+                "--seed", cl.get("seed", "1"), "--first", std::to_string(first), "--count", std::to_string(last - first)};
+            for (const char* opt : STRATEGY_OPTIONS) {
+                if (cl.has(opt)) {
+                    cmd.push_back(std::string("--") + opt);
+                    cmd.push_back(cl.get(opt));
+                }
+            }
+            return cmd;
+        };
+        auto start = std::chrono::steady_clock::now();
+        int finished = 0;
+        coord.onExit = [&](int s, int attempt, bool ok) {
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (ok) finished++;
+            std::fprintf(stderr, "[%6.0fs] %s %s (attempt %d), %d/%d shards done\n", secs, files[s].c_str(),
+                ok ? "finished" : "FAILED", attempt, finished, shards);
+        };
+        bool allOk = coord.run(shards);
+        if (!coord.error.empty()) {
+            std::fprintf(stderr, "error: %s\n", coord.error.c_str());
+            return 1;
+        }
+
+        TournamentReport r;
+        long long unfinished = 0;
+        std::string error;
+        if (!mergeShards(files, confidence, r, unfinished, error)) {
+            std::fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+        std::printf("%lld games merged from %d shards%s\n\n", r.games, shards,
+            allOk ? "" : " (some shards failed: run the same launch again to resume them)");
+        printReport(r, confidence, "confidence interval");
+        return allOk ? 0 : 1;
+    }
+
+    if (action == "merge") {
+        std::vector<std::string> files;
+        for (size_t i = 1; !cl.positional(i).empty(); i++) files.push_back(cl.positional(i));
+        TournamentReport r;
+        long long unfinished = 0;
+        std::string error;
+        if (files.empty() || !mergeShards(files, confidence, r, unfinished, error)) {
+            std::fprintf(stderr, "error: %s\n", files.empty() ? "no shard files given" : error.c_str());
+            return files.empty() ? 2 : 1;
+        }
+        std::printf("%lld games merged from %zu shards", r.games, files.size());
+        if (unfinished) std::printf(", %lld games not finished yet", unfinished);
+        std::printf("\n\n");
+        printReport(r, confidence, "confidence interval");
+        return 0;
+    }
+
+    std::fprintf(stderr, "usage: shard run|launch|merge [options]\n");
+    return 2;
+}
+
+// Per-stage hardware counter table of `stress bench --perf` and `session replay --perf`
+static void printStagePerf(const StagePerfProfiler& p) {
+    if (p.solves == 0) return;
+    std::printf("%-12s %14s %14s %6s %14s %12s %12s   (per solve)\n", "stage", "cycles", "instructions", "IPC",
+        "branch-misses", "L1d-misses", "LLC-misses");
+    PerfTotals all;
+    for (int s = 0; s <= NUM_SOLVE_STAGES; s++) {
+        const PerfTotals& t = s < NUM_SOLVE_STAGES ? p.stages[s] : all;
+        if (s < NUM_SOLVE_STAGES) all.add(t);
+        std::printf("%-12s", s < NUM_SOLVE_STAGES ? solveStageName(s) : "total");
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            if (e == PERF_BRANCH_MISSES) {
+                double ipc = t.v[PERF_CYCLES] > 0.0 ? t.v[PERF_INSTRUCTIONS] / t.v[PERF_CYCLES] : 0.0;
+                std::printf(" %6.2f", ipc);
+            }
+            if (p.counters.has(e)) std::printf(" %*.0f", e < 2 || e == PERF_BRANCH_MISSES ? 14 : 12, t.v[e] / p.solves);
+            else std::printf(" %*s", e < 2 || e == PERF_BRANCH_MISSES ? 14 : 12, "n/a");
+        }
+        std::printf("\n");
+    }
+}
+
+// Per-stage allocation table of `stress bench --alloc`
+static void printStageAllocs(const StageAllocProfiler& p) {
+    if (p.solves == 0) return;
+    std::printf("%-12s %14s %14s %14s %14s   (per solve)\n", "stage", "memory allocs", "memory bytes",
+        "new allocs", "new bytes");
+    AllocTotals allResource, allNew;
+    for (int s = 0; s <= NUM_SOLVE_STAGES; s++) {
+        const AllocTotals& r = s < NUM_SOLVE_STAGES ? p.viaResource[s] : allResource;
+        const AllocTotals& g = s < NUM_SOLVE_STAGES ? p.viaNew[s] : allNew;
+        if (s < NUM_SOLVE_STAGES) {
+            allResource.count += r.count;
+            allResource.bytes += r.bytes;
+            allNew.count += g.count;
+            allNew.bytes += g.bytes;
+        }
+        std::printf("%-12s %14.1f %14.0f %14.1f %14.0f\n", s < NUM_SOLVE_STAGES ? solveStageName(s) : "total",
+            (double)r.count / p.solves, (double)r.bytes / p.solves, (double)g.count / p.solves, (double)g.bytes / p.solves);
+    }
+}
+
+/*
+ * session
+ * -------
+ * session record --out FILE [--games N] [--seed S]
+ *     Writes a log of simulated sessions (safest-first play on random boards), for testing
+ *     and for benchmarking when no real logs are at hand.
+ * session replay FILE... [--repeat N] [--perf] [--scaled]
+ *     Replays logs through the solver at full speed: total time, per-event latency and a
+ *     digest of all results (compare digests to check that a change kept every answer).
+ *     --perf adds hardware counters per solve stage (Linux). --scaled combines every board
+ *     with the scaled arithmetic meant for large boards (its digest should match).
+ */
+static int cmdSession(const CommandLine& cl) {
+    std::string action = cl.positional(0);
+
+    if (action == "record") {
+        std::string out = cl.get("out", "session.tdlog");
+        SessionLog log;
+        if (!log.open(out)) {
+            std::fprintf(stderr, "error: cannot open %s\n", out.c_str());
+            return 1;
+        }
+        uint64_t seed = static_cast<uint64_t>(cl.getInt("seed", 1));
+        long long games = cl.getInt("games", 100);
+        ThrillDiggerSolver solver;
+        solver.observer = &log; // Same path as a front-end: every change goes through the solver
+        for (long long g = 0; g < games; g++) {
+            std::array<CellContent, TOTAL_CELLS> answer = generateBoard(seed, static_cast<uint64_t>(g)).toGrid();
+            solver.reset();
+            solver.solve();
+            for (;;) {
+                int best = -1;
+                for (int i = 0; i < TOTAL_CELLS; i++) {
+                    if (solver.grid[i] == CellContent::Undug && (best < 0 || solver.badProb[i] < solver.badProb[best])) best = i;
+                }
+                if (best < 0) break;
+                solver.setCell(best / COLS, best % COLS, answer[best]);
+                if (answer[best] == CellContent::Bomb) break;
+                solver.solve();
+            }
+        }
+        std::printf("%lld simulated sessions appended to %s\n", games, out.c_str());
+        return 0;
+    }
+
+    if (action != "replay") {
+        std::fprintf(stderr, "usage: session record|replay [options]\n");
+        return 2;
+    }
+    std::vector<std::string> files;
+    for (size_t i = 1; !cl.positional(i).empty(); i++) files.push_back(cl.positional(i));
+    if (files.empty()) {
+        std::fprintf(stderr, "error: no session logs given\n");
+        return 2;
+    }
+    long long repeat = std::max(1LL, cl.getInt("repeat", 1));
+
+    ReplayResult result;
+    // The memory resources come first: the solver is destroyed before them and gives its
+    // buffers back to them on the way
+    std::pmr::unsynchronized_pool_resource pool;
+    StageAllocProfiler allocs(cl.has("pool") ? &pool : std::pmr::get_default_resource());
+    ThrillDiggerSolver solver;
+    solver.forceScaledCombine = cl.has("scaled");
+    StagePerfProfiler profiler;
+    if (cl.has("perf")) {
+        if (!profiler.counters.open()) {
+            std::fprintf(stderr, "note: hardware counters unavailable (%s)\n", profiler.counters.error().c_str());
+        } else {
+            solver.stageObserver = &profiler;
+        }
+    }
+    for (long long r = 0; r < repeat; r++) {
+        for (const std::string& path : files) {
+            SessionLogFile log;
+            if (!log.open(path)) {
+                std::fprintf(stderr, "error: %s is not a session log\n", path.c_str());
+                return 1;
+            }
+            replayEvents(log.events(), log.size(), solver, result);
+        }
+    }
+
+    const HdrHistogram& h = result.latencyNs;
+    std::printf("%lld events in %.3f s = %.0f events/s", result.events, result.seconds,
+        result.seconds > 0.0 ? result.events / result.seconds : 0.0);
+    if (result.skipped) std::printf(" (%lld malformed events skipped)", result.skipped);
+    std::printf("\nrecorded session time: %.1f s\n", result.recordedSeconds);
+    std::printf("latency us: mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+        h.mean() / 1e3, h.valueAtPercentile(50) / 1e3, h.valueAtPercentile(90) / 1e3,
+        h.valueAtPercentile(99) / 1e3, h.valueAtPercentile(99.9) / 1e3, h.max() / 1e3);
+    std::printf("result digest: %016llx\n", (unsigned long long)result.digest);
+    if (solver.stageObserver) printStagePerf(profiler);
+    return 0;
+}
+
+// Benchmark categories: one per file of the comma-separated `corpus` list (named after the
+// file), plus --typical N random mid-game positions. Prints an error on a bad file.
+static bool readCategories(const CommandLine& cl, const std::string& corpus,
+                           std::vector<std::pair<std::string, std::vector<WorstCase>>>& categories)
+{
+    std::string error;
+    for (size_t start = 0; start <= corpus.size();) {
+        size_t comma = std::min(corpus.find(',', start), corpus.size());
+        std::string path = corpus.substr(start, comma - start);
+        start = comma + 1;
+        if (path.empty()) continue;
+        std::string name = path.substr(path.find_last_of("/\\") + 1);
+        name = name.substr(0, name.find('.'));
+        categories.push_back({name, {}});
+        if (!readCorpus(path, categories.back().second, error)) {
+            std::fprintf(stderr, "error: %s\n", error.c_str());
+            return false;
+        }
+    }
+    long long typical = cl.getInt("typical", 0);
+    if (typical > 0) {
+        categories.push_back({"typical", {}});
+        typicalPositions(static_cast<uint64_t>(cl.getInt("seed", 1)), (int)typical, categories.back().second);
+    }
+    return true;
+}
+
+/*
+ * stress
+ * ------
+ * stress search [--corpus FILE] [--seed S] [--boards N] [--iterations N] [--seconds-per-board T]
+ *               [--keep K] [--by-time]
+ *     Simulated annealing for the positions that cost the solver the most; the worst ones are
+ *     appended to the corpus (default bench/worst_boards.txt).
+ * stress bench [--corpus FILE[,FILE...]] [--typical N] [--repeat N] [--perf | --alloc [--pool]]
+ *              [--max-allocs N]
+ *     Solves every corpus position and reports time and search nodes, per category: each
+ *     corpus file is one, and --typical adds N random mid-game positions. --perf adds
+ *     hardware counters per solve stage (Linux); --alloc counts allocations per solve stage
+ *     (--pool gives the solver a memory pool). --max-allocs fails the run if a solve that is
+ *     not the first of its position makes more than N allocations.
+ * stress profile [--corpus FILE[,FILE...]] [--typical N] [--out FILE]
+ *     Search-tree profile of the same positions: nodes and prune reasons by depth and by cell,
+ *     plus a folded-stack file (default search.folded) for flamegraph.pl or speedscope.
+ */
+static int cmdStress(const CommandLine& cl) {
+    std::string action = cl.positional(0);
+    std::string corpus = cl.get("corpus", "bench/worst_boards.txt");
+
+    if (action == "search") {
+        WorstCaseConfig cfg;
+        cfg.seed = static_cast<uint64_t>(cl.getInt("seed", 1));
+        cfg.boards = (int)cl.getInt("boards", 20);
+        cfg.iterations = cl.getInt("iterations", 2000);
+        cfg.secondsPerBoard = cl.getDouble("seconds-per-board", 30.0);
+        cfg.keep = static_cast<size_t>(cl.getInt("keep", 10));
+        cfg.byTime = cl.has("by-time");
+
+        WorstCaseSearch search;
+        search.onImprove = [&](int b, const WorstCase& w) {
+            std::fprintf(stderr, "\rboard %d/%d: worst so far %lld nodes, %.0f us      ", b + 1, cfg.boards, w.nodes, w.micros);
+        };
+        std::vector<WorstCase> worst = search.run(cfg);
+        std::fprintf(stderr, "\n");
+        for (const WorstCase& w : worst) {
+            std::printf("%s  %10lld nodes %10.0f us  (%s)\n", boardToText(w.grid).c_str(), w.nodes, w.micros, w.origin.c_str());
+        }
+        if (!appendCorpus(corpus, worst)) {
+            std::fprintf(stderr, "error: cannot write %s\n", corpus.c_str());
+            return 1;
+        }
+        std::printf("%zu positions appended to %s\n", worst.size(), corpus.c_str());
+        return 0;
+    }
+
+    if (action == "profile") {
+        std::vector<std::pair<std::string, std::vector<WorstCase>>> categories;
+        if (!readCategories(cl, corpus, categories)) return 1;
+        ThrillDiggerSolver solver;
+        SearchProfile profile;
+        solver.searchProfile = &profile;
+        for (const auto& category : categories) {
+            for (size_t i = 0; i < category.second.size(); i++) {
+                profile.position = category.first + " #" + std::to_string(i + 1);
+                solver.reset();
+                solver.grid = category.second[i].grid;
+                solver.solve();
+            }
+        }
+
+        std::vector<SearchDepthStats> byDepth;
+        std::array<SearchDepthStats, TOTAL_CELLS> byCell;
+        summarizeProfile(profile, byDepth, byCell);
+        auto row = [](const char* label, const SearchDepthStats& s) {
+            std::printf("%-6s %14lld %12lld %12lld %12lld %12lld\n", label, s.nodes, s.overMax, s.underMin, s.budget, s.leaves);
+        };
+        const char* header = "%-6s %14s %12s %12s %12s %12s\n";
+        std::printf(header, "depth", "nodes", "over max", "under min", "budget", "leaves");
+        for (size_t d = 0; d < byDepth.size(); d++) {
+            if (byDepth[d].nodes == 0 && byDepth[d].overMax == 0 && byDepth[d].underMin == 0) continue;
+            row(std::to_string(d).c_str(), byDepth[d]);
+        }
+        // Cells by the work they led to, most first (prunes count for the cell that was assigned)
+        std::vector<int> cells;
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            if (byCell[i].nodes + byCell[i].overMax + byCell[i].underMin > 0) cells.push_back(i);
+        }
+        std::sort(cells.begin(), cells.end(), [&](int a, int b) { return byCell[a].nodes > byCell[b].nodes; });
+        std::printf("\n");
+        std::printf(header, "cell", "nodes", "over max", "under min", "budget", "leaves");
+        for (int i : cells) row(profileCellName(i).c_str(), byCell[i]);
+
+        std::string out = cl.get("out", "search.folded");
+        if (!writeFoldedStacks(out, profile)) {
+            std::fprintf(stderr, "error: cannot write %s\n", out.c_str());
+            return 1;
+        }
+        std::printf("\n%zu components profiled; folded stacks written to %s\n", profile.components.size(), out.c_str());
+        return 0;
+    }
+
+    if (action != "bench") {
+        std::fprintf(stderr, "usage: stress search|bench|profile [options]\n");
+        return 2;
+    }
+    std::vector<std::pair<std::string, std::vector<WorstCase>>> categories;
+    if (!readCategories(cl, corpus, categories)) return 1;
+
+    long long repeat = std::max(1LL, cl.getInt("repeat", 3));
+    if (cl.has("perf") && cl.has("alloc")) {
+        std::fprintf(stderr, "error: use --perf or --alloc, not both\n");
+        return 2;
+    }
+    // The memory resources come first: the solver is destroyed before them and gives its
+    // buffers back to them on the way
+    std::pmr::unsynchronized_pool_resource pool;
+    StageAllocProfiler allocs(cl.has("pool") ? &pool : std::pmr::get_default_resource());
+    ThrillDiggerSolver solver;
+    solver.forceScaledCombine = cl.has("scaled");
+    StagePerfProfiler profiler;
+    if (cl.has("perf")) {
+        if (!profiler.counters.open()) {
+            std::fprintf(stderr, "note: hardware counters unavailable (%s)\n", profiler.counters.error().c_str());
+        } else {
+            solver.stageObserver = &profiler;
+        }
+    }
+    long long maxAllocs = cl.getInt("max-allocs", -1);
+    long long steadyAllocs = 0; // Most operator new calls of one solve, first solves excepted
+    if (cl.has("alloc") || maxAllocs >= 0) {
+        solver.memory = &allocs.resource;
+        solver.stageObserver = &allocs;
+    }
+    for (const auto& category : categories) {
+        const std::vector<WorstCase>& cases = category.second;
+        HdrHistogram latencyNs;
+        long long totalNodes = 0;
+        double totalMicros = 0.0;
+        profiler.clear();
+        allocs.clear();
+        std::printf("== %s\n", category.first.c_str());
+        for (const WorstCase& w : cases) {
+            double best = 1e300;
+            long long nodes = 0;
+            for (long long r = 0; r < repeat; r++) {
+                double us;
+                long long before = countedNew().count;
+                measureSolve(solver, w.grid, 1, nodes, us);
+                if (r > 0) steadyAllocs = std::max(steadyAllocs, countedNew().count - before);
+                latencyNs.record(static_cast<uint64_t>(us * 1e3));
+                best = std::min(best, us);
+            }
+            totalNodes += nodes;
+            totalMicros += best;
+            if (category.first != "typical") {
+                std::printf("%s  %10lld nodes %10.0f us  %s\n", boardToText(w.grid).c_str(), nodes, best,
+                    solver.totalWays > 0.0 ? "" : "(contradictory!)");
+            }
+        }
+        std::printf("%zu positions: %lld nodes, %.1f ms (sum of best times)\n", cases.size(), totalNodes, totalMicros / 1e3);
+        std::printf("solve time us: p50 %.0f  p99 %.0f  max %.0f\n", latencyNs.valueAtPercentile(50) / 1e3,
+            latencyNs.valueAtPercentile(99) / 1e3, latencyNs.max() / 1e3);
+        if (solver.stageObserver == &profiler) printStagePerf(profiler);
+        if (solver.stageObserver == &allocs) printStageAllocs(allocs);
+        std::printf("\n");
+    }
+    if (maxAllocs >= 0) {
+        if (repeat < 2) {
+            std::fprintf(stderr, "error: --max-allocs needs --repeat 2 or more (first solves are warm-up)\n");
+            return 2;
+        }
+        std::printf("steady-state allocations per solve: at most %lld (limit %lld)\n", steadyAllocs, maxAllocs);
+        if (steadyAllocs > maxAllocs) return 1;
+    }
+    return 0;
+}
+
+// Set by SIGINT / SIGTERM: asks `daemon serve` to finish
+static std::atomic<bool> g_stopRequested(false);
+static void onStopSignal(int) { g_stopRequested.store(true); }
+
+static void printDaemonStats(const DaemonStats& s) {
+    std::printf("daemon: %lld connections, %lld requests in %lld batches (%.1f per batch), "
+        "%lld cache hits, %lld in-batch duplicates, %lld solved\n",
+        s.connections, s.requests, s.batches, s.batches ? (double)s.requests / s.batches : 0.0,
+        s.cacheHits, s.duplicates, s.solved);
+}
+
+// A daemon run by `daemon bench` itself, on a thread of this process
+struct BenchDaemon {
+    std::unique_ptr<SolverDaemon> daemon;
+    std::atomic<bool> stop{false};
+    std::thread thread;
+
+    bool start(const DaemonConfig& cfg, std::string& error) {
+        daemon = std::make_unique<SolverDaemon>(cfg);
+        if (!daemon->start(error)) return false;
+        stop.store(false);
+        thread = std::thread([this] { daemon->run(stop); });
+        return true;
+    }
+    // Stops the daemon and returns what it did
+    DaemonStats finish() {
+        stop.store(true);
+        thread.join();
+        DaemonStats s = daemon->stats();
+        daemon.reset();
+        return s;
+    }
+    ~BenchDaemon() {
+        if (thread.joinable()) finish();
+    }
+};
+
+/*
+ * daemon
+ * ------
+ * daemon serve [--socket PATH] [--threads N] [--batch-us U] [--max-batch N] [--cache N]
+ *     Answers board requests on a Unix domain socket (protocol in daemon.h) until Ctrl+C.
+ * daemon bench [--socket PATH] [--connections C] [--requests N] [--depth D | --open]
+ *              [--qps Q | --sweep Q1,Q2,...] [--session FILE[,FILE...] | --typical M [--seed S]]
+ *              [--verify] [daemon serve options]
+ *     Load test (see loadgen.h): C connections send N requests each, cycling through the
+ *     boards of recorded sessions or M random mid-game positions. Closed loop by default (D
+ *     requests in flight per connection); --open sends on schedule whatever the answers do.
+ *     --qps Q paces the requests at Q per second in total (needed by --open); latency is
+ *     then also reported from each request's intended send time (corrected for coordinated
+ *     omission). --sweep runs an open-loop test per rate and prints throughput vs latency.
+ *     Without --socket it starts its own daemon in this process first (with --sweep, a fresh
+ *     one per rate, so no rate is served from the cache the earlier rates filled; the share
+ *     of cache hits is printed next to each rate). --verify checks every answer against a
+ *     local solver.
+ */
+static DaemonConfig readDaemonConfig(const CommandLine& cl, const std::string& defaultSocket) {
+    DaemonConfig cfg;
+    cfg.socketPath = cl.get("socket", defaultSocket);
+    cfg.threads = (int)cl.getInt("threads", 1);
+    cfg.batchMicros = (int)cl.getInt("batch-us", cfg.batchMicros);
+    cfg.maxBatch = (int)std::max(1LL, cl.getInt("max-batch", cfg.maxBatch));
+    cfg.cacheEntries = (size_t)std::max(0LL, cl.getInt("cache", (long long)cfg.cacheEntries));
+    return cfg;
+}
+
+static int cmdDaemon(const CommandLine& cl) {
+    std::string action = cl.positional(0);
+    if (action == "serve") {
+        SolverDaemon daemon(readDaemonConfig(cl, "/tmp/thrilldigger.sock"));
+        std::string error;
+        if (!daemon.start(error)) {
+            std::fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+        std::printf("listening on %s with %d solver thread(s), Ctrl+C to stop\n",
+            cl.get("socket", "/tmp/thrilldigger.sock").c_str(), daemon.solverThreads());
+        std::fflush(stdout);
+        daemon.run(g_stopRequested);
+        printDaemonStats(daemon.stats());
+        return 0;
+    }
+    if (action != "bench") {
+        std::fprintf(stderr, "usage: daemon serve|bench [options]\n");
+        return 2;
+    }
+
+    // Workload first: --verify solves it locally, which must not count as load
+    LoadWorkload work;
+    std::string sessions = cl.get("session");
+    for (size_t pos = 0; pos < sessions.size();) {
+        size_t comma = std::min(sessions.find(',', pos), sessions.size());
+        std::string path = sessions.substr(pos, comma - pos);
+        pos = comma + 1;
+        SessionLogFile log;
+        if (!log.open(path)) {
+            std::fprintf(stderr, "error: %s is not a session log\n", path.c_str());
+            return 1;
+        }
+        work.addSession(log.events(), log.size());
+    }
+    if (sessions.empty()) work.addTypical(static_cast<uint64_t>(cl.getInt("seed", 1)), (int)std::max(1LL, cl.getInt("typical", 1000)));
+    if (work.boards.empty()) {
+        std::fprintf(stderr, "error: the sessions hold no boards\n");
+        return 1;
+    }
+    if (cl.has("verify")) work.computeExpected();
+
+    LoadConfig load;
+    load.connections = (int)std::max(1LL, cl.getInt("connections", 4));
+    load.depth = (int)std::max(1LL, cl.getInt("depth", 1));
+    load.requests = std::max(1LL, cl.getInt("requests", 2000));
+    load.qps = cl.getDouble("qps", 0.0);
+    load.openLoop = cl.has("open");
+    std::vector<double> sweep;
+    std::string sweepList = cl.get("sweep");
+    for (size_t pos = 0; pos < sweepList.size();) {
+        size_t comma = std::min(sweepList.find(',', pos), sweepList.size());
+        double q = std::strtod(sweepList.substr(pos, comma - pos).c_str(), nullptr);
+        if (q > 0.0) sweep.push_back(q);
+        pos = comma + 1;
+    }
+    if (load.openLoop && load.qps <= 0.0) {
+        std::fprintf(stderr, "error: --open needs --qps\n");
+        return 2;
+    }
+
+    // Our own daemon unless --socket names a running one
+    bool ownDaemon = cl.get("socket").empty();
+    BenchDaemon local;
+    DaemonStats localTotals;
+    int localRuns = 0;
+    auto startLocal = [&]() {
+        load.socketPath = "/tmp/thrilldigger-bench-" + std::to_string((long long)std::chrono::steady_clock::now().time_since_epoch().count()) +
+                          "-" + std::to_string(localRuns++) + ".sock";
+        std::string error;
+        if (!local.start(readDaemonConfig(cl, load.socketPath), error)) {
+            std::fprintf(stderr, "error: %s\n", error.c_str());
+            return false;
+        }
+        return true;
+    };
+    auto finishLocal = [&]() {
+        DaemonStats s = local.finish();
+        localTotals.connections += s.connections;
+        localTotals.requests += s.requests;
+        localTotals.batches += s.batches;
+        localTotals.cacheHits += s.cacheHits;
+        localTotals.duplicates += s.duplicates;
+        localTotals.solved += s.solved;
+        return s;
+    };
+    if (!ownDaemon) load.socketPath = cl.get("socket");
+
+    std::printf("%zu boards, %d connections x %lld requests\n", work.boards.size(), load.connections, load.requests);
+    long long failures = 0, mismatches = 0;
+    auto us = [](uint64_t ns) { return ns / 1e3; };
+    if (sweep.empty()) {
+        if (ownDaemon && !startLocal()) return 1;
+        LoadResult r = runLoad(load, work);
+        if (ownDaemon) finishLocal();
+        std::printf("%s loop%s: %lld answers in %.3f s = %.0f requests/s\n", load.openLoop ? "open" : "closed",
+            load.openLoop ? "" : (" (" + std::to_string(load.depth) + " in flight per connection)").c_str(),
+            r.received, r.seconds, r.achievedQps());
+        for (int h = 0; h < (load.qps > 0.0 ? 2 : 1); h++) {
+            const HdrHistogram& hist = h == 0 ? r.serviceNs : r.correctedNs;
+            std::printf("%-10s latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+                h == 0 ? "service" : "corrected", us(hist.valueAtPercentile(50)), us(hist.valueAtPercentile(90)),
+                us(hist.valueAtPercentile(99)), us(hist.valueAtPercentile(99.9)), us(hist.max()));
+        }
+        failures += r.failures;
+        mismatches += r.mismatches;
+    } else {
+        // Throughput vs latency: one open-loop run per target rate, each against a daemon with
+        // an empty cache (a warm cache would make the later, faster rates look cheaper)
+        load.openLoop = true;
+        if (!ownDaemon) {
+            std::fprintf(stderr, "note: every rate uses the same daemon (--socket), whose cache the earlier rates fill; "
+                "start it with --cache 0 for comparable rows\n");
+        }
+        std::printf("%10s %10s %10s %10s %10s %10s %10s   (corrected latency, us)\n", "target/s", "achieved/s", "cache hit",
+            "p50", "p99", "p99.9", "max");
+        for (double q : sweep) {
+            load.qps = q;
+            if (ownDaemon && !startLocal()) return 1;
+            LoadResult r = runLoad(load, work);
+            char hits[16] = "-";
+            if (ownDaemon) {
+                DaemonStats s = finishLocal();
+                std::snprintf(hits, sizeof(hits), "%.1f%%", s.requests ? 100.0 * s.cacheHits / s.requests : 0.0);
+            }
+            const HdrHistogram& h = r.correctedNs;
+            std::printf("%10.0f %10.0f %10s %10.1f %10.1f %10.1f %10.1f\n", q, r.achievedQps(), hits, us(h.valueAtPercentile(50)),
+                us(h.valueAtPercentile(99)), us(h.valueAtPercentile(99.9)), us(h.max()));
+            std::fflush(stdout);
+            failures += r.failures;
+            mismatches += r.mismatches;
+        }
+    }
+    if (cl.has("verify")) std::printf("verify: %lld wrong answers\n", mismatches);
+    if (ownDaemon) printDaemonStats(localTotals);
+    if (failures) std::fprintf(stderr, "error: %lld connection(s) failed\n", failures);
+    return failures || mismatches ? 1 : 0;
+}
+
+/*
+ * live
+ * ----
+ * live publish [--name N] [--slots S] (--board B | --session FILE [--speed X]) [--outcomes]
+ *     Publishes solver results into shared memory (see live_publish.h) for overlays to read:
+ *     one board, or the board after every event of a recorded session, at the recorded pace
+ *     (--speed 2 = twice as fast, 0 = as fast as possible). --outcomes adds each cell's
+ *     outcome distribution. The last frame stays readable after the command ends.
+ * live read [--name N] [--count N] [--interval-ms MS]
+ *     Prints the newest published frame, N times (default 1) MS milliseconds apart.
+ * live verify [--readers R] [--seconds S] [--slots S]
+ *     Torn-read check: R reader processes read the newest frame over and over while a writer
+ *     publishes as fast as it can, and check that every copy is one whole frame. Fails on any
+ *     torn or out-of-order read.
+ */
+static int cmdLive(const CommandLine& cl) {
+    std::string action = cl.positional(0);
+    std::string name = cl.get("name", LIVE_DEFAULT_NAME);
+    std::string error;
+
+    if (action == "publish") {
+        LivePublisher publisher;
+        if (!publisher.open(name, (uint32_t)std::max(1LL, cl.getInt("slots", 16)), error)) {
+            std::fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+        ThrillDiggerSolver solver;
+        ExpectimaxPlanner planner;
+        publisher.attach(solver, cl.has("outcomes") ? &planner : nullptr); // Every solve() publishes
+        std::string session = cl.get("session");
+        if (session.empty()) {
+            if (!readBoard(cl, solver.grid)) return 2;
+            solver.solve();
+        } else {
+            SessionLogFile log;
+            if (!log.open(session)) {
+                std::fprintf(stderr, "error: %s is not a session log\n", session.c_str());
+                return 1;
+            }
+            double speed = cl.getDouble("speed", 1.0);
+            auto due = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < log.size(); i++) {
+                const SessionEvent& e = log.events()[i];
+                auto type = static_cast<SessionEventType>(e.type);
+                bool isSet = type == SessionEventType::SetCell && e.cell < TOTAL_CELLS &&
+                             e.content <= static_cast<uint8_t>(CellContent::Bomb);
+                if (!isSet && type != SessionEventType::Open && type != SessionEventType::Reset) continue;
+                if (speed > 0.0 && type != SessionEventType::Open) {
+                    due += std::chrono::microseconds((long long)(e.deltaUs / speed));
+                    std::this_thread::sleep_until(due);
+                }
+                if (isSet) solver.setCell(e.cell / COLS, e.cell % COLS, static_cast<CellContent>(e.content));
+                else solver.reset();
+                solver.solve();
+            }
+        }
+        std::printf("%llu frame(s) published to %s\n", (unsigned long long)publisher.published(), name.c_str());
+        return 0;
+    }
+
+    if (action == "read") {
+        LiveReader reader;
+        if (!reader.open(name, error)) {
+            std::fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+        long long count = std::max(1LL, cl.getInt("count", 1));
+        long long intervalMs = std::max(0LL, cl.getInt("interval-ms", 500));
+        LiveData d;
+        for (long long k = 0; k < count; k++) {
+            if (k > 0) std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+            if (!reader.visitLatest([&](const LiveData& src) { std::memcpy(&d, &src, sizeof(d)); })) {
+                if (!reader.segmentChanged()) {
+                    std::printf(reader.published() == 0 ? "nothing published yet\n"
+                                                        : "no whole frame readable (writer stuck mid-frame?)\n");
+                } else if (!reader.open(name, error)) { // A new writer replaced the segment
+                    std::fprintf(stderr, "error: %s\n", error.c_str());
+                    return 1;
+                } else {
+                    std::printf("segment was reset by a new writer, reopened\n");
+                }
+                continue;
+            }
+            std::array<CellContent, TOTAL_CELLS> grid = unpackBoard(PackedBoard{d.boardLo, d.boardHi});
+            std::printf("frame %llu%s  board %s  total ways %.6g\n", (unsigned long long)d.frame,
+                reader.writerAlive() ? "" : " (writer gone)", boardToText(grid).c_str(), d.totalWays);
+            for (int r = 0; r < ROWS; r++) {
+                for (int c = 0; c < COLS; c++) {
+                    int i = r * COLS + c;
+                    if (grid[i] == CellContent::Undug) std::printf(" %5.1f%%", d.badProb[i] * 100.0);
+                    else std::printf("      %c", cellContentChar(grid[i]));
+                }
+                std::printf("\n");
+            }
+            if (d.flags & LIVE_HAS_OUTCOMES) {
+                int best = -1;
+                for (int i = 0; i < TOTAL_CELLS; i++)
+                    if (grid[i] == CellContent::Undug && (best < 0 || d.badProb[i] < d.badProb[best])) best = i;
+                if (best >= 0) {
+                    std::printf("safest cell (%s):", cellName(best).c_str());
+                    for (int o = 0; o < NUM_OUTCOMES; o++)
+                        std::printf(" %c %.1f%%", cellContentChar(outcomeContent(o)), d.outcome[best][o] * 100.0);
+                    std::printf("\n");
+                }
+            }
+            std::fflush(stdout);
+        }
+        return 0;
+    }
+
+    if (action != "verify") {
+        std::fprintf(stderr, "usage: live publish|read|verify [options]\n");
+        return 2;
+    }
+    LiveVerifyConfig cfg;
+    cfg.readers = (int)std::max(1LL, cl.getInt("readers", cfg.readers));
+    cfg.seconds = cl.getDouble("seconds", cfg.seconds);
+    cfg.slots = (uint32_t)std::max(1LL, cl.getInt("slots", cfg.slots));
+    LiveVerifyResult r = runLiveVerify(cfg, error);
+    if (!error.empty()) {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+    std::printf("%llu frames published, %d reader process(es), %u slots\n", (unsigned long long)r.frames, cfg.readers, cfg.slots);
+    std::printf("checked reads:   %llu, torn %llu, out of order %llu (%llu torn copies caught and read again)\n",
+        (unsigned long long)r.checkedReads, (unsigned long long)r.checkedTorn, (unsigned long long)r.stale,
+        (unsigned long long)r.retries);
+    std::printf("unchecked reads: %llu, torn %llu (the same copy without the sequence check)\n",
+        (unsigned long long)r.uncheckedReads, (unsigned long long)r.uncheckedTorn);
+    if (r.failedReaders) std::fprintf(stderr, "error: %d reader process(es) failed\n", r.failedReaders);
+    bool ok = r.checkedTorn == 0 && r.stale == 0 && r.failedReaders == 0 && r.checkedReads > 0;
+    std::printf("%s\n", ok ? "OK: no torn reads" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+/*
+ * solve
+ * -----
+ * solve [FILE | -] [--out FILE] [--threads N] [--decimals D] [--board-echo] [--ways] [--stats]
+ *     Batch solving: reads one board per line (see board_io.h) from FILE or stdin and writes one
+ *     line per board: the 40 bad chances with D decimals (default 4), separated by spaces.
+ *     --board-echo starts each line with the board, --ways with the number of layouts.
+ *     Lines that are not boards print "invalid" (empty and '#' lines are skipped).
+ *     --stats prints, to stderr, how the time was split between parsing, solving and writing.
+ */
+static int cmdSolve(const CommandLine& cl) {
+    std::string inPath = cl.positional(0, "-");
+    BoardTextSource source;
+    if (!source.open(inPath)) {
+        std::fprintf(stderr, "error: cannot open %s\n", inPath.c_str());
+        return 1;
+    }
+    std::string outPath = cl.get("out", "-");
+    FILE* out = outPath == "-" ? stdout : std::fopen(outPath.c_str(), "wb");
+    if (!out) {
+        std::fprintf(stderr, "error: cannot create %s\n", outPath.c_str());
+        return 1;
+    }
+    bool echo = cl.has("board-echo"), ways = cl.has("ways");
+
+    // Blocks of boards: parse a block, solve it on all threads, write it
+    const size_t BLOCK = 16384;
+    BatchSolver solvers((int)std::max(1LL, cl.getInt("threads", 1)));
+    BoardLineParser parser;
+    std::vector<PackedBoard> boards;
+    std::vector<uint8_t> invalid(BLOCK);
+    std::vector<BoardResultF64> results(BLOCK); // Doubles: up to 9 decimals are printed
+    boards.reserve(BLOCK);
+    long long count = 0;
+    double parseSeconds = 0.0, solveSeconds = 0.0, writeSeconds = 0.0;
+    using Clock = std::chrono::steady_clock;
+    auto seconds = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double>(b - a).count(); };
+    bool writeFailed = false;
+    {
+        ProbabilityWriter writer(out, (int)cl.getInt("decimals", 4));
+        char text[TOTAL_CELLS];
+        for (;;) {
+            Clock::time_point t0 = Clock::now();
+            boards.clear();
+            if (!source.next(parser, boards, BLOCK)) break;
+            for (size_t i = 0; i < boards.size(); i++) {
+                invalid[i] = boards[i] == INVALID_BOARD;
+                if (invalid[i]) boards[i] = PackedBoard{}; // Solved as an empty board, printed as "invalid"
+            }
+            Clock::time_point t1 = Clock::now();
+            solvers.solveBatch(boards.data(), boards.size(), results.data());
+            Clock::time_point t2 = Clock::now();
+            for (size_t i = 0; i < boards.size(); i++) {
+                writer.reserveLine();
+                if (invalid[i]) {
+                    writer.text("invalid\n", 8);
+                    continue;
+                }
+                if (echo) {
+                    std::array<CellContent, TOTAL_CELLS> grid = unpackBoard(boards[i]);
+                    for (int c = 0; c < TOTAL_CELLS; c++) text[c] = cellContentChar(grid[c]);
+                    writer.text(text, TOTAL_CELLS);
+                    writer.character(' ');
+                }
+                if (ways) {
+                    writer.integer((uint64_t)results[i].totalWays); // Whole numbers below 2^53 on this board
+                    writer.character(' ');
+                }
+                for (int c = 0; c < TOTAL_CELLS; c++) {
+                    if (c) writer.character(' ');
+                    writer.probability(results[i].badProb[c]);
+                }
+                writer.character('\n');
+            }
+            Clock::time_point t3 = Clock::now();
+            parseSeconds += seconds(t0, t1);
+            solveSeconds += seconds(t1, t2);
+            writeSeconds += seconds(t2, t3);
+            count += (long long)boards.size();
+            if (!writer.ok()) break;
+        }
+        writeFailed = !writer.flush();
+    }
+    if (out != stdout) writeFailed |= std::fclose(out) != 0;
+    else writeFailed |= std::fflush(out) != 0;
+
+    if (cl.has("stats")) {
+        double total = parseSeconds + solveSeconds + writeSeconds;
+        std::fprintf(stderr, "%lld boards (%lld lines) in %.3f s = %.0f boards/s\n", count, parser.lines, total,
+            total > 0.0 ? count / total : 0.0);
+        std::fprintf(stderr, "parse %.3f s (%.1f%%)  solve %.3f s (%.1f%%)  write %.3f s (%.1f%%)\n",
+            parseSeconds, total > 0.0 ? 100.0 * parseSeconds / total : 0.0,
+            solveSeconds, total > 0.0 ? 100.0 * solveSeconds / total : 0.0,
+            writeSeconds, total > 0.0 ? 100.0 * writeSeconds / total : 0.0);
+    }
+    if (parser.invalid) {
+        std::fprintf(stderr, "warning: %lld line(s) are not boards (first: line %lld)\n", parser.invalid, parser.firstInvalidLine);
+    }
+    if (writeFailed) {
+        std::fprintf(stderr, "error: writing the output failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Table of sub-commands
+struct Command {
+    const char* name;
+    int (*run)(const CommandLine&);
+    const char* help;
+};
+
+static const Command COMMANDS[] = {
+    {"policy", cmdPolicy, "policy solve|query --board B ...   exact optimal policy (offline DP)"},
+    {"gen", cmdGen,       "gen [--seed S] [--count N] [--print] seedable random boards"},
+    {"tournament", cmdTournament, "tournament [--strategies safest,ev,info,mcts] [--games N] compare strategies"},
+    {"shard", cmdShard,   "shard run|launch|merge ...          multi-process tournament with shard files"},
+    {"session", cmdSession, "session record|replay ...          record / replay board sessions (benchmark)"},
+    {"stress", cmdStress, "stress search|bench|profile ...     worst-case positions for the solver"},
+    {"advise", cmdAdvise, "advise --board B [--samples N]     stop-or-continue advice"},
+    {"daemon", cmdDaemon, "daemon serve|bench ...              board server on a Unix socket, with load test"},
+    {"exact", cmdExact,   "exact --board B [--threads N] [--primes N] exact layout counts (modular + CRT)"},
+    {"solve", cmdSolve,   "solve [FILE|-] [--out FILE] [--threads N] batch-solve one board per line"},
+    {"live", cmdLive,     "live publish|read|verify ...        results in shared memory for overlays"},
+};
+
+static void printUsage() {
+    std::fprintf(stderr, "usage: ThrillDiggerCLI <command> [options]\n\ncommands:\n");
+    for (const Command& c : COMMANDS) std::fprintf(stderr, "  %s\n", c.help);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+    globalAllocCounter = countedNew;
+    CommandLine cl;
+    cl.program = argv[0];
+    for (int i = 2; i < argc; i++) cl.args.push_back(argv[i]);
+    for (const Command& c : COMMANDS) {
+        if (std::strcmp(argv[1], c.name) == 0) return c.run(cl);
+    }
+    std::fprintf(stderr, "unknown command: %s\n\n", argv[1]);
+    printUsage();
+    return 2;
+}
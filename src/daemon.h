@@ -0,0 +1,653 @@
+/*
+=================================================================================================
+FILE: src/daemon.h
+
+DESCRIPTION:
+This file turns the solver into a local server ("daemon"): other programs connect to a Unix
+domain socket, send boards in a small binary format and get the probabilities back.
+It also contains the matching client.
+
+IMPORTANCE:
+A stream-overlay backend serves the boards of many viewers at once. Starting a process per
+board, or linking the solver into every service, wastes time and memory. One daemon per
+machine keeps its solvers and its result cache warm, and answers each board in microseconds.
+
+INTERACTION:
+- Includes "solver.h" (the solver, PackedBoard, canonicalBoard).
+- Driven by the `daemon` command of `src/cli.cpp` (serve / bench).
+- Linux only (epoll, timerfd). On other systems `SolverDaemon::start` fails with a message.
+
+PROTOCOL (little-endian, no handshake, any number of requests in flight per connection):
+- Request, 24 bytes: id (uint32, echoed back), reserved (uint32, 0), board as PackedBoard
+  (lo, hi: uint64 each, 3 bits per cell).
+- Response, 176 bytes: id, status (0 = ok, 1 = contradictory board), totalWays (double),
+  then the bad probability of each of the 40 cells (float).
+- The responses of one connection come back in the order of its requests.
+
+HOW IT WORKS:
+1. One thread runs an epoll event loop over the listening socket, every connection and a timer.
+2. Requests are not solved one by one: they wait in a "micro-batch". The first request of a
+   batch starts the timer (a few hundred microseconds); when it fires, or the batch is full,
+   the whole batch goes to `BatchSolver::solveBatch` at once.
+3. Before that, each board is looked up in a result cache (mirror images share an entry), and
+   identical boards within the batch are solved only once.
+4. solveBatch spreads the remaining boards over a pool of worker threads, each with its own
+   solver, and returns when all are done. The answers are then written back.
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// =================================================================================================
+// PROTOCOL
+// =================================================================================================
+
+struct DaemonRequest {
+    uint32_t id;       // Chosen by the client, echoed in the response
+    uint32_t reserved; // 0
+    uint64_t lo, hi;   // PackedBoard
+};
+static_assert(sizeof(DaemonRequest) == 24, "daemon request layout");
+
+enum class DaemonStatus : uint32_t {
+    Ok = 0,
+    Contradictory = 1 // No layout fits the board; the probabilities are the solver's fallback
+};
+
+struct DaemonResponse {
+    uint32_t id;
+    uint32_t status; // DaemonStatus
+    double totalWays;
+    float badProb[TOTAL_CELLS];
+};
+static_assert(sizeof(DaemonResponse) == 176, "daemon response layout");
+
+// What the daemon keeps per solved board
+struct BoardResult {
+    double totalWays = 0.0;
+    float badProb[TOTAL_CELLS] = {};
+};
+
+// The same at full precision, for callers that print more digits than a float holds
+struct BoardResultF64 {
+    double totalWays = 0.0;
+    double badProb[TOTAL_CELLS] = {};
+};
+
+inline void fillResponse(DaemonResponse& r, uint32_t id, const BoardResult& result) {
+    r.id = id;
+    r.status = static_cast<uint32_t>(result.totalWays > 0.0 ? DaemonStatus::Ok : DaemonStatus::Contradictory);
+    r.totalWays = result.totalWays;
+    std::memcpy(r.badProb, result.badProb, sizeof(r.badProb));
+}
+
+// =================================================================================================
+// BATCH SOLVING
+// =================================================================================================
+
+/*
+ * BatchSolver
+ * -----------
+ * Solves many boards at once on a fixed pool of threads (the calling thread is one of them).
+ * The workers sleep between batches, so a batch costs one wake-up per thread instead of
+ * starting new threads every few hundred microseconds.
+ */
+class BatchSolver {
+public:
+    explicit BatchSolver(int threads = 1) {
+        int n = std::max(1, threads);
+        for (int t = 0; t < n; t++) solvers.push_back(std::make_unique<ThrillDiggerSolver>());
+        for (int t = 1; t < n; t++) workers.emplace_back([this, t] { workerLoop(*solvers[t]); });
+    }
+
+    ~BatchSolver() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    BatchSolver(const BatchSolver&) = delete;
+    BatchSolver& operator=(const BatchSolver&) = delete;
+
+    int threads() const { return (int)solvers.size(); }
+
+    // results[i] = the solution of boards[i] (Result: BoardResult or BoardResultF64)
+    template <class Result>
+    void solveBatch(const PackedBoard* boards, size_t n, Result* results) {
+        if (n == 0) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobBoards = boards;
+            jobResults = results;
+            jobSolve = [](ThrillDiggerSolver& solver, const PackedBoard& board, void* out, size_t i) {
+                solveOne(solver, board, static_cast<Result*>(out)[i]);
+            };
+            jobSize = n;
+            next.store(0);
+            running = (int)workers.size();
+            generation++;
+        }
+        if (!workers.empty()) wake.notify_all();
+        work(*solvers[0]);
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return running == 0; });
+    }
+
+    template <class Result>
+    static void solveOne(ThrillDiggerSolver& solver, const PackedBoard& board, Result& out) {
+        solver.grid = unpackBoard(board);
+        solver.solve();
+        out.totalWays = solver.totalWays;
+        using Prob = std::remove_extent_t<decltype(Result::badProb)>; // float or double
+        for (int i = 0; i < TOTAL_CELLS; i++) out.badProb[i] = static_cast<Prob>(solver.badProb[i]);
+    }
+
+private:
+    std::vector<std::unique_ptr<ThrillDiggerSolver>> solvers; // solvers[0]: the calling thread
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    const PackedBoard* jobBoards = nullptr;
+    void* jobResults = nullptr; // A Result array; jobSolve knows which type
+    void (*jobSolve)(ThrillDiggerSolver&, const PackedBoard&, void*, size_t) = nullptr;
+    size_t jobSize = 0;
+    std::atomic<size_t> next{0};
+    int running = 0;          // Workers still busy with the current batch
+    uint64_t generation = 0;  // Batches started so far
+    bool stopping = false;
+
+    void work(ThrillDiggerSolver& solver) {
+        for (size_t i; (i = next.fetch_add(1)) < jobSize;) jobSolve(solver, jobBoards[i], jobResults, i);
+    }
+
+    void workerLoop(ThrillDiggerSolver& solver) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            work(solver);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--running == 0) finished.notify_one();
+        }
+    }
+};
+
+/*
+ * ResultCache
+ * -----------
+ * Direct-mapped cache of solved boards: each board has exactly one slot (by hash of its
+ * canonical form), and a new board simply overwrites what was there. No eviction lists, no
+ * allocation after construction. Results are stored in canonical orientation.
+ */
+class ResultCache {
+public:
+    explicit ResultCache(size_t entries = 0) {
+        size_t n = 1;
+        while (n < entries) n <<= 1;
+        if (entries > 0) slots.resize(n);
+    }
+
+    bool find(const PackedBoard& canonical, BoardResult& out) const {
+        if (slots.empty()) return false;
+        const Slot& s = slots[slotOf(canonical)];
+        if (!s.used || s.key != canonical) return false;
+        out = s.result;
+        return true;
+    }
+
+    void insert(const PackedBoard& canonical, const BoardResult& result) {
+        if (slots.empty()) return;
+        Slot& s = slots[slotOf(canonical)];
+        s.key = canonical;
+        s.result = result;
+        s.used = true;
+    }
+
+private:
+    struct Slot {
+        PackedBoard key;
+        bool used = false;
+        BoardResult result;
+    };
+    std::vector<Slot> slots;
+
+    size_t slotOf(const PackedBoard& key) const { return PackedBoardHash()(key) & (slots.size() - 1); }
+};
+
+// Maps a result between a board and its canonical form (every symmetry is its own inverse)
+inline BoardResult applySymmetry(const BoardResult& r, int sym) {
+    BoardResult out;
+    out.totalWays = r.totalWays;
+    for (int i = 0; i < TOTAL_CELLS; i++) out.badProb[symmetryCell(i, sym)] = r.badProb[i];
+    return out;
+}
+
+// =================================================================================================
+// SERVER
+// =================================================================================================
+
+struct DaemonConfig {
+    std::string socketPath = "/tmp/thrilldigger.sock";
+    int threads = 1;              // Solver threads
+    int batchMicros = 200;        // How long the first request of a batch waits for company
+    int maxBatch = 256;           // A batch this big is solved at once
+    size_t cacheEntries = 1 << 16;
+};
+
+struct DaemonStats {
+    long long connections = 0;
+    long long requests = 0;
+    long long batches = 0;
+    long long cacheHits = 0;
+    long long duplicates = 0; // Same board twice in one batch, solved once
+    long long solved = 0;     // Boards actually solved
+};
+
+class SolverDaemon {
+public:
+    explicit SolverDaemon(const DaemonConfig& cfg)
+        : cfg(cfg), solver(cfg.threads), cache(cfg.cacheEntries) {}
+
+    ~SolverDaemon() { shutdown(); }
+
+    SolverDaemon(const SolverDaemon&) = delete;
+    SolverDaemon& operator=(const SolverDaemon&) = delete;
+
+    // Creates the socket (replacing a stale socket file) and starts listening
+    bool start(std::string& error) {
+#ifdef __linux__
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (cfg.socketPath.size() >= sizeof(addr.sun_path)) {
+            error = "socket path too long";
+            return false;
+        }
+        std::memcpy(addr.sun_path, cfg.socketPath.c_str(), cfg.socketPath.size() + 1);
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        ::unlink(cfg.socketPath.c_str());
+        if (listenFd < 0 || ::bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listenFd, 128) < 0) {
+            error = std::string("cannot listen on ") + cfg.socketPath + ": " + std::strerror(errno);
+            shutdown();
+            return false;
+        }
+        epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        timerFd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (epollFd < 0 || timerFd < 0) {
+            error = std::string("epoll/timerfd: ") + std::strerror(errno);
+            shutdown();
+            return false;
+        }
+        watch(listenFd, EPOLLIN);
+        watch(timerFd, EPOLLIN);
+        return true;
+#else
+        error = "the daemon needs Linux (epoll, Unix domain sockets)";
+        return false;
+#endif
+    }
+
+    // Serves until `stop` becomes true (checked at least every 100 ms)
+    void run(const std::atomic<bool>& stop) {
+#ifdef __linux__
+        epoll_event events[64];
+        while (!stop.load()) {
+            int n = ::epoll_wait(epollFd, events, 64, 100);
+            for (int e = 0; e < n; e++) {
+                int fd = events[e].data.fd;
+                if (fd == listenFd) {
+                    acceptAll();
+                } else if (fd == timerFd) {
+                    uint64_t expirations;
+                    if (::read(timerFd, &expirations, sizeof(expirations)) > 0) flush();
+                } else {
+                    serviceConnection(fd, events[e].events);
+                }
+            }
+        }
+        flush();
+#else
+        (void)stop;
+#endif
+    }
+
+    const DaemonStats& stats() const { return counters; }
+    int solverThreads() const { return solver.threads(); }
+
+private:
+    struct Connection {
+        uint64_t serial = 0;        // Tells a connection from a later one that reuses its fd
+        std::vector<uint8_t> in;    // Received bytes not yet forming a whole request
+        std::vector<uint8_t> out;   // Response bytes not yet sent
+        size_t outPos = 0;
+        bool waitingToSend = false; // Watching EPOLLOUT instead of EPOLLIN
+    };
+    struct Pending {
+        int fd;
+        uint64_t serial;
+        uint32_t id;
+        PackedBoard canonical;
+        int sym;
+        int slot; // Index into batchResults
+    };
+
+    DaemonConfig cfg;
+    BatchSolver solver;
+    ResultCache cache;
+    DaemonStats counters;
+    int listenFd = -1, epollFd = -1, timerFd = -1;
+    uint64_t nextSerial = 1;
+    std::unordered_map<int, Connection> connections;
+
+    // The current batch (reused between batches)
+    std::vector<Pending> pending;
+    std::vector<BoardResult> batchResults;  // One per distinct board of the batch
+    std::vector<PackedBoard> missBoards;    // Distinct boards not in the cache...
+    std::vector<int> missSlots;             // ...their index in batchResults...
+    std::vector<BoardResult> missResults;   // ...and their solutions
+    std::unordered_map<PackedBoard, int, PackedBoardHash> batchIndex;
+    std::vector<int> touched;               // Connections that got answers
+    std::vector<DaemonRequest> received;    // Requests of one recv(), see serviceConnection
+
+    void shutdown() {
+#ifdef __linux__
+        for (auto& c : connections) ::close(c.first);
+        connections.clear();
+        for (int* fd : {&listenFd, &epollFd, &timerFd}) {
+            if (*fd >= 0) ::close(*fd);
+            *fd = -1;
+        }
+        if (!cfg.socketPath.empty()) ::unlink(cfg.socketPath.c_str());
+#endif
+    }
+
+#ifdef __linux__
+    void watch(int fd, uint32_t events, int op = EPOLL_CTL_ADD) {
+        epoll_event ev = {};
+        ev.events = events;
+        ev.data.fd = fd;
+        ::epoll_ctl(epollFd, op, fd, &ev);
+    }
+
+    void acceptAll() {
+        for (;;) {
+            int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            Connection& c = connections[fd];
+            c = Connection();
+            c.serial = nextSerial++;
+            watch(fd, EPOLLIN);
+            counters.connections++;
+        }
+    }
+
+    void closeConnection(int fd) {
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections.erase(fd);
+    }
+
+    void serviceConnection(int fd, uint32_t events) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& c = it->second;
+        if (events & EPOLLOUT) {
+            if (!sendPending(fd, c)) return;
+        }
+        if (!(events & (EPOLLIN | EPOLLHUP | EPOLLERR))) return;
+
+        uint8_t buf[1 << 14];
+        ssize_t got = ::recv(fd, buf, sizeof(buf), 0);
+        if (got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR)) {
+            closeConnection(fd);
+            return;
+        }
+        if (got < 0) return;
+        c.in.insert(c.in.end(), buf, buf + got);
+
+        // Take the whole requests out first: enqueue() can flush the batch, and sending its
+        // answers can close this connection (erasing `c`)
+        size_t whole = c.in.size() / sizeof(DaemonRequest);
+        received.resize(whole);
+        if (whole > 0) std::memcpy(received.data(), c.in.data(), whole * sizeof(DaemonRequest));
+        c.in.erase(c.in.begin(), c.in.begin() + whole * sizeof(DaemonRequest));
+        uint64_t serial = c.serial;
+        for (const DaemonRequest& req : received) enqueue(fd, serial, req); // `c` may be gone now
+    }
+
+    void enqueue(int fd, uint64_t serial, const DaemonRequest& req) {
+        counters.requests++;
+        PackedBoard board;
+        board.lo = req.lo;
+        board.hi = req.hi;
+        Pending p;
+        p.fd = fd;
+        p.serial = serial;
+        p.id = req.id;
+        p.canonical = canonicalBoard(unpackBoard(board), &p.sym);
+        p.slot = -1;
+        pending.push_back(p);
+        if (pending.size() == 1) armTimer();
+        if ((int)pending.size() >= cfg.maxBatch) flush();
+    }
+
+    void armTimer() {
+        itimerspec t = {};
+        long long ns = std::max(1LL, (long long)cfg.batchMicros * 1000);
+        t.it_value.tv_sec = ns / 1000000000;
+        t.it_value.tv_nsec = ns % 1000000000;
+        ::timerfd_settime(timerFd, 0, &t, nullptr);
+    }
+
+    // Solves the current batch and queues every answer
+    void flush() {
+        if (pending.empty()) return;
+        itimerspec off = {};
+        ::timerfd_settime(timerFd, 0, &off, nullptr);
+        counters.batches++;
+
+        // Cache and in-batch duplicates first; only the rest is solved
+        batchResults.clear();
+        missBoards.clear();
+        missSlots.clear();
+        batchIndex.clear();
+        for (Pending& p : pending) {
+            auto dup = batchIndex.find(p.canonical);
+            if (dup != batchIndex.end()) {
+                p.slot = dup->second;
+                counters.duplicates++;
+                continue;
+            }
+            p.slot = (int)batchResults.size();
+            batchIndex.emplace(p.canonical, p.slot);
+            batchResults.emplace_back();
+            if (cache.find(p.canonical, batchResults.back())) {
+                counters.cacheHits++;
+            } else {
+                missBoards.push_back(p.canonical);
+                missSlots.push_back(p.slot);
+            }
+        }
+
+        missResults.resize(missBoards.size());
+        solver.solveBatch(missBoards.data(), missBoards.size(), missResults.data());
+        counters.solved += (long long)missBoards.size();
+        for (size_t m = 0; m < missBoards.size(); m++) {
+            batchResults[missSlots[m]] = missResults[m];
+            cache.insert(missBoards[m], missResults[m]);
+        }
+
+        touched.clear();
+        for (const Pending& p : pending) {
+            auto it = connections.find(p.fd);
+            if (it == connections.end() || it->second.serial != p.serial) continue; // Client left
+            Connection& c = it->second;
+            if (c.out.empty()) touched.push_back(p.fd);
+            DaemonResponse r;
+            fillResponse(r, p.id, applySymmetry(batchResults[p.slot], p.sym));
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&r);
+            c.out.insert(c.out.end(), bytes, bytes + sizeof(r));
+        }
+        pending.clear();
+        for (int fd : touched) {
+            auto it = connections.find(fd);
+            if (it != connections.end() && !it->second.waitingToSend) sendPending(fd, it->second);
+        }
+    }
+
+    // Sends what the socket takes; waits for EPOLLOUT (and stops reading) while output is
+    // left, which also pushes back on a client that doesn't read its answers.
+    bool sendPending(int fd, Connection& c) {
+        while (c.outPos < c.out.size()) {
+            ssize_t sent = ::send(fd, c.out.data() + c.outPos, c.out.size() - c.outPos, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if (!c.waitingToSend) watch(fd, EPOLLOUT, EPOLL_CTL_MOD);
+                    c.waitingToSend = true;
+                    return true;
+                }
+                if (errno == EINTR) continue;
+                closeConnection(fd);
+                return false;
+            }
+            c.outPos += (size_t)sent;
+        }
+        c.out.clear();
+        c.outPos = 0;
+        if (c.waitingToSend) watch(fd, EPOLLIN, EPOLL_CTL_MOD);
+        c.waitingToSend = false;
+        return true;
+    }
+#endif
+};
+
+// =================================================================================================
+// CLIENT
+// =================================================================================================
+
+/*
+ * DaemonClient
+ * ------------
+ * Blocking client for one connection. Requests may be pipelined: send several, then receive
+ * their answers in the same order.
+ */
+class DaemonClient {
+public:
+    DaemonClient() = default;
+    ~DaemonClient() { close(); }
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+
+    bool connect(const std::string& path) {
+        close();
+#ifdef __linux__
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) return false;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            close();
+            return false;
+        }
+        return true;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    void close() {
+#ifdef __linux__
+        if (fd >= 0) ::close(fd);
+#endif
+        fd = -1;
+    }
+
+    // Makes blocked send() / receive() calls (e.g. on another thread) fail
+    void interrupt() {
+#ifdef __linux__
+        if (fd >= 0) ::shutdown(fd, SHUT_RDWR);
+#endif
+    }
+
+    bool send(const DaemonRequest* requests, size_t n) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(requests);
+        size_t size = n * sizeof(DaemonRequest);
+        while (size > 0) {
+            long long k = io(const_cast<uint8_t*>(p), size, true);
+            if (k <= 0) return false;
+            p += k;
+            size -= (size_t)k;
+        }
+        return true;
+    }
+
+    bool receive(DaemonResponse& response) {
+        uint8_t* p = reinterpret_cast<uint8_t*>(&response);
+        size_t size = sizeof(response);
+        while (size > 0) {
+            long long k = io(p, size, false);
+            if (k <= 0) return false;
+            p += k;
+            size -= (size_t)k;
+        }
+        return true;
+    }
+
+    static DaemonRequest request(uint32_t id, const std::array<CellContent, TOTAL_CELLS>& grid) {
+        PackedBoard b = packBoard(grid);
+        DaemonRequest r = {};
+        r.id = id;
+        r.lo = b.lo;
+        r.hi = b.hi;
+        return r;
+    }
+
+private:
+    int fd = -1;
+
+    // One send or recv (retried on signals): bytes moved, 0 on end of stream, < 0 on error
+    long long io(uint8_t* p, size_t size, bool sending) {
+#ifdef __linux__
+        for (;;) {
+            ssize_t n = sending ? ::send(fd, p, size, MSG_NOSIGNAL) : ::recv(fd, p, size, 0);
+            if (n < 0 && errno == EINTR) continue;
+            return n;
+        }
+#else
+        (void)p;
+        (void)size;
+        (void)sending;
+        return -1;
+#endif
+    }
+};
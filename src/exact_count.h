@@ -0,0 +1,365 @@
+/*
+=================================================================================================
+FILE: src/exact_count.h
+
+DESCRIPTION:
+This file computes the solver's layout counts EXACTLY: the number of hidden layouts consistent
+with the board, and for every undug cell the number of layouts in which it is bad, as big
+integers of any size. The probabilities are then exact ratios of these integers.
+
+IMPORTANCE:
+The normal solver counts in doubles. Its results are exact on the 40-cell board (every count
+is below 2^53), but a large board has counts with hundreds of digits, and the scaled arithmetic
+used there (solver.h, combineScaled) is only accurate to about 15 digits. Exact counts make
+large-board results reproducible bit for bit and give a reference to test the fast paths
+against.
+
+INTERACTION:
+- Reads the component count tables the solver keeps after `solve()` (`componentResults`,
+  `countsOf`, `badCountsOf`, `interiorCells`): call `solve()` first, then `countExactly`.
+- Multiplies the polynomials with the `PolyProductTree` of `src/poly_product.h`.
+- Used by the `exact` command of `src/cli.cpp`.
+
+ALGORITHM OVERVIEW:
+Big integers in the inner loops would be slow, so everything is counted modulo several primes
+just below 2^61 instead, where each multiplication is one 128-bit product and one division.
+1. How many primes: every count is at most C(unknown cells, bad) < 2^(unknown cells), and the
+   product of the primes must be larger than that, so one prime per 60 unknown cells (+1).
+2. Per prime (each on its own thread): Steps 6-8 of solve() again, in arithmetic mod p.
+3. Chinese remainder theorem (Garner's algorithm): from the residues of a count modulo every
+   prime, rebuild the one integer below their product with those residues. That is the count.
+   Only this last step uses big integers, once per count.
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include "poly_product.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// =================================================================================================
+// 64-BIT MODULAR ARITHMETIC
+// =================================================================================================
+
+// Full 128-bit product of a and b: returns the low half, puts the high half in `hi`
+inline uint64_t mulFull(uint64_t a, uint64_t b, uint64_t& hi) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _umul128(a, b, &hi);
+#else
+    unsigned __int128 r = (unsigned __int128)a * b;
+    hi = (uint64_t)(r >> 64);
+    return (uint64_t)r;
+#endif
+}
+
+// (hi * 2^64 + lo) / d, with the remainder in `rem`. Requires hi < d.
+inline uint64_t divFull(uint64_t hi, uint64_t lo, uint64_t d, uint64_t& rem) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _udiv128(hi, lo, d, &rem);
+#else
+    unsigned __int128 n = (unsigned __int128)hi << 64 | lo;
+    rem = (uint64_t)(n % d);
+    return (uint64_t)(n / d);
+#endif
+}
+
+// a * b mod p (a, b < p)
+inline uint64_t mulMod(uint64_t a, uint64_t b, uint64_t p) {
+    uint64_t hi, rem;
+    uint64_t lo = mulFull(a, b, hi);
+    divFull(hi, lo, p, rem);
+    return rem;
+}
+
+inline uint64_t addMod(uint64_t a, uint64_t b, uint64_t p) {
+    uint64_t s = a + b; // No overflow: a, b < p < 2^63
+    return s >= p ? s - p : s;
+}
+
+inline uint64_t powMod(uint64_t a, uint64_t e, uint64_t p) {
+    uint64_t r = 1 % p;
+    for (a %= p; e; e >>= 1) {
+        if (e & 1) r = mulMod(r, a, p);
+        a = mulMod(a, a, p);
+    }
+    return r;
+}
+
+// Modular inverse by Fermat's little theorem (p prime, a not a multiple of p)
+inline uint64_t invMod(uint64_t a, uint64_t p) { return powMod(a, p - 2, p); }
+
+// Deterministic Miller-Rabin: these 12 bases are enough for every 64-bit number
+inline bool isPrime64(uint64_t n) {
+    static const uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    if (n < 2) return false;
+    for (uint64_t b : bases) {
+        if (n % b == 0) return n == b;
+    }
+    uint64_t d = n - 1;
+    int s = 0;
+    for (; (d & 1) == 0; d >>= 1) s++;
+    for (uint64_t b : bases) {
+        uint64_t x = powMod(b, d, n);
+        if (x == 1 || x == n - 1) continue;
+        bool composite = true;
+        for (int i = 1; i < s && composite; i++) {
+            x = mulMod(x, x, n);
+            if (x == n - 1) composite = false;
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+// The `count` largest primes below 2^61 (the first is 2^61 - 1). Every one is above 2^60.
+inline std::vector<uint64_t> modularPrimes(size_t count) {
+    std::vector<uint64_t> primes;
+    for (uint64_t n = (uint64_t(1) << 61) - 1; primes.size() < count; n -= 2) {
+        if (isPrime64(n)) primes.push_back(n);
+    }
+    return primes;
+}
+
+// =================================================================================================
+// BIG INTEGERS (only what the CRT and the output need)
+// =================================================================================================
+
+/*
+ * BigCount
+ * --------
+ * An unsigned integer of any size: 64-bit "digits" (limbs), least significant first.
+ */
+class BigCount {
+public:
+    BigCount(uint64_t v = 0) {
+        if (v) limbs.push_back(v);
+    }
+
+    bool isZero() const { return limbs.empty(); }
+
+    // *this = *this * m + a
+    void mulAdd(uint64_t m, uint64_t a) {
+        uint64_t carry = a;
+        for (uint64_t& limb : limbs) {
+            uint64_t hi;
+            uint64_t lo = mulFull(limb, m, hi);
+            lo += carry;
+            hi += lo < carry; // Carry out of the addition (hi can't overflow: hi < m)
+            limb = lo;
+            carry = hi;
+        }
+        if (carry) limbs.push_back(carry);
+    }
+
+    // Divides by d, returns the remainder
+    uint64_t divSmall(uint64_t d) {
+        uint64_t rem = 0;
+        for (size_t i = limbs.size(); i-- > 0;) limbs[i] = divFull(rem, limbs[i], d, rem);
+        while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+        return rem;
+    }
+
+    int bitLength() const {
+        if (limbs.empty()) return 0;
+        int bits = 64 * (int)(limbs.size() - 1);
+        for (uint64_t top = limbs.back(); top; top >>= 1) bits++;
+        return bits;
+    }
+
+    // The value times 2^-shift as a double
+    double scaled(int shift) const {
+        double v = 0.0;
+        for (size_t i = limbs.size(); i-- > 0;) v += std::ldexp((double)limbs[i], 64 * (int)i - shift);
+        return v;
+    }
+
+    // a / b as a double (0 if b is 0), even when both are far too big for a double
+    static double ratio(const BigCount& a, const BigCount& b) {
+        if (b.isZero()) return 0.0;
+        int shift = std::max(0, b.bitLength() - 512);
+        return a.scaled(shift) / b.scaled(shift);
+    }
+
+    std::string toString() const {
+        if (limbs.empty()) return "0";
+        const uint64_t CHUNK = 10000000000000000000ull; // 10^19, the largest power of 10 in 64 bits
+        BigCount rest = *this;
+        std::vector<uint64_t> chunks;
+        while (!rest.isZero()) chunks.push_back(rest.divSmall(CHUNK));
+        std::string s = std::to_string(chunks.back());
+        for (size_t i = chunks.size() - 1; i-- > 0;) {
+            std::string part = std::to_string(chunks[i]);
+            s += std::string(19 - part.size(), '0') + part;
+        }
+        return s;
+    }
+
+private:
+    std::vector<uint64_t> limbs;
+};
+
+// =================================================================================================
+// EXACT COUNTING
+// =================================================================================================
+
+struct ExactCounts {
+    bool complete = false; // False if a component was too big to enumerate (no count table)
+    int primes = 0;        // Number of primes used
+    int threads = 0;       // Threads that counted them
+    BigCount totalWays;    // Layouts consistent with the board
+    std::array<BigCount, TOTAL_CELLS> badWays; // Layouts in which the cell is bad (undug cells)
+
+    double probability(int cell) const { return BigCount::ratio(badWays[cell], totalWays); }
+};
+
+/*
+ * countModPrime
+ * -------------
+ * Steps 6-8 of solve() modulo p. out[0] = total layouts, out[1 + cell] = layouts with the cell
+ * bad. The solver's count tables hold exact integers (at most 2^40 here), so reducing them mod
+ * p loses nothing.
+ */
+inline void countModPrime(const ThrillDiggerSolver& solver, uint64_t p, std::vector<uint64_t>& out) {
+    using Poly = std::vector<uint64_t>;
+    const std::vector<ComponentResult>& comps = solver.componentResults;
+    const std::vector<int>& interior = solver.interiorCells;
+    int numInterior = (int)interior.size();
+    int remainingBad = solver.remainingBadCount;
+    out.assign(1 + TOTAL_CELLS, 0);
+
+    // C(n, 0..n) mod p, by C(n, m) = C(n, m - 1) * (n - m + 1) / m (p > n, so m is invertible)
+    auto binomialRowMod = [p](int n) {
+        Poly row(n + 1);
+        row[0] = 1;
+        for (int m = 1; m <= n; m++) row[m] = mulMod(mulMod(row[m - 1], (uint64_t)(n - m + 1), p), invMod(m, p), p);
+        return row;
+    };
+    // Products stop at degree remainingBad, the only one of the total that is read
+    const size_t keep = static_cast<size_t>(std::max(remainingBad, 0)) + 1;
+    auto mulAdd = [p](uint64_t sum, uint64_t x, uint64_t y) { return addMod(sum, mulMod(x, y, p), p); };
+    auto mul = [keep, mulAdd](const Poly& a, const Poly& b) {
+        Poly r(std::min(a.size() + b.size() - 1, keep), 0);
+        middleProduct(a, b, 0, r, mulAdd);
+        return r;
+    };
+    auto middle = [mulAdd](const Poly& a, const Poly& b, size_t offset, size_t count) {
+        Poly r(count, 0);
+        middleProduct(a, b, offset, r, mulAdd);
+        return r;
+    };
+
+    // Leaves: the interior first, then every component
+    std::pmr::vector<Poly> leaves;
+    std::vector<int> leafOfComp(comps.size(), -1);
+    leaves.push_back(binomialRowMod(numInterior));
+    for (size_t i = 0; i < comps.size(); i++) {
+        CountSpan counts = solver.countsOf(comps[i]);
+        Poly leaf(counts.size());
+        for (size_t k = 0; k < counts.size(); k++) leaf[k] = (uint64_t)counts[k] % p;
+        leafOfComp[i] = (int)leaves.size();
+        leaves.push_back(std::move(leaf));
+    }
+    PolyProductTree<Poly> tree;
+    tree.build(leaves, mul);
+    const Poly& totalPoly = tree.product();
+    if (remainingBad < 0 || remainingBad >= (int)totalPoly.size()) return;
+    out[0] = totalPoly[remainingBad];
+    tree.buildLeaveOneOut(middle, Poly(1, 1), (size_t)remainingBad);
+
+    // Frontier cells: layouts of the component with the cell bad x layouts of everything else
+    for (size_t ci = 0; ci < comps.size(); ci++) {
+        const ComponentResult& cr = comps[ci];
+        const Poly& without = tree.without(leafOfComp[ci]);
+        int low = (int)tree.withoutLow(leafOfComp[ci]); // Degree of without[0]
+        for (int li = 0; li < cr.size; li++) {
+            const double* cellBad = solver.badCountsOf(cr, li);
+            uint64_t ways = 0;
+            for (int k = 0; k <= cr.size && k <= remainingBad; k++) {
+                int rest = remainingBad - k;
+                if (rest >= low && rest - low < (int)without.size()) {
+                    ways = addMod(ways, mulMod((uint64_t)cellBad[k] % p, without[rest - low], p), p);
+                }
+            }
+            out[1 + cr.cells[li]] = ways;
+        }
+    }
+
+    // Interior cells: the cell is bad, the other n - 1 interior cells hold m - 1
+    if (numInterior > 0) {
+        Poly row = binomialRowMod(numInterior - 1);
+        const Poly& compProd = tree.without(0);
+        int low = (int)tree.withoutLow(0);
+        uint64_t ways = 0;
+        for (int m = 1; m <= numInterior && m <= remainingBad; m++) {
+            int rest = remainingBad - m;
+            if (rest >= low && rest - low < (int)compProd.size()) {
+                ways = addMod(ways, mulMod(row[m - 1], compProd[rest - low], p), p);
+            }
+        }
+        for (int idx : interior) out[1 + idx] = ways;
+    }
+}
+
+/*
+ * countExactly
+ * ------------
+ * Exact counts for the board `solver` last solved. `threads` = 0 uses every core (never more
+ * threads than primes). `minPrimes` forces at least that many primes even when fewer would
+ * do: the extra ones change nothing in the result, which makes it a check of the CRT code.
+ */
+inline ExactCounts countExactly(const ThrillDiggerSolver& solver, int threads = 0, int minPrimes = 0) {
+    ExactCounts result;
+    for (const ComponentResult& cr : solver.componentResults) {
+        if (!cr.hasCounts) return result; // Not enumerated: no exact count exists
+    }
+    result.complete = true;
+    if (!(solver.totalWays > 0.0)) return result; // Contradictory board: every count is 0
+
+    int numUnknown = (int)solver.interiorCells.size();
+    for (const ComponentResult& cr : solver.componentResults) numUnknown += cr.size;
+    std::vector<uint64_t> primes = modularPrimes(std::max((size_t)numUnknown / 60 + 1, (size_t)std::max(minPrimes, 0)));
+    int k = (int)primes.size();
+    result.primes = k;
+
+    // One prime per thread, handed out through an atomic counter
+    std::vector<std::vector<uint64_t>> residues(k);
+    int numThreads = threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    numThreads = std::min(numThreads, k);
+    result.threads = numThreads;
+    std::atomic<int> next(0);
+    auto work = [&]() {
+        for (int i; (i = next.fetch_add(1)) < k;) countModPrime(solver, primes[i], residues[i]);
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < numThreads; t++) pool.emplace_back(work);
+    work();
+    for (auto& th : pool) th.join();
+
+    // Garner: x = d0 + p0 * (d1 + p1 * (d2 + ...)), with digits d_i < p_i.
+    // inverse[j][i] = p_j^-1 mod p_i
+    std::vector<std::vector<uint64_t>> inverse(k, std::vector<uint64_t>(k));
+    for (int j = 0; j < k; j++)
+        for (int i = j + 1; i < k; i++) inverse[j][i] = invMod(primes[j] % primes[i], primes[i]);
+    std::vector<uint64_t> digits(k);
+    auto reconstruct = [&](size_t value) {
+        for (int i = 0; i < k; i++) {
+            uint64_t x = residues[i][value];
+            for (int j = 0; j < i; j++) {
+                uint64_t dj = digits[j] % primes[i];
+                x = mulMod(x >= dj ? x - dj : x + primes[i] - dj, inverse[j][i], primes[i]);
+            }
+            digits[i] = x;
+        }
+        BigCount n(digits[k - 1]);
+        for (int i = k - 2; i >= 0; i--) n.mulAdd(primes[i], digits[i]);
+        return n;
+    };
+    result.totalWays = reconstruct(0);
+    for (int i = 0; i < TOTAL_CELLS; i++) {
+        if (solver.grid[i] == CellContent::Undug) result.badWays[i] = reconstruct(1 + i);
+    }
+    return result;
+}
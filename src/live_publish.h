@@ -0,0 +1,570 @@
+/*
+=================================================================================================
+FILE: src/live_publish.h
+
+DESCRIPTION:
+This file publishes the solver's latest results into shared memory, where any number of other
+local processes (a stream overlay, a bot, a second monitor...) can read them. It contains the
+writer (LivePublisher), the reader (LiveReader) and a check that readers never see a
+half-written result (runLiveVerify).
+
+IMPORTANCE:
+An overlay redraws many times per second and only ever wants the newest probabilities. Asking
+for them over a socket or reading a file costs a system call and a copy per frame, and the
+overlay has to poll anyway. Here the newest result simply sits in memory that the overlay has
+mapped: reading it is a few loads, with no system call, and the solver never waits for the
+readers (it doesn't even know how many there are).
+
+INTERACTION:
+- Includes "solver.h" (the published results) and "planner.h" (outcomeDistribution, for the
+  optional per-cell outcome distributions).
+- Attach a LivePublisher to a solver (attach()) and every solve() publishes its results, via
+  the solver's `stageObserver` hook (an observer already there keeps getting its calls).
+- Driven by the `live` command of `src/cli.cpp` (publish / read / verify).
+- POSIX shared memory (shm_open + mmap), so Linux and macOS. On Windows open() fails with a
+  message.
+
+MEMORY LAYOUT (fixed, so readers can be written in any language; little-endian):
+- LiveHeader (64 bytes): magic "TDLV", version, slot count, slot size, number of frames
+  published so far (the newest is in slot (published - 1) % slots) and the writer's process
+  id (0 once the writer is gone).
+- `slots` LiveSlots of 1344 bytes: a sequence number, then LiveData: frame number, board
+  (PackedBoard lo, hi), totalWays, flags, the 40 badProb values (float) and, with
+  LIVE_HAS_OUTCOMES, the chance of each outcome (Green, Blue, Red, Silver, Gold, Rupoor,
+  Bomb) when digging each cell (float[40][7]).
+
+HOW IT WORKS (a "seqlock" per slot):
+1. Writing frame n: pick slot (n - 1) % slots, make its sequence number odd ("being written"),
+   write the data, make it even again, then announce n in the header.
+2. Reading: look up the newest frame in the header, remember its slot's sequence number, copy
+   the data, and look at the sequence number again. If it was odd or has changed, the writer
+   touched the slot during the copy: the copy may be torn, so read again.
+3. The ring of slots keeps readers and the writer apart: the writer fills the NEXT slot while
+   readers copy the newest one, which is only reused `slots` frames later. So readers almost
+   never have to retry, and the writer never waits for anybody.
+4. A writer that reopens the segment with another slot count does not resize it under the
+   readers (their mapping would then reach past its end): it clears the magic of the old one,
+   removes its name and creates a new one. Readers see the magic change, give up on the old
+   mapping and open the name again. A reader also gives up after a bounded number of retries,
+   so a writer that died in the middle of a frame can't keep it spinning.
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include "planner.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// =================================================================================================
+// SHARED MEMORY LAYOUT
+// =================================================================================================
+
+constexpr uint32_t LIVE_MAGIC = 0x564C4454; // "TDLV"
+constexpr uint32_t LIVE_VERSION = 1;
+constexpr uint32_t LIVE_HAS_OUTCOMES = 1;   // LiveData::flags: `outcome` is filled in
+constexpr const char* LIVE_DEFAULT_NAME = "/thrilldigger-live";
+
+// Shared between processes: the atomics must not hide a lock inside the process
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "shared-memory atomics must be lock-free");
+
+struct LiveHeader {
+    std::atomic<uint32_t> magic;     // LIVE_MAGIC, written last when the segment is set up
+    uint32_t version;                // LIVE_VERSION
+    uint32_t slotCount;
+    uint32_t slotBytes;              // sizeof(LiveSlot)
+    std::atomic<uint64_t> published; // Frames published so far
+    std::atomic<uint64_t> writerPid; // 0 once the writer closed the segment
+    uint64_t reserved[4];
+};
+static_assert(sizeof(LiveHeader) == 64, "live header layout");
+
+struct LiveData {
+    uint64_t frame;    // 1, 2, 3, ... (0: slot never written)
+    uint64_t boardLo;  // PackedBoard
+    uint64_t boardHi;
+    double totalWays;
+    uint32_t flags;    // LIVE_HAS_OUTCOMES
+    uint32_t reserved;
+    float badProb[TOTAL_CELLS];
+    float outcome[TOTAL_CELLS][NUM_OUTCOMES];
+};
+
+struct alignas(64) LiveSlot {
+    std::atomic<uint64_t> sequence; // Odd while the writer is inside
+    uint64_t reserved;
+    LiveData data;
+};
+static_assert(sizeof(LiveSlot) == 1344, "live slot layout");
+
+inline size_t liveSegmentBytes(uint32_t slots) { return sizeof(LiveHeader) + slots * sizeof(LiveSlot); }
+
+// =================================================================================================
+// WRITER
+// =================================================================================================
+
+/*
+ * LivePublisher
+ * -------------
+ * Creates (or takes over) the shared-memory segment `name` and publishes frames into it.
+ * Only one writer per segment. As a SolveStageObserver, it publishes the results of the solver
+ * it is attached to at the end of every solve().
+ */
+class LivePublisher : public SolveStageObserver {
+public:
+    LivePublisher() = default;
+    ~LivePublisher() override { close(); }
+    LivePublisher(const LivePublisher&) = delete;
+    LivePublisher& operator=(const LivePublisher&) = delete;
+
+    // Creates or reopens the segment with `slots` slots. False (and `error`) on failure.
+    bool open(const std::string& segmentName, uint32_t slots, std::string& error) {
+        close();
+#ifdef _WIN32
+        (void)segmentName; (void)slots;
+        error = "live publishing needs POSIX shared memory (Linux, macOS)";
+        return false;
+#else
+        slots = std::max<uint32_t>(1, slots);
+        bytes = liveSegmentBytes(slots);
+        int fd = shm_open(segmentName.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            error = "cannot create shared memory " + segmentName + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size != 0 && static_cast<size_t>(st.st_size) != bytes) {
+            // Another size: retire the old segment (readers may have it mapped) and make a new one
+            retire(fd, static_cast<size_t>(st.st_size));
+            ::close(fd);
+            shm_unlink(segmentName.c_str());
+            fd = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            if (fd < 0) {
+                error = "cannot recreate shared memory " + segmentName + ": " + std::strerror(errno);
+                return false;
+            }
+        }
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            error = "cannot size shared memory " + segmentName + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd); // The mapping keeps the segment
+        if (p == MAP_FAILED) {
+            error = "cannot map shared memory " + segmentName + ": " + std::strerror(errno);
+            return false;
+        }
+        base = p;
+        header = static_cast<LiveHeader*>(p);
+        slot = reinterpret_cast<LiveSlot*>(static_cast<char*>(p) + sizeof(LiveHeader));
+
+        // Fresh start: readers that see the new magic see consistent slot fields. Frame numbers
+        // continue from an earlier writer, so a reader never mistakes an old frame for a new one.
+        header->magic.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        uint64_t previous = header->slotCount == slots ? header->published.load(std::memory_order_relaxed) : 0;
+        if (header->slotCount != slots) std::memset(static_cast<void*>(slot), 0, slots * sizeof(LiveSlot));
+        header->version = LIVE_VERSION;
+        header->slotCount = slots;
+        header->slotBytes = sizeof(LiveSlot);
+        header->published.store(previous, std::memory_order_relaxed);
+        header->writerPid.store(static_cast<uint64_t>(getpid()), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic.store(LIVE_MAGIC, std::memory_order_release);
+        return true;
+#endif
+    }
+
+    // Unmaps the segment (it stays, with its last frame, until unlink()); readers see writerPid 0
+    void close() {
+#ifndef _WIN32
+        if (!base) return;
+        header->writerPid.store(0, std::memory_order_release);
+        munmap(base, bytes);
+#endif
+        base = nullptr;
+        header = nullptr;
+        slot = nullptr;
+    }
+
+    // Removes the segment name (readers that have it mapped keep their mapping)
+    static void unlink(const std::string& segmentName) {
+#ifndef _WIN32
+        shm_unlink(segmentName.c_str());
+#else
+        (void)segmentName;
+#endif
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    uint64_t published() const { return header ? header->published.load(std::memory_order_relaxed) : 0; }
+
+    /*
+     * publishWith
+     * -----------
+     * Publishes one frame: `fill(LiveData&)` writes the fields straight into the slot (frame is
+     * set afterwards). Returns the frame number, 0 if the segment isn't open.
+     */
+    template <class Fill>
+    uint64_t publishWith(Fill fill) {
+        if (!header) return 0;
+        uint64_t n = header->published.load(std::memory_order_relaxed) + 1;
+        LiveSlot& s = slot[(n - 1) % header->slotCount];
+        uint64_t seq = s.sequence.load(std::memory_order_relaxed);
+        s.sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release); // Odd number before any data
+        fill(s.data);
+        s.data.frame = n;
+        s.sequence.store(seq + 2, std::memory_order_release); // All data before the even number
+        header->published.store(n, std::memory_order_release);
+        return n;
+    }
+
+    /*
+     * publish
+     * -------
+     * Publishes the solver's current results. With a planner, also every undug cell's outcome
+     * distribution (5 extra "what if" solves per cell, cached by the planner).
+     */
+    uint64_t publish(const ThrillDiggerSolver& solver, ExpectimaxPlanner* outcomes = nullptr) {
+        if (outcomes) {
+            for (int i = 0; i < TOTAL_CELLS; i++) {
+                if (solver.grid[i] == CellContent::Undug) outcomeScratch[i] = outcomes->outcomeDistribution(solver.grid, i);
+                else outcomeScratch[i].fill(0.0);
+            }
+        }
+        PackedBoard board = packBoard(solver.grid);
+        return publishWith([&](LiveData& d) {
+            d.boardLo = board.lo;
+            d.boardHi = board.hi;
+            d.totalWays = solver.totalWays;
+            d.flags = outcomes ? LIVE_HAS_OUTCOMES : 0;
+            d.reserved = 0;
+            for (int i = 0; i < TOTAL_CELLS; i++) {
+                d.badProb[i] = static_cast<float>(solver.badProb[i]);
+                for (int o = 0; o < NUM_OUTCOMES; o++) d.outcome[i][o] = outcomes ? static_cast<float>(outcomeScratch[i][o]) : 0.0f;
+            }
+        });
+    }
+
+    // From now on every solve() of `solver` publishes its results. An observer the solver
+    // already had is kept and still called first (it must outlive this publisher's use).
+    void attach(ThrillDiggerSolver& solver, ExpectimaxPlanner* outcomes = nullptr) {
+        if (solver.stageObserver != this) chained = solver.stageObserver;
+        source = &solver;
+        sourceOutcomes = outcomes;
+        solver.stageObserver = this;
+    }
+
+    void onStage(SolveStage stage) override {
+        if (chained) chained->onStage(stage);
+        if (stage == SolveStage::Done && source) publish(*source, sourceOutcomes);
+    }
+
+private:
+    void* base = nullptr;
+    size_t bytes = 0;
+    LiveHeader* header = nullptr;
+    LiveSlot* slot = nullptr;
+    const ThrillDiggerSolver* source = nullptr;
+    ExpectimaxPlanner* sourceOutcomes = nullptr;
+    SolveStageObserver* chained = nullptr; // The solver's observer before attach()
+    std::array<std::array<double, NUM_OUTCOMES>, TOTAL_CELLS> outcomeScratch{};
+
+#ifndef _WIN32
+    // Marks the segment behind `fd` (of `size` bytes) as gone, for readers that still map it
+    static void retire(int fd, size_t size) {
+        if (size < sizeof(LiveHeader)) return;
+        void* p = mmap(nullptr, sizeof(LiveHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return;
+        LiveHeader* old = static_cast<LiveHeader*>(p);
+        old->magic.store(0, std::memory_order_release);
+        old->writerPid.store(0, std::memory_order_release);
+        munmap(p, sizeof(LiveHeader));
+    }
+#endif
+};
+
+// =================================================================================================
+// READER
+// =================================================================================================
+
+/*
+ * LiveReader
+ * ----------
+ * Maps a published segment read-only. After open(), reading never makes a system call.
+ */
+class LiveReader {
+public:
+    LiveReader() = default;
+    ~LiveReader() { close(); }
+    LiveReader(const LiveReader&) = delete;
+    LiveReader& operator=(const LiveReader&) = delete;
+
+    // Torn copies detected (and read again) so far
+    uint64_t retries = 0;
+
+    // visitLatest gives up after this many torn or busy tries in a row
+    static constexpr int MAX_TRIES = 10000;
+
+    bool open(const std::string& segmentName, std::string& error) {
+        close();
+#ifdef _WIN32
+        (void)segmentName;
+        error = "live reading needs POSIX shared memory (Linux, macOS)";
+        return false;
+#else
+        int fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            error = "no live results at " + segmentName + " (" + std::strerror(errno) + ")";
+            return false;
+        }
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(LiveHeader)) {
+            bytes = static_cast<size_t>(st.st_size);
+            p = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            error = "cannot map " + segmentName;
+            return false;
+        }
+        base = p;
+        header = static_cast<const LiveHeader*>(p);
+        if (header->magic.load(std::memory_order_acquire) != LIVE_MAGIC || header->version != LIVE_VERSION || header->slotBytes != sizeof(LiveSlot) ||
+            header->slotCount == 0 || liveSegmentBytes(header->slotCount) > bytes) {
+            error = segmentName + " is not a live results segment of this version";
+            close();
+            return false;
+        }
+        slot = reinterpret_cast<const LiveSlot*>(static_cast<const char*>(p) + sizeof(LiveHeader));
+        slots = header->slotCount;
+        return true;
+#endif
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (base) munmap(const_cast<void*>(base), bytes);
+#endif
+        base = nullptr;
+        header = nullptr;
+        slot = nullptr;
+    }
+
+    uint64_t published() const { return header->published.load(std::memory_order_acquire); }
+    bool writerAlive() const { return header->writerPid.load(std::memory_order_acquire) != 0; }
+
+    // True once a writer has reset or replaced the segment since open(): open() it again
+    bool segmentChanged() const {
+        return header->magic.load(std::memory_order_acquire) != LIVE_MAGIC || header->slotCount != slots;
+    }
+
+    /*
+     * visitLatest
+     * -----------
+     * Calls `visit(const LiveData&)` on the newest frame IN PLACE (no copy), then checks that
+     * the writer didn't touch the slot meanwhile; if it did, visits again. `visit` must only
+     * read plain values and keep what it needs: until the check passes it may see a mix of two
+     * frames. Returns false if nothing was published yet, if the segment changed (see
+     * segmentChanged()) or if no whole frame could be read in MAX_TRIES tries (e.g. the
+     * writer died while writing the only slot).
+     */
+    template <class Visit>
+    bool visitLatest(Visit visit) {
+        for (int tries = 0; tries < MAX_TRIES; tries++) {
+            if (segmentChanged()) return false;
+            uint64_t n = header->published.load(std::memory_order_acquire);
+            if (n == 0) return false;
+            const LiveSlot& s = slot[(n - 1) % slots];
+            uint64_t before = s.sequence.load(std::memory_order_acquire);
+            if (!(before & 1)) {
+                visit(s.data);
+                std::atomic_thread_fence(std::memory_order_acquire); // Data reads before the re-check
+                if (s.sequence.load(std::memory_order_relaxed) == before && s.data.frame == n) return true;
+            }
+            retries++;
+        }
+        return false;
+    }
+
+    // Copies the newest frame into `out` (false if nothing was published yet)
+    bool readLatest(LiveData& out) {
+        return visitLatest([&](const LiveData& d) { std::memcpy(&out, &d, sizeof(LiveData)); });
+    }
+
+    // The same copy WITHOUT the sequence check (may be torn; used by runLiveVerify to show
+    // that the check is what prevents torn reads)
+    bool readLatestUnchecked(LiveData& out) const {
+        uint64_t n = header->published.load(std::memory_order_acquire);
+        if (n == 0) return false;
+        std::memcpy(&out, &slot[(n - 1) % slots].data, sizeof(LiveData));
+        return true;
+    }
+
+private:
+    const void* base = nullptr;
+    size_t bytes = 0;
+    const LiveHeader* header = nullptr;
+    const LiveSlot* slot = nullptr;
+    uint32_t slots = 0;
+};
+
+// =================================================================================================
+// TORN-READ CHECK
+// =================================================================================================
+
+/*
+ * Synthetic frames for the check: every field is computed from the frame number, so a reader
+ * can tell from a copy alone whether all of it belongs to one frame.
+ */
+inline void fillCheckFrame(LiveData& d, uint64_t n) {
+    d.boardLo = n * 0x9E3779B97F4A7C15ull;
+    d.boardHi = ~n;
+    d.totalWays = static_cast<double>(n);
+    d.flags = LIVE_HAS_OUTCOMES;
+    d.reserved = static_cast<uint32_t>(n);
+    for (int i = 0; i < TOTAL_CELLS; i++) {
+        d.badProb[i] = static_cast<float>((n * 41 + i) & 0xFFFFF); // Exact in a float
+        for (int o = 0; o < NUM_OUTCOMES; o++) d.outcome[i][o] = static_cast<float>((n * 7 + i * NUM_OUTCOMES + o) & 0xFFFFF);
+    }
+}
+
+inline bool isCheckFrame(const LiveData& d) {
+    uint64_t n = d.frame;
+    if (d.boardLo != n * 0x9E3779B97F4A7C15ull || d.boardHi != ~n || d.totalWays != static_cast<double>(n) ||
+        d.reserved != static_cast<uint32_t>(n)) return false;
+    for (int i = 0; i < TOTAL_CELLS; i++) {
+        if (d.badProb[i] != static_cast<float>((n * 41 + i) & 0xFFFFF)) return false;
+        for (int o = 0; o < NUM_OUTCOMES; o++)
+            if (d.outcome[i][o] != static_cast<float>((n * 7 + i * NUM_OUTCOMES + o) & 0xFFFFF)) return false;
+    }
+    return true;
+}
+
+struct LiveVerifyConfig {
+    int readers = 4;          // Reader processes
+    double seconds = 2.0;     // How long the writer publishes
+    uint32_t slots = 16;
+    bool uncheckedToo = true; // Readers also copy without the sequence check, for comparison
+};
+
+struct LiveVerifyResult {
+    uint64_t frames = 0;           // Published by the writer
+    uint64_t checkedReads = 0;     // Through readLatest
+    uint64_t checkedTorn = 0;      // ...that were not one whole frame (must be 0)
+    uint64_t retries = 0;          // ...torn copies the seqlock caught and read again
+    uint64_t uncheckedReads = 0;   // Through readLatestUnchecked
+    uint64_t uncheckedTorn = 0;    // ...that were not one whole frame
+    uint64_t stale = 0;            // Checked reads older than an earlier read (must be 0)
+    int failedReaders = 0;         // Reader processes that didn't report
+};
+
+/*
+ * runLiveVerify
+ * -------------
+ * Creates a private segment, forks `readers` reader processes and publishes synthetic frames
+ * as fast as possible for `seconds`, while every reader reads the newest frame over and over
+ * and checks each copy. Readers report their counts back through a pipe.
+ */
+inline LiveVerifyResult runLiveVerify(const LiveVerifyConfig& cfg, std::string& error) {
+    LiveVerifyResult result;
+#ifdef _WIN32
+    (void)cfg;
+    error = "the live check needs POSIX shared memory and fork (Linux, macOS)";
+    return result;
+#else
+    std::string segment = "/thrilldigger-verify-" + std::to_string(static_cast<long long>(getpid()));
+    LivePublisher writer;
+    if (!writer.open(segment, cfg.slots, error)) return result;
+    writer.publishWith([](LiveData& d) { fillCheckFrame(d, 1); }); // So readers start with a frame
+
+    int ready[2], report[2];
+    if (pipe(ready) != 0 || pipe(report) != 0) {
+        error = "pipe failed";
+        LivePublisher::unlink(segment);
+        return result;
+    }
+    std::vector<pid_t> children;
+    for (int r = 0; r < std::max(1, cfg.readers); r++) {
+        pid_t pid = fork();
+        if (pid < 0) break;
+        if (pid == 0) {
+            // Reader process: alternate checked and unchecked copies until the writer is gone
+            LiveVerifyResult mine;
+            LiveReader reader;
+            std::string readerError;
+            char byte = reader.open(segment, readerError) ? 1 : 0;
+            if (write(ready[1], &byte, 1) != 1 || !byte) _exit(1);
+            LiveData copy;
+            uint64_t lastFrame = 0;
+            while (reader.writerAlive()) {
+                if (!reader.readLatest(copy)) continue;
+                mine.checkedReads++;
+                if (!isCheckFrame(copy)) mine.checkedTorn++;
+                if (copy.frame < lastFrame) mine.stale++;
+                lastFrame = copy.frame;
+                if (cfg.uncheckedToo && reader.readLatestUnchecked(copy)) {
+                    mine.uncheckedReads++;
+                    if (!isCheckFrame(copy)) mine.uncheckedTorn++;
+                }
+            }
+            mine.retries = reader.retries;
+            _exit(write(report[1], &mine, sizeof(mine)) == (ssize_t)sizeof(mine) ? 0 : 1);
+        }
+        children.push_back(pid);
+    }
+    ::close(ready[1]);
+    ::close(report[1]);
+
+    // Wait until every reader has the segment mapped, then publish
+    for (size_t i = 0; i < children.size(); i++) {
+        char byte = 0;
+        if (read(ready[0], &byte, 1) != 1 || !byte) result.failedReaders++;
+    }
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(cfg.seconds));
+    do {
+        for (int k = 0; k < 256; k++) writer.publishWith([&](LiveData& d) { fillCheckFrame(d, writer.published() + 1); });
+    } while (std::chrono::steady_clock::now() < end);
+    result.frames = writer.published();
+    writer.close(); // writerPid 0: readers stop and report
+
+    for (size_t i = 0; i < children.size(); i++) {
+        LiveVerifyResult r;
+        if (read(report[0], &r, sizeof(r)) != (ssize_t)sizeof(r)) continue;
+        result.checkedReads += r.checkedReads;
+        result.checkedTorn += r.checkedTorn;
+        result.retries += r.retries;
+        result.uncheckedReads += r.uncheckedReads;
+        result.uncheckedTorn += r.uncheckedTorn;
+        result.stale += r.stale;
+    }
+    int exited = 0;
+    for (pid_t pid : children) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0) exited++;
+    }
+    result.failedReaders = std::max(result.failedReaders, static_cast<int>(children.size()) - exited);
+    if (static_cast<int>(children.size()) < std::max(1, cfg.readers)) result.failedReaders += std::max(1, cfg.readers) - static_cast<int>(children.size());
+    ::close(ready[0]);
+    ::close(report[0]);
+    LivePublisher::unlink(segment);
+    return result;
+#endif
+}
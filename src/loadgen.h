@@ -0,0 +1,238 @@
+/*
+=================================================================================================
+FILE: src/loadgen.h
+
+DESCRIPTION:
+This file is a load generator for the solver daemon (daemon.h): it sends boards over the
+local socket from several connections, either as fast as the answers come back (closed loop)
+or on a fixed schedule at a target rate (open loop), and measures the latency of every answer.
+
+IMPORTANCE:
+Deployment is sized from these numbers: how many requests per second one daemon sustains,
+and how slow the slowest answers get at a given rate. Measured naively, both lie. A closed-loop
+client that waits for each answer before sending the next simply stops sending while the server
+stalls, so the stall shows up as ONE slow request instead of the hundreds that real viewers,
+who don't wait for each other, would have sent meanwhile ("coordinated omission").
+Here every request has an intended send time from the schedule, and latency is measured from
+that time. A stall then shows up in every request that should have been sent during it.
+
+INTERACTION:
+- Includes "daemon.h" (client, protocol), "sketch.h" (HdrHistogram), "session_log.h"
+  (recorded sessions as workload) and "stress.h" (random mid-game positions as workload).
+- Driven by the `daemon bench` command of `src/cli.cpp`.
+
+HOW IT WORKS:
+1. Workload: a list of boards, from recorded sessions (the board after every event) or random
+   positions. Connection c sends boards c, c + C, c + 2C, ... (cycling).
+2. Schedule (with a target rate): request k of connection c is due at
+   start + (k * C + c) / rate, so the connections interleave evenly.
+3. Closed loop: at most `depth` requests in flight per connection; the next one is sent when
+   an answer came back and it is due.
+   Open loop: each connection has a sender thread that sends every request when it is due,
+   whatever happened to the previous ones, and a receiver thread that reads the answers.
+4. Two histograms: "service" latency from the actual send, and "corrected" latency from the
+   intended send time (the same as service when there is no schedule).
+=================================================================================================
+*/
+
+#pragma once
+#include "daemon.h"
+#include "session_log.h"
+#include "sketch.h"
+#include "stress.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// =================================================================================================
+// WORKLOAD
+// =================================================================================================
+
+struct LoadWorkload {
+    std::vector<PackedBoard> boards;
+    std::vector<BoardResult> expected; // Filled by computeExpected(), for verification
+
+    // The board after every valid event of a session log (what a front-end would solve)
+    void addSession(const SessionEvent* events, size_t count) {
+        std::array<CellContent, TOTAL_CELLS> grid;
+        grid.fill(CellContent::Undug);
+        for (size_t i = 0; i < count; i++) {
+            const SessionEvent& e = events[i];
+            auto type = static_cast<SessionEventType>(e.type);
+            if (type == SessionEventType::Open || type == SessionEventType::Reset) {
+                grid.fill(CellContent::Undug);
+            } else if (type == SessionEventType::SetCell && e.cell < TOTAL_CELLS &&
+                       e.content <= static_cast<uint8_t>(CellContent::Bomb)) {
+                grid[e.cell] = static_cast<CellContent>(e.content);
+            } else {
+                continue;
+            }
+            boards.push_back(packBoard(grid));
+        }
+    }
+
+    // `count` random mid-game positions (see typicalPositions in stress.h)
+    void addTypical(uint64_t seed, int count) {
+        std::vector<WorstCase> positions;
+        typicalPositions(seed, count, positions);
+        for (const WorstCase& w : positions) boards.push_back(packBoard(w.grid));
+    }
+
+    void computeExpected() {
+        ThrillDiggerSolver solver;
+        expected.resize(boards.size());
+        for (size_t i = 0; i < boards.size(); i++) BatchSolver::solveOne(solver, boards[i], expected[i]);
+    }
+};
+
+// =================================================================================================
+// RUNNING LOAD
+// =================================================================================================
+
+struct LoadConfig {
+    std::string socketPath;
+    bool openLoop = false;
+    int connections = 4;
+    int depth = 1;             // Closed loop: requests in flight per connection
+    double qps = 0.0;          // Target rate over all connections (0 = no schedule; closed loop only)
+    long long requests = 2000; // Per connection
+};
+
+struct LoadResult {
+    long long sent = 0;
+    long long received = 0;
+    long long failures = 0;   // Connections that broke (or never connected)
+    long long mismatches = 0; // Answers that differ from the workload's expected results
+    double seconds = 0.0;
+    HdrHistogram serviceNs;   // From the actual send
+    HdrHistogram correctedNs; // From the intended send time
+
+    double achievedQps() const { return seconds > 0.0 ? received / seconds : 0.0; }
+};
+
+/*
+ * runLoad
+ * -------
+ * Runs one load test against the daemon at cfg.socketPath and returns the measurements.
+ */
+inline LoadResult runLoad(const LoadConfig& cfg, const LoadWorkload& work) {
+    using Clock = std::chrono::steady_clock;
+    const int C = std::max(1, cfg.connections);
+    const long long N = std::max(1LL, cfg.requests);
+    const size_t numBoards = std::max<size_t>(1, work.boards.size());
+    const bool scheduled = cfg.qps > 0.0;
+
+    struct PerConnection {
+        HdrHistogram service, corrected;
+        long long sent = 0, received = 0, mismatches = 0;
+        bool failed = false;
+    };
+    std::vector<PerConnection> per(C);
+    Clock::time_point start = Clock::now() + std::chrono::milliseconds(20); // Time to start the threads
+
+    auto boardOf = [&](int c, long long k) { return (size_t)((k * C + c) % (long long)numBoards); };
+    auto dueAt = [&](int c, long long k) {
+        return start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((k * C + c) / cfg.qps));
+    };
+    auto nanos = [](Clock::duration d) { return (uint64_t)std::max<long long>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()); };
+    auto requestFor = [&](int c, long long k) {
+        PackedBoard b = work.boards[boardOf(c, k)];
+        DaemonRequest r = {};
+        r.id = (uint32_t)k;
+        r.lo = b.lo;
+        r.hi = b.hi;
+        return r;
+    };
+    // Checks and records answer k of connection c; false if it is not the expected answer k
+    auto onAnswer = [&](int c, long long k, const DaemonResponse& r, Clock::time_point sent, Clock::time_point intended) {
+        Clock::time_point now = Clock::now();
+        PerConnection& pc = per[c];
+        if (r.id != (uint32_t)k) return false;
+        pc.service.record(nanos(now - sent));
+        pc.corrected.record(nanos(now - intended));
+        if (!work.expected.empty()) {
+            const BoardResult& e = work.expected[boardOf(c, k)];
+            if (r.totalWays != e.totalWays || std::memcmp(r.badProb, e.badProb, sizeof(r.badProb)) != 0) pc.mismatches++;
+        }
+        pc.received++;
+        return true;
+    };
+
+    // Closed loop: send when there is room and the request is due, else wait for an answer
+    auto closedLoop = [&](int c) {
+        PerConnection& pc = per[c];
+        DaemonClient conn;
+        if (!conn.connect(cfg.socketPath)) { pc.failed = true; return; }
+        int depth = std::max(1, cfg.depth);
+        std::vector<Clock::time_point> sentAt(depth), intendedAt(depth);
+        std::this_thread::sleep_until(start);
+        while (pc.received < N) {
+            if (pc.sent < N && pc.sent - pc.received < depth) {
+                Clock::time_point due = scheduled ? dueAt(c, pc.sent) : Clock::now();
+                if (pc.sent == pc.received) std::this_thread::sleep_until(due); // Nothing to wait for
+                if (Clock::now() >= due) {
+                    DaemonRequest req = requestFor(c, pc.sent);
+                    sentAt[pc.sent % depth] = Clock::now();
+                    intendedAt[pc.sent % depth] = scheduled ? due : sentAt[pc.sent % depth];
+                    if (!conn.send(&req, 1)) { pc.failed = true; return; }
+                    pc.sent++;
+                    continue;
+                }
+            }
+            DaemonResponse r;
+            long long k = pc.received;
+            if (!conn.receive(r) || !onAnswer(c, k, r, sentAt[k % depth], intendedAt[k % depth])) { pc.failed = true; return; }
+        }
+    };
+
+    // Open loop: one thread sends on schedule, the other receives
+    auto openLoop = [&](int c) {
+        PerConnection& pc = per[c];
+        DaemonClient conn;
+        if (!conn.connect(cfg.socketPath)) { pc.failed = true; return; }
+        std::unique_ptr<std::atomic<long long>[]> sentNs(new std::atomic<long long>[N]);
+        std::atomic<long long> sentCount(0);
+        std::atomic<bool> broken(false);
+        std::thread receiver([&] {
+            for (long long k = 0; k < N; k++) {
+                DaemonResponse r;
+                if (!conn.receive(r)) { broken = true; return; }
+                while (sentCount.load(std::memory_order_acquire) <= k) std::this_thread::yield(); // (Already true)
+                Clock::time_point sent = start + std::chrono::nanoseconds(sentNs[k].load(std::memory_order_relaxed));
+                if (!onAnswer(c, k, r, sent, dueAt(c, k))) { broken = true; return; }
+            }
+        });
+        for (long long k = 0; k < N && !broken; k++) {
+            std::this_thread::sleep_until(dueAt(c, k));
+            DaemonRequest req = requestFor(c, k);
+            sentNs[k].store(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(), std::memory_order_relaxed);
+            if (!conn.send(&req, 1)) { broken = true; break; }
+            sentCount.store(k + 1, std::memory_order_release);
+            pc.sent++;
+        }
+        if (broken) conn.interrupt(); // Unblocks the receiver
+        receiver.join();
+        pc.failed = broken.load();
+    };
+
+    std::vector<std::thread> threads;
+    for (int c = 0; c < C; c++) {
+        if (cfg.openLoop && scheduled) threads.emplace_back(openLoop, c);
+        else threads.emplace_back(closedLoop, c);
+    }
+    for (auto& t : threads) t.join();
+
+    LoadResult result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (const PerConnection& pc : per) {
+        result.sent += pc.sent;
+        result.received += pc.received;
+        result.mismatches += pc.mismatches;
+        result.failures += pc.failed ? 1 : 0;
+        result.serviceNs.merge(pc.service);
+        result.correctedNs.merge(pc.corrected);
+    }
+    return result;
+}
@@ -16,6 +16,10 @@ It acts as the bridge between the user and the solving logic. It handles:
 
 INTERACTION:
 - Includes "solver.h" to access the `ThrillDiggerSolver` class.
+- Includes "planner.h" and "advisor.h" for the "Suggest" button (look-ahead dig recommendation
+  and stop-or-continue advice). Both run on a worker thread so the window stays responsive.
+- Includes "session_log.h": if the THRILLDIGGER_SESSION_LOG environment variable names a file,
+  every board change is appended to it (for `ThrillDiggerCLI session replay`).
 - Uses Windows API functions (user32, gdi32, comctl32) for rendering and input.
 - Defines the `WinMain` function, which is where execution starts for Windows GUI apps.
 
@@ -38,7 +42,11 @@ When a user changes a dropdown, the app recalculates probabilities and repaints
 #include <cstdio>           // For snprintf, etc.
 #include <string>           // C++ string
 #include <algorithm>        // Algorithms like std::clamp
+#include <thread>           // Background thread for the "Suggest" search
 #include "solver.h"         // Our custom solver logic
+#include "planner.h"        // Look-ahead planner for dig suggestions
+#include "advisor.h"        // Stop-or-continue advice
+#include "session_log.h"    // Optional recording of board changes
 
 // Link against the Common Controls library automatically.
 // This is required for visual styles (like XP/Vista/Win10 look) on controls.
@@ -66,6 +74,16 @@ constexpr int SIDE_MARGIN = 20; // Space on left/right
 // =================================================================================================
 constexpr int ID_COMBO_BASE = 1000; // Starting ID for the 40 combo boxes (1000 to 1039)
 constexpr int ID_RESET_BTN = 2000;  // ID for the "Reset" button
+constexpr int ID_SUGGEST_BTN = 2001;// ID for the "Suggest" button
+
+// Planner settings for the "Suggest" button: search up to this many digs ahead,
+// but never keep the user waiting longer than the time budget.
+constexpr int SUGGEST_MAX_DEPTH = 4;
+constexpr int SUGGEST_BUDGET_MS = 1500;
+constexpr int ADVISOR_BUDGET_MS = 300;  // Simulation time for the stop-or-continue advice
+
+// Posted by the Suggest worker thread when its search is done; lParam owns a SuggestResult*.
+constexpr UINT WM_APP_SUGGEST_DONE = WM_APP + 1;
 
 // =================================================================================================
 // COLORS
@@ -126,6 +144,7 @@ static HWND g_combos[TOTAL_CELLS];         // Array of handles to the 40 dropdow
 static HWND g_cellPanels[TOTAL_CELLS];     // Array of handles to the background panels
 static HWND g_probLabels[TOTAL_CELLS];     // Array of handles to the text labels
 static HWND g_resetBtn;                    // Handle to Reset button
+static HWND g_suggestBtn;                  // Handle to Suggest button
 static HWND g_titleLabel;                  // Handle to Title text
 static HWND g_infoLabel;                   // Handle to Status/Info text at bottom
 
@@ -138,6 +157,26 @@ static HFONT g_fontSmall;
 // Graphics objects (Brushes) for painting backgrounds efficiently
 static HBRUSH g_cellBrushes[TOTAL_CELLS];
 
+// Look-ahead planner. Kept global so its caches survive between clicks.
+// Only the Suggest worker thread touches these, and only one worker runs at a time
+// (the button stays disabled until its result arrives).
+static ExpectimaxPlanner g_planner;
+static StopAdvisor g_advisor;
+static std::thread g_suggestThread;        // Runs the planner/advisor off the UI thread
+static bool g_suggestBusy = false;         // True from the click until WM_APP_SUGGEST_DONE
+
+// What the Suggest worker hands back to the UI thread.
+// It carries its own copy of the board and probabilities so the text matches what was searched.
+struct SuggestResult {
+    std::array<CellContent, TOTAL_CELLS> grid;
+    std::array<double, TOTAL_CELLS> badProb;
+    PlanResult plan;
+    StopAdvice advice;
+};
+
+// Session recording (only when THRILLDIGGER_SESSION_LOG is set)
+static SessionLog g_sessionLog;
+
 // Forward declaration of functions
 static void UpdateUI(HWND hWnd);
 
@@ -247,6 +286,28 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPara
             return 0;
         }
 
+        // Suggest Button Clicked: start the planner on a worker thread.
+        // The search takes up to ~2 seconds; running it here would freeze the window.
+        if (id == ID_SUGGEST_BTN && notif == BN_CLICKED) {
+            if (g_suggestBusy) return 0;
+            if (g_suggestThread.joinable()) g_suggestThread.join(); // Previous worker already posted, so this is instant
+            g_suggestBusy = true;
+            EnableWindow(g_suggestBtn, FALSE);
+            SetWindowTextA(g_infoLabel, "Thinking...");
+            SetCursor(LoadCursor(NULL, IDC_APPSTARTING));
+
+            SuggestResult* job = new SuggestResult();
+            job->grid = g_solver.grid;
+            job->badProb = g_solver.badProb;
+            g_suggestThread = std::thread([hWnd, job]() {
+                job->plan = g_planner.plan(job->grid, SUGGEST_MAX_DEPTH, SUGGEST_BUDGET_MS);
+                job->advice = g_advisor.advise(job->grid, ADVISOR_BUDGET_MS);
+                // If the window is already gone nobody will free the result
+                if (!PostMessage(hWnd, WM_APP_SUGGEST_DONE, 0, (LPARAM)job)) delete job;
+            });
+            return 0;
+        }
+
         // Combo Box Changed
         if (id >= ID_COMBO_BASE && id < ID_COMBO_BASE + TOTAL_CELLS && notif == CBN_SELCHANGE) {
             int cellIdx = id - ID_COMBO_BASE;
@@ -330,6 +391,47 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPara
         return 1; // Signal that we handled the erasing
     }
 
+    // WM_APP_SUGGEST_DONE: the Suggest worker finished; show its pick in the info bar
+    case WM_APP_SUGGEST_DONE: {
+        SuggestResult* job = (SuggestResult*)lParam;
+        const PlanResult& plan = job->plan;
+        const StopAdvice& advice = job->advice;
+        g_suggestBusy = false;
+        EnableWindow(g_suggestBtn, TRUE);
+
+        char buf[256];
+        if (job->grid != g_solver.grid) {
+            // The user changed the board while the search ran: its answer is for an old board
+            snprintf(buf, sizeof(buf), "Board changed while thinking - click Suggest again");
+        } else if (plan.cell < 0) {
+            snprintf(buf, sizeof(buf), "Suggestion: stop digging, nothing left is worth the risk");
+        } else {
+            // The advisor looks further ahead than the planner and may say stop even when
+            // the planner found a dig worth its risk; show its advice as it is
+            char stopText[64];
+            if (advice.shouldContinue()) {
+                snprintf(stopText, sizeof(stopText), "worth ~%d more dig(s)", advice.bestStop);
+            } else {
+                snprintf(stopText, sizeof(stopText), "advisor: stop now");
+            }
+            snprintf(buf, sizeof(buf),
+                "Suggestion: dig row %d, column %d  |  %d%% Bad  |  ~%.0f rupees over next %d dig(s)  |  %s",
+                plan.cell / COLS + 1, plan.cell % COLS + 1,
+                (int)std::round(job->badProb[plan.cell] * 100.0), plan.value, plan.depth, stopText);
+        }
+        SetWindowTextA(g_infoLabel, buf);
+        delete job;
+        return 0;
+    }
+
+    // WM_SETCURSOR: show the "working in background" cursor while Suggest is thinking
+    case WM_SETCURSOR:
+        if (g_suggestBusy && LOWORD(lParam) == HTCLIENT) {
+            SetCursor(LoadCursor(NULL, IDC_APPSTARTING));
+            return TRUE;
+        }
+        break;
+
     // WM_DESTROY: Called when the window is closing.
     // Important to clean up resources (brushes, fonts) to avoid memory leaks.
     case WM_DESTROY:
@@ -340,6 +442,9 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPara
         if (g_fontBold) DeleteObject(g_fontBold);
         if (g_fontTitle) DeleteObject(g_fontTitle);
         if (g_fontSmall) DeleteObject(g_fontSmall);
+        // Wait for a running Suggest search (it ends within its time budget); its result
+        // message is dropped along with the window
+        if (g_suggestThread.joinable()) g_suggestThread.join();
         PostQuitMessage(0); // Tell the message loop to stop
         return 0;
 
@@ -387,6 +492,13 @@ static void CreateFonts() {
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
     g_hInst = hInstance;
 
+    // Record this session if asked to
+    char logPath[MAX_PATH];
+    DWORD logLen = GetEnvironmentVariableA("THRILLDIGGER_SESSION_LOG", logPath, MAX_PATH);
+    if (logLen > 0 && logLen < MAX_PATH && g_sessionLog.open(logPath)) {
+        g_solver.observer = &g_sessionLog;
+    }
+
     // Initialize visual styles
     INITCOMMONCONTROLSEX icex;
     icex.dwSize = sizeof(icex);
@@ -488,7 +600,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
     int infoY = gridTop + gridH + 8;
     g_infoLabel = CreateWindowExA(0, "STATIC", "",
         WS_CHILD | WS_VISIBLE | SS_CENTER,
-        0, infoY, winW - 120, 24, hWnd, NULL, hInstance, NULL);
+        0, infoY, winW - 220, 24, hWnd, NULL, hInstance, NULL);
     SendMessage(g_infoLabel, WM_SETFONT, (WPARAM)g_fontNormal, TRUE);
 
     // Create Reset button
@@ -498,6 +610,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
         hWnd, reinterpret_cast<HMENU>(static_cast<INT_PTR>(ID_RESET_BTN)), hInstance, NULL);
     SendMessage(g_resetBtn, WM_SETFONT, (WPARAM)g_fontBold, TRUE);
 
+    // Create Suggest button (left of Reset)
+    g_suggestBtn = CreateWindowExA(0, "BUTTON", "Suggest",
+        WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+        winW - 210, infoY, 90, 28,
+        hWnd, reinterpret_cast<HMENU>(static_cast<INT_PTR>(ID_SUGGEST_BTN)), hInstance, NULL);
+    SendMessage(g_suggestBtn, WM_SETFONT, (WPARAM)g_fontBold, TRUE);
+
     // Initial calculation (start state)
     g_solver.solve();
     UpdateUI(hWnd);
@@ -0,0 +1,118 @@
+/*
+=================================================================================================
+FILE: src/mapped_file.h
+
+DESCRIPTION:
+A tiny wrapper that maps a file straight into memory ("memory-mapped file"), on both
+Windows (CreateFileMapping) and Linux/macOS (mmap).
+
+IMPORTANCE:
+Big binary tables (like the optimal policy table) can be used directly from disk: the OS pages
+in only the parts that are actually read, nothing has to be parsed or copied into RAM first,
+and several processes reading the same file share one copy in memory.
+
+INTERACTION:
+- Used by `src/policy.h` to open policy tables.
+- Header-only, no dependencies besides the OS.
+=================================================================================================
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /*
+     * open
+     * ----
+     * Maps an existing file. With `writable`, changes to the memory go back to the file.
+     * If `createSize` is non-zero the file is created (or resized) to that many bytes first.
+     * Returns false on any failure (missing file, empty file, mapping refused...).
+     */
+    bool open(const std::string& path, bool writable = false, size_t createSize = 0) {
+        close();
+        if (createSize) writable = true;
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ | (writable ? GENERIC_WRITE : 0),
+            FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, createSize ? OPEN_ALWAYS : OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER sz;
+        if (createSize) {
+            sz.QuadPart = static_cast<LONGLONG>(createSize);
+            if (!SetFilePointerEx(file, sz, NULL, FILE_BEGIN) || !SetEndOfFile(file)) { close(); return false; }
+        }
+        if (!GetFileSizeEx(file, &sz) || sz.QuadPart == 0) { close(); return false; }
+        bytes = static_cast<size_t>(sz.QuadPart);
+        mapping = CreateFileMappingA(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) { close(); return false; }
+        ptr = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+        if (!ptr) { close(); return false; }
+#else
+        fd = ::open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | (createSize ? O_CREAT : 0), 0644);
+        if (fd < 0) return false;
+        if (createSize && ftruncate(fd, static_cast<off_t>(createSize)) != 0) { close(); return false; }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { close(); return false; }
+        bytes = static_cast<size_t>(st.st_size);
+        void* p = mmap(nullptr, bytes, PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) { close(); return false; }
+        ptr = p;
+#endif
+        return true;
+    }
+
+    // Unmaps the file (changes to writable mappings are flushed by the OS)
+    void close() {
+#ifdef _WIN32
+        if (ptr) UnmapViewOfFile(ptr);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (ptr) munmap(ptr, bytes);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        ptr = nullptr;
+        bytes = 0;
+    }
+
+    const uint8_t* data() const { return static_cast<const uint8_t*>(ptr); }
+    uint8_t* data() { return static_cast<uint8_t*>(ptr); }
+    size_t size() const { return bytes; }
+    bool isOpen() const { return ptr != nullptr; }
+
+private:
+    void* ptr = nullptr;
+    size_t bytes = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int fd = -1;
+#endif
+};
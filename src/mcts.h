@@ -0,0 +1,269 @@
+/*
+=================================================================================================
+FILE: src/mcts.h
+
+DESCRIPTION:
+This file contains a Monte Carlo Tree Search (MCTS) player. Instead of computing exact values
+like the planner, it plays thousands of quick imaginary games and learns which first dig
+leads to the most rupees on average.
+
+IMPORTANCE:
+The expectimax planner only sees a few digs ahead before it runs out of time. MCTS can look
+all the way to the end of the game, which matters most in long late-game positions where one
+careless dig throws away everything that could still be collected.
+
+INTERACTION:
+- Includes "sampler.h" to draw hidden boards that agree with the clues.
+- Includes "planner.h" for the rupee values of each outcome.
+- The root solve's badProb drives the cheap rollout policy.
+
+ALGORITHM OVERVIEW (determinized / information-set MCTS):
+1. Each iteration draws one hidden board from the posterior (a "determinization").
+2. Selection: walk down a tree whose nodes are *observed* boards (what the player would see),
+   choosing digs with the UCB formula (average rupees + exploration bonus).
+3. Expansion: the first observed board not yet in the tree becomes a new node.
+4. Rollout: finish the game on the hidden board with a cheap policy (prefer cells the root
+   solve considers safe) until a bomb, a cleared board, or the horizon.
+5. Backpropagation: every dig on the path is credited with the rupees collected after it.
+Each thread grows its own tree (root parallelization), so threads never wait on each other.
+Root statistics are merged into shared atomic counters with lock-free adds.
+=================================================================================================
+*/
+
+#pragma once
+#include "sampler.h"
+#include "planner.h"
+#include <atomic>
+#include <thread>
+#include <climits>
+
+// What the MCTS player recommends.
+struct MctsResult {
+    int cell = -1;                                  // Board index to dig (-1 = nothing to dig)
+    double value = 0.0;                             // Average rupees collected after digging `cell`
+    long long iterations = 0;                       // Simulated games (all threads)
+    std::array<long long, TOTAL_CELLS> visits{};    // Root visits per cell
+    std::array<double, TOTAL_CELLS> meanReward{};   // Root average rupees per cell
+    std::array<double, TOTAL_CELLS> badProb{};      // The root board's solver badProb per cell
+};
+
+class MctsPlayer {
+public:
+    int threads = 0;              // 0 = one per hardware thread
+    double exploration = 60.0;    // UCB exploration constant, in rupees
+    int rolloutHorizon = TOTAL_CELLS; // Maximum digs per simulated game (from the root)
+    size_t maxNodesPerThread = 200000; // Stop growing a tree past this many nodes
+    uint64_t seed = 0x5EED7D1665ull;
+
+    /*
+     * search
+     * ------
+     * Runs MCTS on `grid` for `budgetMs` milliseconds (or `maxIterations` games,
+     * whichever comes first) and returns the most visited dig.
+     */
+    MctsResult search(const std::array<CellContent, TOTAL_CELLS>& grid, int budgetMs,
+                      long long maxIterations = LLONG_MAX)
+    {
+        MctsResult result;
+        if (!sampler.prepare(grid)) return result;
+
+        // Rollout policy: cells are picked with weight (1 - badProb)^2, so the root solve's
+        // safe cells are strongly preferred without making the rollouts deterministic.
+        const auto& badProb = sampler.solved().badProb;
+        for (int i = 0; i < TOTAL_CELLS; i++) result.badProb[i] = badProb[i];
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            double safe = 1.0 - badProb[i];
+            rolloutWeight[i] = safe * safe + 1e-3;
+        }
+
+        // Cells tried first when a node is new: safest first
+        priorOrder.clear();
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            if (grid[i] == CellContent::Undug) priorOrder.push_back(i);
+        }
+        if (priorOrder.empty()) return result;
+        std::stable_sort(priorOrder.begin(), priorOrder.end(), [&](int a, int b) {
+            return badProb[a] < badProb[b];
+        });
+
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            rootVisits[i].store(0, std::memory_order_relaxed);
+            rootReward[i].store(0, std::memory_order_relaxed);
+        }
+        totalIterations.store(0, std::memory_order_relaxed);
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budgetMs);
+        iterationLimit = maxIterations;
+
+        int n = threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::thread> pool;
+        for (int t = 1; t < n; t++) pool.emplace_back([this, &grid, t] { worker(grid, t); });
+        worker(grid, 0); // The calling thread works too
+        for (auto& th : pool) th.join();
+
+        // Most visited dig is the most robust choice
+        long long bestVisits = -1;
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            long long v = rootVisits[i].load();
+            result.visits[i] = v;
+            result.iterations += v; // Every simulated game makes exactly one root dig
+            result.meanReward[i] = v > 0 ? static_cast<double>(rootReward[i].load()) / v : 0.0;
+            if (grid[i] == CellContent::Undug && v > bestVisits) {
+                bestVisits = v;
+                result.cell = i;
+            }
+        }
+        if (result.cell >= 0) result.value = result.meanReward[result.cell];
+        return result;
+    }
+
+private:
+    // One observed board in a thread's tree
+    struct Node {
+        int visits = 0;
+        std::array<int, TOTAL_CELLS> n{};          // Times each dig was tried here
+        std::array<double, TOTAL_CELLS> w{};       // Total rupees collected after each dig
+        std::vector<std::pair<int, int>> children; // (cell * 8 + outcome) -> node index
+    };
+
+    PosteriorSampler sampler;
+    std::array<double, TOTAL_CELLS> rolloutWeight{};
+    std::vector<int> priorOrder;
+
+    // Shared root statistics (rupees are whole numbers, so integer atomics are exact)
+    std::array<std::atomic<long long>, TOTAL_CELLS> rootVisits;
+    std::array<std::atomic<long long>, TOTAL_CELLS> rootReward;
+    std::atomic<long long> totalIterations{0};
+    std::chrono::steady_clock::time_point deadline;
+    long long iterationLimit = LLONG_MAX;
+
+    static constexpr int FLUSH_EVERY = 256; // Iterations between merges into the shared root
+
+    /*
+     * worker
+     * ------
+     * One thread's search loop: grows a private tree and periodically adds its root
+     * statistics to the shared counters.
+     */
+    void worker(const std::array<CellContent, TOTAL_CELLS>& rootGrid, int threadIdx) {
+        std::mt19937_64 rng(seed + 0x9E3779B97F4A7C15ull * (threadIdx + 1));
+        std::vector<Node> tree(1);
+        std::array<int, TOTAL_CELLS> flushedN{};
+        std::array<double, TOTAL_CELLS> flushedW{};
+
+        auto flush = [&]() {
+            for (int i = 0; i < TOTAL_CELLS; i++) {
+                long long dn = tree[0].n[i] - flushedN[i];
+                double dw = tree[0].w[i] - flushedW[i];
+                if (dn == 0) continue;
+                rootVisits[i].fetch_add(dn, std::memory_order_relaxed);
+                rootReward[i].fetch_add(static_cast<long long>(std::llround(dw)), std::memory_order_relaxed);
+                flushedN[i] = tree[0].n[i];
+                flushedW[i] = tree[0].w[i];
+            }
+        };
+
+        std::array<CellContent, TOTAL_CELLS> hidden, seen;
+        struct Step { int node, cell, reward; };
+        std::vector<Step> path;
+
+        for (long long iter = 1;; iter++) {
+            if (totalIterations.fetch_add(1, std::memory_order_relaxed) >= iterationLimit) break;
+            if ((iter & 63) == 0 && std::chrono::steady_clock::now() > deadline) break;
+            if (!sampler.sample(rng, hidden)) break;
+
+            // Safe cells still hidden on this determinization (the game ends when none are left)
+            int safeLeft = 0;
+            for (int i = 0; i < TOTAL_CELLS; i++) {
+                if (rootGrid[i] == CellContent::Undug && !isRevealedBad(hidden[i])) safeLeft++;
+            }
+
+            seen = rootGrid;
+            path.clear();
+            int node = 0, digs = 0;
+            bool over = false, expanded = false;
+
+            // Selection + expansion
+            while (!over && !expanded && safeLeft > 0 && digs < rolloutHorizon) {
+                int cell = selectCell(tree[node], seen);
+                CellContent outcome = hidden[cell];
+                seen[cell] = outcome;
+                digs++;
+                path.push_back({node, cell, rupeeValue(outcome)});
+                if (outcome == CellContent::Bomb) { over = true; break; }
+                if (!isRevealedBad(outcome)) safeLeft--;
+
+                int key = cell * 8 + static_cast<int>(outcome);
+                int child = -1;
+                for (const auto& kv : tree[node].children) {
+                    if (kv.first == key) { child = kv.second; break; }
+                }
+                if (child < 0) {
+                    if (tree.size() >= maxNodesPerThread) { expanded = true; break; }
+                    child = (int)tree.size();
+                    tree[node].children.push_back({key, child});
+                    tree.emplace_back();
+                    expanded = true;
+                }
+                node = child;
+            }
+
+            // Rollout: finish the game with the cheap policy
+            int rolloutReward = 0;
+            while (!over && safeLeft > 0 && digs < rolloutHorizon) {
+                int cell = rolloutCell(seen, rng);
+                CellContent outcome = hidden[cell];
+                seen[cell] = outcome;
+                digs++;
+                rolloutReward += rupeeValue(outcome);
+                if (outcome == CellContent::Bomb) over = true;
+                else if (!isRevealedBad(outcome)) safeLeft--;
+            }
+
+            // Backpropagation: each dig earns everything collected from that point on
+            double ret = rolloutReward;
+            for (int s = (int)path.size() - 1; s >= 0; s--) {
+                ret += path[s].reward;
+                Node& nd = tree[path[s].node];
+                nd.visits++;
+                nd.n[path[s].cell]++;
+                nd.w[path[s].cell] += ret;
+            }
+
+            if ((iter % FLUSH_EVERY) == 0) flush();
+        }
+        flush();
+    }
+
+    // UCB1 choice among the undug cells of `seen` (untried cells first, safest first)
+    int selectCell(const Node& nd, const std::array<CellContent, TOTAL_CELLS>& seen) const {
+        for (int cell : priorOrder) {
+            if (seen[cell] == CellContent::Undug && nd.n[cell] == 0) return cell;
+        }
+        double logN = std::log(static_cast<double>(std::max(nd.visits, 1)));
+        int best = -1;
+        double bestScore = -1e300;
+        for (int cell = 0; cell < TOTAL_CELLS; cell++) {
+            if (seen[cell] != CellContent::Undug) continue;
+            double score = nd.w[cell] / nd.n[cell] + exploration * std::sqrt(logN / nd.n[cell]);
+            if (score > bestScore) { bestScore = score; best = cell; }
+        }
+        return best;
+    }
+
+    // Weighted random pick among the undug cells of `seen`
+    int rolloutCell(const std::array<CellContent, TOTAL_CELLS>& seen, std::mt19937_64& rng) const {
+        double total = 0.0;
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            if (seen[i] == CellContent::Undug) total += rolloutWeight[i];
+        }
+        double pick = std::uniform_real_distribution<double>(0.0, total)(rng);
+        int last = -1;
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            if (seen[i] != CellContent::Undug) continue;
+            last = i;
+            if (pick < rolloutWeight[i]) return i;
+            pick -= rolloutWeight[i];
+        }
+        return last;
+    }
+};
@@ -0,0 +1,194 @@
+/*
+=================================================================================================
+FILE: src/perf_counters.h
+
+DESCRIPTION:
+This file reads the CPU's hardware performance counters (cycles, instructions, branch misses,
+L1 data cache misses and last-level cache misses) around each stage of `solve()`, using the
+Linux `perf_event_open` system call.
+
+IMPORTANCE:
+Knowing that a solve is slow is not enough to fix it. The counters tell *why*: a low number of
+instructions per cycle with many branch misses points at unpredictable branches (the backtracker
+is full of them), many cache misses point at memory layout, and a high instruction count at
+plain work that needs a better algorithm.
+
+INTERACTION:
+- `StagePerfProfiler` is a `SolveStageObserver` (solver.h): attach it to a solver and every
+  solve() is measured stage by stage.
+- Used by the --perf option of the `stress bench` and `session replay` commands of `src/cli.cpp`.
+- Linux only. On other systems (or when the kernel refuses, e.g. perf_event_paranoid or a VM
+  without a virtual PMU) `available()` is false and nothing is measured.
+
+HOW IT WORKS:
+1. One counter file descriptor per event, counting this thread in user mode only. The events
+   form one group: the first one that opens is the leader, the others join it. The kernel
+   always schedules a group as a whole, so all the counters cover the same instructions.
+2. At every stage change the whole group is read with a single read() of the leader
+   (PERF_FORMAT_GROUP); the difference since the previous read is added to the stage that
+   just ended. (Five separate reads would be five system calls inside the measured stages.)
+3. When the kernel has more events than hardware counters it takes turns ("multiplexing");
+   the values are then scaled by time enabled / time running, as `perf stat` does. The group
+   shares one pair of times, so the ratios between counters (e.g. instructions per cycle)
+   stay exact.
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// The measured events
+enum PerfEvent {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    NUM_PERF_EVENTS
+};
+
+inline const char* perfEventName(int e) {
+    static const char* const names[NUM_PERF_EVENTS] = {"cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses"};
+    return names[e];
+}
+
+// Counter totals (per stage or overall). Events that could not be opened stay at 0.
+struct PerfTotals {
+    double v[NUM_PERF_EVENTS] = {};
+
+    void add(const PerfTotals& o) {
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) v[e] += o.v[e];
+    }
+};
+
+class PerfCounters {
+public:
+    PerfCounters() = default;
+    ~PerfCounters() { close(); }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Opens the counters for the calling thread. Returns false if none could be opened.
+    bool open() {
+        close();
+#ifdef __linux__
+        const uint64_t cache = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        const struct { uint32_t type; uint64_t config; } events[NUM_PERF_EVENTS] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cache},
+        };
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[e].type;
+            attr.config = events[e].config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            // This thread, any CPU, in the group of the leader (-1: this one is the leader)
+            fds[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+            if (fds[e] < 0) {
+                if (lastError.empty()) lastError = std::string(perfEventName(e)) + ": " + std::strerror(errno);
+                continue;
+            }
+            if (leader < 0) leader = fds[e];
+            slot[e] = members++; // Group reads list the values in the order the events joined
+        }
+#else
+        lastError = "hardware counters need Linux (perf_event_open)";
+#endif
+        return available();
+    }
+
+    void close() {
+#ifdef __linux__
+        for (int& fd : fds) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+#endif
+        for (int& s : slot) s = -1;
+        leader = -1;
+        members = 0;
+    }
+
+    bool available() const {
+        for (int fd : fds) if (fd >= 0) return true;
+        return false;
+    }
+    bool has(int e) const { return fds[e] >= 0; }
+
+    // Why the counters (or some of them) could not be opened
+    const std::string& error() const { return lastError; }
+
+    // Current scaled value of every counter
+    void read(PerfTotals& out) const {
+        out = PerfTotals();
+#ifdef __linux__
+        uint64_t buf[3 + NUM_PERF_EVENTS]; // Number of values, time enabled, time running, values
+        ssize_t want = static_cast<ssize_t>((3 + members) * sizeof(uint64_t));
+        if (leader < 0 || ::read(leader, buf, sizeof(buf)) != want || buf[2] == 0) return;
+        double scale = static_cast<double>(buf[1]) / buf[2];
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            if (slot[e] >= 0) out.v[e] = static_cast<double>(buf[3 + slot[e]]) * scale;
+        }
+#endif
+    }
+
+private:
+    int fds[NUM_PERF_EVENTS] = {-1, -1, -1, -1, -1};
+    int slot[NUM_PERF_EVENTS] = {-1, -1, -1, -1, -1}; // Position of each event in a group read
+    int leader = -1;                                 // fd read for the whole group
+    int members = 0;
+    std::string lastError;
+};
+
+/*
+ * StagePerfProfiler
+ * -----------------
+ * Adds up the counters per solve() stage. Attach with `solver.stageObserver = &profiler`.
+ */
+class StagePerfProfiler : public SolveStageObserver {
+public:
+    PerfCounters counters;
+    PerfTotals stages[NUM_SOLVE_STAGES];
+    long long solves = 0;
+
+    void onStage(SolveStage stage) override {
+        PerfTotals now;
+        counters.read(now);
+        if (current >= 0) {
+            for (int e = 0; e < NUM_PERF_EVENTS; e++) stages[current].v[e] += now.v[e] - last.v[e];
+        }
+        last = now;
+        if (stage == SolveStage::Done) {
+            current = -1;
+            solves++;
+        } else {
+            current = static_cast<int>(stage);
+        }
+    }
+
+    void clear() {
+        for (PerfTotals& t : stages) t = PerfTotals();
+        solves = 0;
+        current = -1;
+    }
+
+private:
+    int current = -1;
+    PerfTotals last;
+};
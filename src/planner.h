@@ -0,0 +1,299 @@
+/*
+=================================================================================================
+FILE: src/planner.h
+
+DESCRIPTION:
+This file contains a look-ahead planner that answers the question "Where should I dig next?".
+It searches several digs ahead (depth-k expectimax) and picks the cell with the best expected
+rupee haul, instead of just picking the cell with the lowest "Bad" percentage.
+
+IMPORTANCE:
+The lowest-risk cell is not always the best one: a slightly riskier cell may reveal a clue that
+makes the next few digs much safer, or sit in a spot likely to hold a silver/gold rupee.
+Only searching ahead can see that.
+
+INTERACTION:
+- Includes "solver.h" and runs `ThrillDiggerSolver::solve()` on "what if" boards.
+- Used by `src/main.cpp` (the "Suggest" button).
+
+ALGORITHM OVERVIEW:
+1. Max nodes: the player picks a cell to dig (or stops, which is worth 0 more rupees).
+2. Chance nodes: the game reveals an outcome. The probability of each outcome comes from the
+   solver: P(cell shows Blue) = totalWays(board + Blue at cell) / totalWays(board).
+3. Every solve is cached by canonical packed board (mirror images share one entry),
+   and finished sub-searches are stored in a transposition table keyed by (board, depth).
+4. Before searching a dig, an optimistic bound on its value is computed from the outcome
+   distribution alone. If even that bound can't beat the best dig found so far, it is skipped.
+5. Iterative deepening: search depth 1, 2, 3... until the time budget runs out and keep the
+   answer from the deepest search that finished.
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include <chrono>
+
+// =================================================================================================
+// GAME VALUES
+// =================================================================================================
+
+// Rupee value of each outcome. A bomb ends the game (you keep what you already have).
+inline int rupeeValue(CellContent c) {
+    switch (c) {
+        case CellContent::Green:  return 1;
+        case CellContent::Blue:   return 5;
+        case CellContent::Red:    return 20;
+        case CellContent::Silver: return 100;
+        case CellContent::Gold:   return 300;
+        case CellContent::Rupoor: return -10;
+        default: return 0;
+    }
+}
+
+constexpr int MAX_RUPEE_VALUE = 300; // Best single dig (Gold rupee)
+
+// Outcomes of one dig, in CellContent order: Green..Gold, Rupoor, Bomb
+constexpr int NUM_OUTCOMES = 7;
+inline CellContent outcomeContent(int o) { return static_cast<CellContent>(o + 1); }
+
+// =================================================================================================
+// PLANNER
+// =================================================================================================
+
+// What the planner recommends.
+struct PlanResult {
+    int cell = -1;        // Board index to dig (-1 = stop / nothing to dig)
+    double value = 0.0;   // Expected rupees over the next `depth` digs
+    int depth = 0;        // Deepest search that finished within the budget
+    long long nodes = 0;  // Search nodes visited (all iterations)
+    long long solves = 0; // Solver calls that missed the cache
+};
+
+class ExpectimaxPlanner {
+public:
+    // A cached solve, stored in the orientation of the canonical board
+    struct SolveEntry {
+        double totalWays;
+        std::array<double, TOTAL_CELLS> badProb;
+    };
+
+    // Limit on cache sizes; caches are simply cleared when they grow past this
+    size_t maxCacheEntries = 1 << 20;
+
+    /*
+     * plan
+     * ----
+     * Runs iterative deepening from depth 1 up to `maxDepth`, stopping once `budgetMs`
+     * milliseconds have passed. Returns the answer of the deepest finished search.
+     * Depth 1 always runs to the end, even past the budget: it is one solve per outcome of
+     * each cell, and without it there would be no answer at all (cell -1 means "stop", which
+     * must be advice and never "ran out of time").
+     */
+    PlanResult plan(const std::array<CellContent, TOTAL_CELLS>& grid, int maxDepth, int budgetMs) {
+        PlanResult result;
+        const auto budgetEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(budgetMs);
+        timedOut = false;
+        nodes = 0;
+        solves = 0;
+
+        if (solveCache.size() > maxCacheEntries) solveCache.clear();
+        if (table.size() > maxCacheEntries) table.clear();
+
+        for (int depth = 1; depth <= maxDepth; depth++) {
+            deadline = depth == 1 ? std::chrono::steady_clock::time_point::max() : budgetEnd;
+            int bestCell = -1;
+            double v = search(grid, depth, &bestCell);
+            if (timedOut) break; // Unfinished iteration: keep the previous answer
+            result.cell = bestCell;
+            result.value = v;
+            result.depth = depth;
+            if (bestCell < 0) break; // Nothing worth digging, deeper won't change that
+        }
+        result.nodes = nodes;
+        result.solves = solves;
+        return result;
+    }
+
+    // Solver badProb of `cell` on `grid` (cached, like every solve of the planner)
+    double badProb(const std::array<CellContent, TOTAL_CELLS>& grid, int cell) {
+        const SolveEntry& e = cachedSolve(grid);
+        return e.badProb[symmetryCell(cell, lastSym)];
+    }
+
+    /*
+     * outcomeDistribution
+     * -------------------
+     * Probability of each outcome (Green..Gold, Rupoor, Bomb) when digging `cell`.
+     * Rupee outcomes come from counting layouts of "what if" boards. The bad outcome is the
+     * cell's badProb, split between Rupoor and Bomb in proportion to how many of each are
+     * still hidden (they are interchangeable as far as the clues are concerned).
+     */
+    std::array<double, NUM_OUTCOMES> outcomeDistribution(
+        std::array<CellContent, TOTAL_CELLS> grid, int cell)
+    {
+        std::array<double, NUM_OUTCOMES> dist{};
+        const SolveEntry& base = cachedSolve(grid);
+        if (base.totalWays <= 0.0) return dist;
+        int baseSym = lastSym;
+
+        for (int o = 0; o < NUM_OUTCOMES - 2; o++) {
+            grid[cell] = outcomeContent(o);
+            dist[o] = cachedSolve(grid).totalWays / base.totalWays;
+        }
+        grid[cell] = CellContent::Undug;
+
+        double pBad = base.badProb[symmetryCell(cell, baseSym)];
+        int bombsLeft = TOTAL_BOMBS, rupoorsLeft = TOTAL_RUPOORS;
+        for (CellContent c : grid) {
+            if (c == CellContent::Bomb) bombsLeft--;
+            if (c == CellContent::Rupoor) rupoorsLeft--;
+        }
+        if (bombsLeft + rupoorsLeft > 0) {
+            dist[NUM_OUTCOMES - 2] = pBad * rupoorsLeft / (bombsLeft + rupoorsLeft);
+            dist[NUM_OUTCOMES - 1] = pBad * bombsLeft / (bombsLeft + rupoorsLeft);
+        }
+        return dist;
+    }
+
+private:
+    // A finished sub-search stored in the transposition table
+    struct TableEntry {
+        double value;
+        int bestCell; // In canonical orientation (-1 = stop)
+    };
+
+    // Key for the transposition table: board + remaining depth
+    struct TableKey {
+        PackedBoard board;
+        int depth;
+        bool operator==(const TableKey& o) const { return board == o.board && depth == o.depth; }
+    };
+    struct TableKeyHash {
+        size_t operator()(const TableKey& k) const {
+            return PackedBoardHash()(k.board) * 31 + static_cast<size_t>(k.depth);
+        }
+    };
+
+    std::unordered_map<PackedBoard, SolveEntry, PackedBoardHash> solveCache;
+    std::unordered_map<TableKey, TableEntry, TableKeyHash> table;
+    ThrillDiggerSolver solver;
+
+    std::chrono::steady_clock::time_point deadline;
+    bool timedOut = false;
+    long long nodes = 0;
+    long long solves = 0;
+    int lastSym = 0; // Symmetry used by the most recent cachedSolve() lookup
+
+    /*
+     * cachedSolve
+     * -----------
+     * Solves `grid`, or reuses the result if this board (or a mirror image of it) was seen before.
+     * Sets `lastSym` so callers can map cell indices into the cached orientation.
+     */
+    const SolveEntry& cachedSolve(const std::array<CellContent, TOTAL_CELLS>& grid) {
+        PackedBoard key = canonicalBoard(grid, &lastSym);
+        auto it = solveCache.find(key);
+        if (it != solveCache.end()) return it->second;
+
+        solves++;
+        solver.reset();
+        solver.grid = grid;
+        solver.solve();
+
+        SolveEntry e;
+        e.totalWays = solver.totalWays;
+        for (int i = 0; i < TOTAL_CELLS; i++) e.badProb[symmetryCell(i, lastSym)] = solver.badProb[i];
+        return solveCache.emplace(key, e).first->second;
+    }
+
+    // Upper bound on the value of any position with `depth` digs left
+    static double optimisticValue(int depth) { return static_cast<double>(depth) * MAX_RUPEE_VALUE; }
+
+    /*
+     * search
+     * ------
+     * Expectimax value of `grid` with `depth` digs left. Writes the best cell (in `grid`'s own
+     * orientation) to `bestCellOut`, or -1 if stopping is best.
+     */
+    double search(std::array<CellContent, TOTAL_CELLS> grid, int depth, int* bestCellOut) {
+        *bestCellOut = -1;
+        if (depth == 0 || timedOut) return 0.0;
+
+        // Check the clock every few hundred nodes (reading it is not free)
+        if ((++nodes & 255) == 0 && std::chrono::steady_clock::now() > deadline) {
+            timedOut = true;
+            return 0.0;
+        }
+
+        int sym = 0;
+        TableKey key{canonicalBoard(grid, &sym), depth};
+        auto hit = table.find(key);
+        if (hit != table.end()) {
+            if (hit->second.bestCell >= 0) *bestCellOut = symmetryCell(hit->second.bestCell, sym);
+            return hit->second.value;
+        }
+
+        // Step 1: Outcome distribution and bounds for every undug cell
+        struct Candidate {
+            int cell;
+            std::array<double, NUM_OUTCOMES> dist;
+            double upper; // Optimistic value (best possible future after this dig)
+            double lower; // Pessimistic value (dig, then stop)
+        };
+        std::vector<Candidate> candidates;
+        double best = 0.0; // Stopping is always allowed and worth 0
+        int bestCell = -1;
+        for (int cell = 0; cell < TOTAL_CELLS; cell++) {
+            if (grid[cell] != CellContent::Undug) continue;
+            Candidate cand;
+            cand.cell = cell;
+            cand.dist = outcomeDistribution(grid, cell);
+            cand.upper = 0.0;
+            cand.lower = 0.0;
+            for (int o = 0; o < NUM_OUTCOMES; o++) {
+                if (cand.dist[o] <= 0.0) continue;
+                double reward = rupeeValue(outcomeContent(o));
+                bool gameOver = outcomeContent(o) == CellContent::Bomb;
+                cand.lower += cand.dist[o] * reward;
+                cand.upper += cand.dist[o] * (reward + (gameOver ? 0.0 : optimisticValue(depth - 1)));
+            }
+            // Digging once and stopping is a real option, so it already counts as a result
+            if (cand.lower > best) { best = cand.lower; bestCell = cell; }
+            candidates.push_back(cand);
+        }
+        if (candidates.empty()) return 0.0;
+
+        // Step 2: Search the most promising cells first so the pruning bites early
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return a.upper > b.upper;
+        });
+
+        for (const Candidate& cand : candidates) {
+            if (cand.upper <= best) break; // Sorted: no later cell can win either
+
+            double value = 0.0;
+            if (depth == 1) {
+                value = cand.lower; // No future digs: the immediate reward is the whole value
+            } else {
+                for (int o = 0; o < NUM_OUTCOMES; o++) {
+                    if (cand.dist[o] <= 0.0) continue;
+                    CellContent outcome = outcomeContent(o);
+                    double future = 0.0;
+                    if (outcome != CellContent::Bomb) {
+                        grid[cand.cell] = outcome;
+                        int unused;
+                        future = search(grid, depth - 1, &unused);
+                        grid[cand.cell] = CellContent::Undug;
+                    }
+                    value += cand.dist[o] * (rupeeValue(outcome) + future);
+                }
+            }
+            if (timedOut) return 0.0;
+            if (value > best) { best = value; bestCell = cand.cell; }
+        }
+
+        table[key] = {best, bestCell >= 0 ? symmetryCell(bestCell, sym) : -1};
+        *bestCellOut = bestCell;
+        return best;
+    }
+};
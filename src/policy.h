@@ -0,0 +1,524 @@
+/*
+=================================================================================================
+FILE: src/policy.h
+
+DESCRIPTION:
+This file contains the exact optimal-policy solver. Given any Expert position it computes,
+by brute force dynamic programming over every possible future, the best possible dig for two
+different goals:
+- Survival: maximize the chance of digging up every rupee without ever hitting a bomb.
+- Expected value (EV): maximize the average rupees collected (walking away is allowed).
+The results are written to a policy table file that can be memory-mapped and queried later.
+
+IMPORTANCE:
+Every other engine (planner, MCTS) is an approximation. This one is the ground truth they can
+be measured against. It is an offline tool: from early positions it can run for hours, so it
+uses all cores, checkpoints its progress to disk and can resume after an interruption.
+
+INTERACTION:
+- Includes "solver.h" (transition probabilities) and "planner.h" (rupee values, outcomes).
+- Includes "mapped_file.h" to open policy tables without loading them into RAM.
+- Driven by the `policy` command of `src/cli.cpp`.
+
+ALGORITHM OVERVIEW:
+1. A position ("state") is the board the player sees. States are stored by canonical packed
+   board, so mirror-image positions are solved only once.
+2. value(state) = best over undug cells of the sum over outcomes of
+   P(outcome) x (rupees of the outcome + value(next state)). Bombs end the game.
+   P(outcome) = totalWays(next state) / totalWays(state), exactly like the planner. Both counts
+   are kept in double precision, the same as the solver produces them.
+3. Solved states live in a fixed-size, lock-striped hash table of 32-byte entries (plus the
+   8-byte layout count of each entry, stored in a parallel array).
+   When it is full, old entries are overwritten: that only costs time (they get recomputed),
+   never correctness.
+4. Work distribution: the states a few digs below the root are handed out to the threads
+   through an atomic counter; the root is finished last, mostly from the table.
+5. Policy file: a header followed by fixed-size 24-byte records sorted by key, with
+   probabilities and rupees quantized to 16 bits. Lookups are a binary search on the mapping.
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include "planner.h"
+#include "mapped_file.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// =================================================================================================
+// VALUES AND FILE FORMAT
+// =================================================================================================
+
+constexpr uint8_t POLICY_NO_CELL = 255; // "Stop" / no dig possible
+
+// Solved value of one state. Best cells are in the state's canonical orientation.
+struct PolicyValue {
+    double ways = -1.0;      // Consistent hidden layouts (-1 = unknown, e.g. loaded from a file)
+    float survival = 0.0f;   // Chance of clearing the board without a bomb, with the best play
+    float ev = 0.0f;         // Expected rupees from here on, with the best play
+    uint8_t bestSurvival = POLICY_NO_CELL;
+    uint8_t bestEv = POLICY_NO_CELL;
+};
+
+// Policy file layout (little-endian, as written by the machine that solved it)
+struct PolicyFileHeader {
+    char magic[8];           // "TDPOLCY1"
+    uint32_t recordSize;     // sizeof(PolicyRecord), guards against layout changes
+    uint32_t reserved;
+    uint64_t count;          // Number of records that follow
+};
+
+struct PolicyRecord {
+    uint64_t lo, hi;         // Canonical PackedBoard
+    uint16_t survival;       // Survival chance x 65535
+    uint16_t ev;             // Expected rupees x 8 (1/8 rupee steps, up to 8191 rupees)
+    uint8_t bestSurvival;    // Canonical cell, POLICY_NO_CELL = none
+    uint8_t bestEv;          // Canonical cell, POLICY_NO_CELL = stop
+    uint8_t pad[2];
+};
+static_assert(sizeof(PolicyRecord) == 24, "PolicyRecord must stay 24 bytes");
+
+constexpr char POLICY_MAGIC[8] = {'T', 'D', 'P', 'O', 'L', 'C', 'Y', '1'};
+
+inline PolicyRecord makePolicyRecord(const PackedBoard& key, const PolicyValue& v) {
+    PolicyRecord r = {};
+    r.lo = key.lo;
+    r.hi = key.hi;
+    r.survival = static_cast<uint16_t>(std::lround(std::clamp(v.survival, 0.0f, 1.0f) * 65535.0f));
+    r.ev = static_cast<uint16_t>(std::lround(std::clamp(v.ev * 8.0f, 0.0f, 65535.0f)));
+    r.bestSurvival = v.bestSurvival;
+    r.bestEv = v.bestEv;
+    return r;
+}
+
+inline PolicyValue policyValueFromRecord(const PolicyRecord& r) {
+    PolicyValue v;
+    v.survival = r.survival / 65535.0f;
+    v.ev = r.ev / 8.0f;
+    v.bestSurvival = r.bestSurvival;
+    v.bestEv = r.bestEv;
+    return v; // ways stays unknown: it is cheap to recompute and not worth the space
+}
+
+/*
+ * writePolicyFile
+ * ---------------
+ * Sorts `records` by key and writes them out. The data goes to "<path>.tmp" first and is
+ * renamed at the end, so an interrupted write never destroys the previous checkpoint.
+ */
+inline bool writePolicyFile(const std::string& path, std::vector<PolicyRecord>& records) {
+    std::sort(records.begin(), records.end(), [](const PolicyRecord& a, const PolicyRecord& b) {
+        return a.hi != b.hi ? a.hi < b.hi : a.lo < b.lo;
+    });
+    std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    PolicyFileHeader h = {};
+    std::memcpy(h.magic, POLICY_MAGIC, sizeof(h.magic));
+    h.recordSize = sizeof(PolicyRecord);
+    h.count = records.size();
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1;
+    if (ok && !records.empty()) {
+        ok = std::fwrite(records.data(), sizeof(PolicyRecord), records.size(), f) == records.size();
+    }
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) return false;
+    std::remove(path.c_str()); // Windows' rename refuses to overwrite
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+/*
+ * PolicyTable
+ * -----------
+ * Read-only view of a policy file, memory-mapped. Lookups canonicalize the board,
+ * binary-search the records, and map the best cells back to the caller's orientation.
+ */
+class PolicyTable {
+public:
+    bool open(const std::string& path) {
+        if (!file.open(path)) return false;
+        if (file.size() < sizeof(PolicyFileHeader)) { file.close(); return false; }
+        PolicyFileHeader h;
+        std::memcpy(&h, file.data(), sizeof(h));
+        if (std::memcmp(h.magic, POLICY_MAGIC, sizeof(h.magic)) != 0 || h.recordSize != sizeof(PolicyRecord)
+            || file.size() < sizeof(h) + h.count * sizeof(PolicyRecord)) {
+            file.close();
+            return false;
+        }
+        records = reinterpret_cast<const PolicyRecord*>(file.data() + sizeof(h));
+        count = static_cast<size_t>(h.count);
+        return true;
+    }
+
+    size_t size() const { return count; }
+    const PolicyRecord* begin() const { return records; }
+    const PolicyRecord* end() const { return records + count; }
+
+    // Finds `grid`. Best cells in `out` are in `grid`'s orientation.
+    bool lookup(const std::array<CellContent, TOTAL_CELLS>& grid, PolicyValue& out) const {
+        int sym = 0;
+        PackedBoard key = canonicalBoard(grid, &sym);
+        const PolicyRecord* last = records + count;
+        const PolicyRecord* it = std::lower_bound(records, last, key, [](const PolicyRecord& r, const PackedBoard& k) {
+            return r.hi != k.hi ? r.hi < k.hi : r.lo < k.lo;
+        });
+        if (it == last || it->hi != key.hi || it->lo != key.lo) return false;
+        out = policyValueFromRecord(*it);
+        if (out.bestSurvival != POLICY_NO_CELL) out.bestSurvival = (uint8_t)symmetryCell(out.bestSurvival, sym);
+        if (out.bestEv != POLICY_NO_CELL) out.bestEv = (uint8_t)symmetryCell(out.bestEv, sym);
+        return true;
+    }
+
+private:
+    MappedFile file;
+    const PolicyRecord* records = nullptr;
+    size_t count = 0;
+};
+
+// =================================================================================================
+// STATE TABLE
+// =================================================================================================
+
+/*
+ * PolicyStateTable
+ * ----------------
+ * Fixed-size hash table shared by all solver threads. Slots are grouped in buckets of 8
+ * (one bucket = 256 bytes, a few cache lines); each bucket is guarded by one of a fixed pool
+ * of mutexes. A full bucket overwrites one of its entries.
+ * The layout counts are doubles and would not fit the 32-byte slots, so they live in a
+ * parallel array (same index, same lock).
+ */
+class PolicyStateTable {
+public:
+    static constexpr int BUCKET_SLOTS = 8;
+    static constexpr size_t NUM_LOCKS = 4096;
+
+    explicit PolicyStateTable(size_t bytes) : locks(new std::mutex[NUM_LOCKS]) {
+        size_t buckets = 1;
+        while ((buckets * 2) * BUCKET_SLOTS * (sizeof(Slot) + sizeof(double)) <= bytes) buckets *= 2;
+        bucketMask = buckets - 1;
+        slots.assign(buckets * BUCKET_SLOTS, Slot{});
+        slotWays.assign(buckets * BUCKET_SLOTS, -1.0);
+    }
+
+    bool find(const PackedBoard& key, PolicyValue& out) {
+        size_t b = bucketOf(key);
+        std::lock_guard<std::mutex> guard(locks[b % NUM_LOCKS]);
+        for (int i = 0; i < BUCKET_SLOTS; i++) {
+            size_t idx = b * BUCKET_SLOTS + i;
+            const Slot& s = slots[idx];
+            if (s.hi == (key.hi | OCCUPIED) && s.lo == key.lo) {
+                out = s.value;
+                out.ways = slotWays[idx];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void insert(const PackedBoard& key, const PolicyValue& value) {
+        size_t b = bucketOf(key);
+        std::lock_guard<std::mutex> guard(locks[b % NUM_LOCKS]);
+        size_t empty = NO_SLOT;
+        for (int i = 0; i < BUCKET_SLOTS; i++) {
+            size_t idx = b * BUCKET_SLOTS + i;
+            Slot& s = slots[idx];
+            if (s.hi == (key.hi | OCCUPIED) && s.lo == key.lo) { store(idx, value); return; }
+            if (empty == NO_SLOT && !(s.hi & OCCUPIED)) empty = idx;
+        }
+        if (empty != NO_SLOT) {
+            used.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // Bucket full: overwrite a slot picked by other bits of the hash
+            empty = b * BUCKET_SLOTS + (PackedBoardHash()(key) >> 40) % BUCKET_SLOTS;
+        }
+        slots[empty].lo = key.lo;
+        slots[empty].hi = key.hi | OCCUPIED;
+        store(empty, value);
+    }
+
+    size_t capacity() const { return slots.size(); }
+    size_t entries() const { return used.load(std::memory_order_relaxed); }
+
+    // Copies every entry out as file records (safe while other threads keep working)
+    std::vector<PolicyRecord> snapshot() {
+        std::vector<PolicyRecord> out;
+        out.reserve(entries());
+        for (size_t b = 0; b <= bucketMask; b++) {
+            std::lock_guard<std::mutex> guard(locks[b % NUM_LOCKS]);
+            for (int i = 0; i < BUCKET_SLOTS; i++) {
+                const Slot& s = slots[b * BUCKET_SLOTS + i];
+                if (!(s.hi & OCCUPIED)) continue;
+                PackedBoard key;
+                key.lo = s.lo;
+                key.hi = s.hi & ~OCCUPIED;
+                out.push_back(makePolicyRecord(key, s.value));
+            }
+        }
+        return out;
+    }
+
+private:
+    // PackedBoard::hi only uses 57 bits, so the top bit marks a slot as occupied
+    static constexpr uint64_t OCCUPIED = uint64_t(1) << 63;
+    static constexpr size_t NO_SLOT = ~size_t(0);
+
+    // PolicyValue without its layout count (that one is in slotWays)
+    struct SlotValue {
+        float survival = 0.0f;
+        float ev = 0.0f;
+        uint8_t bestSurvival = POLICY_NO_CELL;
+        uint8_t bestEv = POLICY_NO_CELL;
+
+        SlotValue& operator=(const PolicyValue& v) {
+            survival = v.survival;
+            ev = v.ev;
+            bestSurvival = v.bestSurvival;
+            bestEv = v.bestEv;
+            return *this;
+        }
+        operator PolicyValue() const {
+            PolicyValue v;
+            v.survival = survival;
+            v.ev = ev;
+            v.bestSurvival = bestSurvival;
+            v.bestEv = bestEv;
+            return v;
+        }
+    };
+
+    struct Slot {
+        uint64_t lo = 0, hi = 0;
+        SlotValue value;
+    };
+    static_assert(sizeof(Slot) == 32, "Slot must stay 32 bytes");
+
+    std::vector<Slot> slots;
+    std::vector<double> slotWays; // slotWays[i] = PolicyValue::ways of slots[i]
+    size_t bucketMask = 0;
+    std::unique_ptr<std::mutex[]> locks;
+    std::atomic<size_t> used{0};
+
+    size_t bucketOf(const PackedBoard& key) const { return PackedBoardHash()(key) & bucketMask; }
+
+    // Caller holds the bucket's lock
+    void store(size_t idx, const PolicyValue& value) {
+        slots[idx].value = value;
+        slotWays[idx] = value.ways;
+    }
+};
+
+// =================================================================================================
+// SOLVER
+// =================================================================================================
+
+// Progress report passed to PolicySolver::onProgress
+struct PolicyProgress {
+    long long statesSolved;  // States computed so far (including recomputations)
+    size_t tableEntries;     // States currently stored
+    size_t tableCapacity;
+    size_t tasksDone, tasksTotal;
+    double seconds;
+};
+
+class PolicySolver {
+public:
+    int threads = 0;                 // 0 = one per hardware thread
+    int splitDepth = 2;              // Digs below the root where work is handed out
+    double checkpointSeconds = 300;  // How often to write the checkpoint (if a path is set)
+    std::string checkpointPath;
+    std::function<void(const PolicyProgress&)> onProgress; // Called about once per second
+
+    explicit PolicySolver(size_t tableBytes) : table(tableBytes) {}
+
+    // Seeds the table from a checkpoint or policy file written earlier
+    bool loadCheckpoint(const std::string& path) {
+        PolicyTable old;
+        if (!old.open(path)) return false;
+        for (const PolicyRecord& r : old) {
+            PackedBoard key;
+            key.lo = r.lo;
+            key.hi = r.hi;
+            table.insert(key, policyValueFromRecord(r));
+        }
+        return true;
+    }
+
+    /*
+     * solve
+     * -----
+     * Computes the optimal values of `grid` using all threads. Best cells in the result
+     * are in `grid`'s own orientation.
+     */
+    PolicyValue solve(const std::array<CellContent, TOTAL_CELLS>& grid) {
+        auto start = std::chrono::steady_clock::now();
+        statesSolved.store(0);
+
+        // Step 1: Collect the distinct states `splitDepth` digs below the root
+        std::vector<std::array<CellContent, TOTAL_CELLS>> tasks;
+        std::set<PackedBoard> seen;
+        std::vector<std::array<CellContent, TOTAL_CELLS>> level = {grid};
+        for (int d = 0; d < splitDepth; d++) {
+            std::vector<std::array<CellContent, TOTAL_CELLS>> next;
+            for (const auto& g : level) {
+                for (int c = 0; c < TOTAL_CELLS; c++) {
+                    if (g[c] != CellContent::Undug) continue;
+                    for (int o = 0; o < NUM_OUTCOMES - 1; o++) { // Every outcome but the bomb
+                        auto child = g;
+                        child[c] = outcomeContent(o);
+                        if (seen.insert(canonicalBoard(child)).second) next.push_back(child);
+                    }
+                }
+            }
+            level.swap(next);
+        }
+        tasks.swap(level);
+
+        // Step 2: Threads pull tasks from a shared counter
+        std::atomic<size_t> nextTask{0}, doneTasks{0};
+        auto worker = [&]() {
+            ThrillDiggerSolver solver;
+            for (;;) {
+                size_t t = nextTask.fetch_add(1);
+                if (t >= tasks.size()) break;
+                solveState(tasks[t], solver);
+                doneTasks.fetch_add(1);
+            }
+        };
+        int n = threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::thread> pool;
+        for (int t = 0; t < n; t++) pool.emplace_back(worker);
+
+        // Step 3: Meanwhile this thread reports progress and writes checkpoints
+        auto lastCheckpoint = start;
+        while (doneTasks.load() < tasks.size()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            auto now = std::chrono::steady_clock::now();
+            if (!checkpointPath.empty() &&
+                std::chrono::duration<double>(now - lastCheckpoint).count() >= checkpointSeconds) {
+                writeCheckpoint(checkpointPath);
+                lastCheckpoint = now;
+            }
+            report(start, doneTasks.load(), tasks.size());
+        }
+        for (auto& th : pool) th.join();
+
+        // Step 4: Finish the top of the tree (children are now in the table)
+        ThrillDiggerSolver solver;
+        int sym = 0;
+        canonicalBoard(grid, &sym);
+        PolicyValue root = solveState(grid, solver);
+        report(start, tasks.size(), tasks.size());
+        if (root.bestSurvival != POLICY_NO_CELL) root.bestSurvival = (uint8_t)symmetryCell(root.bestSurvival, sym);
+        if (root.bestEv != POLICY_NO_CELL) root.bestEv = (uint8_t)symmetryCell(root.bestEv, sym);
+        return root;
+    }
+
+    // Writes every stored state (checkpoint and final policy use the same format)
+    bool writeCheckpoint(const std::string& path) {
+        std::vector<PolicyRecord> records = table.snapshot();
+        return writePolicyFile(path, records);
+    }
+
+private:
+    PolicyStateTable table;
+    std::atomic<long long> statesSolved{0};
+
+    void report(std::chrono::steady_clock::time_point start, size_t done, size_t total) {
+        if (!onProgress) return;
+        PolicyProgress p;
+        p.statesSolved = statesSolved.load();
+        p.tableEntries = table.entries();
+        p.tableCapacity = table.capacity();
+        p.tasksDone = done;
+        p.tasksTotal = total;
+        p.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        onProgress(p);
+    }
+
+    /*
+     * solveState
+     * ----------
+     * Exact values of `grid` (best cells in canonical orientation), from the table if possible.
+     * `solver` is the calling thread's own solver instance.
+     */
+    PolicyValue solveState(std::array<CellContent, TOTAL_CELLS> grid, ThrillDiggerSolver& solver) {
+        int sym = 0;
+        PackedBoard key = canonicalBoard(grid, &sym);
+        PolicyValue v;
+        bool cached = table.find(key, v);
+        if (cached && v.ways >= 0.0) return v;
+
+        solver.reset();
+        solver.grid = grid;
+        solver.solve();
+        if (cached) {
+            // Loaded from a file: only the layout count was missing
+            v.ways = solver.totalWays;
+            table.insert(key, v);
+            return v;
+        }
+
+        v = PolicyValue();
+        v.ways = solver.totalWays;
+        int undug = 0;
+        int bombsLeft = TOTAL_BOMBS, rupoorsLeft = TOTAL_RUPOORS;
+        for (CellContent c : grid) {
+            if (c == CellContent::Undug) undug++;
+            if (c == CellContent::Bomb) bombsLeft--;
+            if (c == CellContent::Rupoor) rupoorsLeft--;
+        }
+        if (v.ways <= 0.0 || undug - solver.remainingBadCount <= 0) {
+            // Contradiction (never reached) or every rupee found (game won)
+            v.survival = v.ways > 0.0 ? 1.0f : 0.0f;
+            table.insert(key, v);
+            return v;
+        }
+
+        // The solver is reused by the children, so keep what we need from this solve
+        std::array<double, TOTAL_CELLS> badProb = solver.badProb;
+        double ways = solver.totalWays;
+        double bestSurvival = -1.0, bestEv = 0.0; // Stopping is worth 0 rupees
+
+        for (int c = 0; c < TOTAL_CELLS; c++) {
+            if (grid[c] != CellContent::Undug) continue;
+            double survival = 0.0, ev = 0.0;
+
+            // Rupee outcomes: probability from the child's layout count (both counts are doubles)
+            for (int o = 0; o < NUM_OUTCOMES - 2; o++) {
+                grid[c] = outcomeContent(o);
+                PolicyValue child = solveState(grid, solver);
+                double p = child.ways / ways;
+                if (p <= 0.0) continue;
+                survival += p * child.survival;
+                ev += p * (rupeeValue(outcomeContent(o)) + child.ev);
+            }
+
+            // Rupoor: the game goes on (a bomb adds nothing to either value)
+            double pRupoor = (bombsLeft + rupoorsLeft > 0)
+                ? badProb[c] * rupoorsLeft / (bombsLeft + rupoorsLeft) : 0.0;
+            if (pRupoor > 0.0) {
+                grid[c] = CellContent::Rupoor;
+                PolicyValue child = solveState(grid, solver);
+                survival += pRupoor * child.survival;
+                ev += pRupoor * (rupeeValue(CellContent::Rupoor) + child.ev);
+            }
+            grid[c] = CellContent::Undug;
+
+            if (survival > bestSurvival) { bestSurvival = survival; v.bestSurvival = (uint8_t)symmetryCell(c, sym); }
+            if (ev > bestEv) { bestEv = ev; v.bestEv = (uint8_t)symmetryCell(c, sym); }
+        }
+
+        v.survival = static_cast<float>(std::max(bestSurvival, 0.0));
+        v.ev = static_cast<float>(bestEv);
+        statesSolved.fetch_add(1, std::memory_order_relaxed);
+        table.insert(key, v);
+        return v;
+    }
+};
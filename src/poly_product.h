@@ -0,0 +1,327 @@
+/*
+=================================================================================================
+FILE: src/poly_product.h
+
+DESCRIPTION:
+This file multiplies many polynomials together quickly: an FFT-based convolution for long
+polynomials, a scaled polynomial type whose coefficients can't overflow, and a "product tree"
+that gives both the product of all polynomials and, for each one, the product of all the others.
+
+IMPORTANCE:
+The solver combines its components by multiplying their count polynomials (coefficient k = number
+of ways to hide k bad items in that component). On the 40-cell board there are only a few short
+ones, but a large custom board can have thousands of components and polynomials hundreds of
+terms long. Multiplying them one after the other, and again once per component to leave that
+component out (Step 7 of solve()), is then quadratic in the number of components and dominates
+the whole solve. The product tree brings this down to about n log n multiplications, and the
+FFT makes each long multiplication near-linear in its length.
+
+INTERACTION:
+- Included by `src/solver.h`: `solve()` uses `PolyProductTree` for Steps 6-8, and
+  `ThrillDiggerSolver::combineScaled` (large boards) uses it on `ScaledPoly`s, whose long
+  products go through `fftConvolve`.
+- Everything allocates from a `std::pmr::memory_resource` passed in by the caller (the solver's
+  `memory`).
+
+HOW IT WORKS:
+1. fftConvolve: evaluate both polynomials at the N-th roots of unity (fast Fourier transform),
+   multiply the values pointwise and transform back. O(N log N) instead of O(n * m).
+   Floating-point FFT rounding is about 1e-16 times the LARGEST coefficient, so small
+   coefficients lose relative precision: it is only used on ScaledPolys, which are tilted so the
+   coefficient we need is among the largest (see combineScaled).
+2. PolyProductTree: the polynomials are the leaves of a balanced binary tree; every inner node
+   holds the product of its two children, so the root is the product of everything.
+   Going back down, each node gets the product of everything OUTSIDE it:
+   outside(child) = outside(parent) * sibling. At a leaf that is "all others", without any
+   division (which would not be exact, and impossible on zero counts).
+3. Only degree D (the number of bad items left) of the total is ever read, so every product is
+   cut off after degree D, and outside(v) is only needed at the degrees that still combine
+   with some degree of v's own product to make D: degrees D - deg(v) .. D. That window has
+   deg(v) + 1 coefficients, so the whole way down costs about as much as the way up. Without
+   it every leaf would hold a full-length "all others" product: n leaves times D coefficients.
+   A window of a product is a "middle product"; see middleProduct.
+=================================================================================================
+*/
+
+#pragma once
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <limits>
+#include <memory_resource>
+
+/*
+ * fftTransform
+ * ------------
+ * In-place iterative radix-2 FFT of `n` (a power of two) values. `invert` computes the inverse
+ * transform (including the division by n). The roots of unity are computed directly with
+ * cos/sin instead of by repeated multiplication, which would accumulate rounding error.
+ */
+inline void fftTransform(std::complex<double>* a, size_t n, bool invert, std::pmr::memory_resource* mr) {
+    // Bit-reversal permutation
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+
+    const double pi = std::acos(-1.0);
+    std::pmr::vector<std::complex<double>> roots(n / 2, mr);
+    for (size_t k = 0; k < n / 2; k++) {
+        double angle = 2.0 * pi * static_cast<double>(k) / static_cast<double>(n) * (invert ? 1.0 : -1.0);
+        roots[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+
+    // Butterflies: blocks of `len` values, root step n / len
+    for (size_t len = 2; len <= n; len <<= 1) {
+        size_t step = n / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                std::complex<double> u = a[i + k];
+                std::complex<double> v = a[i + k + len / 2] * roots[k * step];
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+            }
+        }
+    }
+    if (invert) {
+        for (size_t i = 0; i < n; i++) a[i] /= static_cast<double>(n);
+    }
+}
+
+/*
+ * fftConvolve
+ * -----------
+ * out = a * b (out gets na + nb - 1 coefficients). Both inputs go into one complex array as
+ * real and imaginary parts, so one forward transform serves both.
+ * Coefficients that should be 0 may come out as tiny negative numbers; they are set to 0.
+ */
+inline void fftConvolve(const double* a, size_t na, const double* b, size_t nb, std::pmr::vector<double>& out,
+                        std::pmr::memory_resource* mr) {
+    out.assign(na + nb - 1, 0.0);
+    size_t n = 1;
+    while (n < na + nb - 1) n <<= 1;
+
+    std::pmr::vector<std::complex<double>> f(n, mr);
+    for (size_t i = 0; i < na; i++) f[i].real(a[i]);
+    for (size_t i = 0; i < nb; i++) f[i].imag(b[i]);
+    fftTransform(f.data(), n, false, mr);
+
+    // With f = A + iB: A(k) = (f(k) + conj(f(-k))) / 2, B(k) = (f(k) - conj(f(-k))) / 2i,
+    // so A(k) * B(k) = (f(k)^2 - conj(f(-k))^2) / 4i
+    std::pmr::vector<std::complex<double>> g(n, mr);
+    for (size_t k = 0; k < n; k++) {
+        std::complex<double> x = f[k];
+        std::complex<double> y = std::conj(f[(n - k) & (n - 1)]);
+        g[k] = (x * x - y * y) / std::complex<double>(0.0, 4.0);
+    }
+    fftTransform(g.data(), n, true, mr);
+    for (size_t i = 0; i < out.size(); i++) out[i] = std::max(0.0, g[i].real());
+}
+
+// Both factors at least this long: fftConvolve is faster than the direct double loop
+constexpr size_t FFT_CONVOLVE_MIN_SIZE = 64;
+
+/*
+ * middleProduct
+ * -------------
+ * out[i] = coefficient `offset + i` of a * b, for i = 0..out.size()-1 (out must already have
+ * its size and hold zeros). `mulAdd(sum, x, y)` returns sum + x * y in the caller's arithmetic
+ * (plain doubles, or modulo a prime).
+ */
+template <class Out, class A, class B, class MulAdd>
+void middleProduct(const A& a, const B& b, size_t offset, Out& out, MulAdd mulAdd) {
+    if (a.empty() || b.empty()) return;
+    for (size_t i = 0; i < out.size(); i++) {
+        size_t t = offset + i; // Degree of a * b
+        size_t jFirst = t >= a.size() ? t - (a.size() - 1) : 0;
+        size_t jLast = std::min(t, b.size() - 1);
+        for (size_t j = jFirst; j <= jLast; j++) out[i] = mulAdd(out[i], a[t - j], b[j]);
+    }
+}
+
+/*
+ * ScaledPoly
+ * ----------
+ * A polynomial whose coefficients may be far beyond the range of a double (e.g. the number
+ * of ways to hide 300 bad items among 2000 cells, about 1e500). It is stored as coefficients
+ * c[i] times one common factor exp(logScale), and after every operation the coefficients are
+ * divided by the largest one, so they stay near 1 and can't overflow. Coefficients more than
+ * ~1e-300 times smaller than the largest become 0; at double precision they couldn't change
+ * any probability anyway.
+ * Allocator-aware, so a std::pmr::vector<ScaledPoly> gives its elements its own resource.
+ */
+struct ScaledPoly {
+    using allocator_type = std::pmr::polymorphic_allocator<double>;
+
+    std::pmr::vector<double> c;
+    double logScale = 0.0;
+
+    explicit ScaledPoly(std::pmr::memory_resource* mr = std::pmr::get_default_resource()) : c(mr) {}
+    explicit ScaledPoly(const allocator_type& alloc) : c(alloc) {}
+    ScaledPoly(const ScaledPoly& o, const allocator_type& alloc) : c(o.c, alloc), logScale(o.logScale) {}
+    ScaledPoly(ScaledPoly&& o, const allocator_type& alloc) : c(std::move(o.c), alloc), logScale(o.logScale) {}
+    ScaledPoly(const ScaledPoly&) = default;
+    ScaledPoly(ScaledPoly&&) = default;
+    ScaledPoly& operator=(const ScaledPoly&) = default;
+    ScaledPoly& operator=(ScaledPoly&&) = default;
+
+    size_t size() const { return c.size(); }
+
+    // Moves the largest coefficient's size into logScale
+    void normalize() {
+        double top = 0.0;
+        for (double v : c) top = std::max(top, v);
+        if (top <= 0.0) return;
+        for (double& v : c) v /= top;
+        logScale += std::log(top);
+    }
+
+    // log of coefficient i (-infinity if it is 0)
+    double logAt(size_t i) const {
+        return i < c.size() && c[i] > 0.0 ? std::log(c[i]) + logScale : -std::numeric_limits<double>::infinity();
+    }
+
+    // Builds the polynomial with coefficients exp(logCoef(i)), i = 0..n-1
+    template <class LogCoef>
+    static ScaledPoly fromLogs(size_t n, LogCoef logCoef, std::pmr::memory_resource* mr) {
+        ScaledPoly r(mr);
+        r.c.resize(n);
+        double top = -std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < n; i++) {
+            r.c[i] = logCoef(i);
+            top = std::max(top, r.c[i]);
+        }
+        if (!(top > -std::numeric_limits<double>::infinity())) {
+            std::fill(r.c.begin(), r.c.end(), 0.0); // All zero
+            return r;
+        }
+        for (double& v : r.c) v = std::exp(v - top);
+        r.logScale = top;
+        return r;
+    }
+
+    // a * b, through the FFT when both are long. Only the first `maxSize` coefficients are
+    // kept (and normalized), so coefficients that are never read can't push the ones that
+    // are out of the double range.
+    static ScaledPoly product(const ScaledPoly& a, const ScaledPoly& b, std::pmr::memory_resource* mr,
+                              size_t maxSize = std::numeric_limits<size_t>::max()) {
+        ScaledPoly r(mr);
+        size_t na = std::min(a.c.size(), maxSize), nb = std::min(b.c.size(), maxSize);
+        if (na == 0 || nb == 0) return r;
+        if (std::min(na, nb) >= FFT_CONVOLVE_MIN_SIZE) {
+            fftConvolve(a.c.data(), na, b.c.data(), nb, r.c, mr);
+            if (r.c.size() > maxSize) r.c.resize(maxSize);
+        } else {
+            r.c.assign(std::min(na + nb - 1, maxSize), 0.0);
+            for (size_t i = 0; i < na; i++)
+                for (size_t j = 0; j < nb && i + j < r.c.size(); j++)
+                    r.c[i + j] += a.c[i] * b.c[j];
+        }
+        r.logScale = a.logScale + b.logScale;
+        r.normalize();
+        return r;
+    }
+
+    // Coefficients offset .. offset + count - 1 of a * b (see middleProduct)
+    static ScaledPoly middle(const ScaledPoly& a, const ScaledPoly& b, size_t offset, size_t count,
+                             std::pmr::memory_resource* mr) {
+        ScaledPoly r(mr);
+        r.c.assign(count, 0.0);
+        if (a.c.empty() || b.c.empty()) return r;
+        if (std::min(a.c.size(), b.c.size()) >= FFT_CONVOLVE_MIN_SIZE) {
+            // The full product costs O(N log N) for N = a.size() + b.size(), and a window is
+            // never much shorter than its inputs in the tree: just cut it out
+            std::pmr::vector<double> full(mr);
+            fftConvolve(a.c.data(), a.c.size(), b.c.data(), b.c.size(), full, mr);
+            for (size_t i = 0; i < count && offset + i < full.size(); i++) r.c[i] = full[offset + i];
+        } else {
+            middleProduct(a.c, b.c, offset, r.c, [](double sum, double x, double y) { return sum + x * y; });
+        }
+        r.logScale = a.logScale + b.logScale;
+        r.normalize();
+        return r;
+    }
+};
+
+/*
+ * PolyProductTree
+ * ---------------
+ * Product of n polynomials plus every "all but one" product, in O(n log n) multiplications.
+ * `Poly` is any polynomial type with size() (number of coefficients), and `mul(a, b)` returns
+ * a * b (cut off after the degree the caller reads, if it wants near-linear time).
+ *
+ * Layout: the usual array tree with the leaves at nodes n..2n-1 and node v's children at 2v and
+ * 2v+1, so node 1 is the product of all leaves. This works for any n, not only powers of two,
+ * because multiplication is commutative: every leaf has exactly one path up to node 1.
+ */
+template <class Poly>
+class PolyProductTree {
+public:
+    explicit PolyProductTree(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : nodes(mr), outside(mr), outsideLow(mr) {}
+
+    // Takes the leaves (moved from) and multiplies them up to the root
+    template <class Mul>
+    void build(std::pmr::vector<Poly>& leaves, Mul mul) {
+        n = leaves.size();
+        nodes.clear();
+        outside.clear();
+        outsideLow.clear();
+        if (n == 0) return;
+        nodes.resize(2 * n); // Node 0 is unused
+        for (size_t i = 0; i < n; i++) nodes[n + i] = std::move(leaves[i]);
+        for (size_t v = n - 1; v >= 1; v--) nodes[v] = mul(nodes[2 * v], nodes[2 * v + 1]);
+    }
+
+    size_t size() const { return n; }
+
+    // Leaf i as given to build()
+    const Poly& leaf(size_t i) const { return nodes[n + i]; }
+
+    // Product of all leaves (build() must have had at least one)
+    const Poly& product() const { return nodes[1]; }
+
+    /*
+     * buildLeaveOneOut
+     * ----------------
+     * Computes every leaf's "all others" product, but only at the degrees the caller can read
+     * when it needs degree `maxDegree` of the total: withoutLow(i) .. maxDegree (see item 3 at
+     * the top of this file). `middle(a, b, offset, count)` returns coefficients
+     * offset .. offset + count - 1 of a * b. `one` is the polynomial 1 (what a single leaf gets:
+     * there are no others). The outside products of inner nodes are freed on the way down.
+     */
+    template <class Middle>
+    void buildLeaveOneOut(Middle middle, const Poly& one, size_t maxDegree) {
+        outside.clear();
+        outsideLow.clear();
+        if (n == 0) return;
+        outside.resize(2 * n, one);
+        outsideLow.assign(2 * n, 0); // The root's outside is the whole polynomial 1
+        for (size_t v = 2; v < 2 * n; v++) {
+            size_t degree = nodes[v].size() > 0 ? nodes[v].size() - 1 : 0;
+            size_t low = maxDegree > degree ? maxDegree - degree : 0;
+            size_t parent = v / 2;
+            outsideLow[v] = low;
+            outside[v] = middle(outside[parent], nodes[v ^ 1], low - outsideLow[parent], maxDegree - low + 1);
+            // Both children of `parent` are done: its outside is not needed any more
+            if ((v & 1) && parent >= 2) {
+                Poly gone = std::move(outside[parent]); // Moved out, then freed with `gone`
+            }
+        }
+    }
+
+    // Product of all leaves except leaf i (after buildLeaveOneOut). Coefficient j is the one
+    // of degree withoutLow(i) + j.
+    const Poly& without(size_t i) const { return outside[n + i]; }
+    size_t withoutLow(size_t i) const { return outsideLow[n + i]; }
+
+private:
+    size_t n = 0;
+    std::pmr::vector<Poly> nodes;        // nodes[v]: product of the leaves below v
+    std::pmr::vector<Poly> outside;      // outside[v]: product of the leaves NOT below v (a window)
+    std::pmr::vector<size_t> outsideLow; // Degree of outside[v]'s first coefficient
+};
@@ -0,0 +1,190 @@
+/*
+=================================================================================================
+FILE: src/sampler.h
+
+DESCRIPTION:
+This file contains the posterior sampler: it draws complete hidden boards (where every bomb,
+rupoor and rupee really is) that agree with everything the user has revealed so far.
+Every consistent board is equally likely to be drawn, exactly like in the real game.
+
+IMPORTANCE:
+Simulation-based engines (Monte Carlo tree search, stop/continue advice) need to "play out"
+possible futures. They can only do that on a fully known board, so they pick one at random
+from the boards the clues still allow.
+
+INTERACTION:
+- Includes "solver.h" and reuses one `solve()` (with `recordSolutions` on) for all samples.
+- Used by `src/mcts.h`.
+
+ALGORITHM OVERVIEW:
+1. The solver splits the unknown cells into independent components plus "interior" cells and
+   counts, for each component, how many layouts hold exactly k bad items.
+2. Pick how many bad items each component gets, weighted by (layouts of this component with k)
+   x (ways for everything after it to hold the rest). The interior takes whatever is left.
+3. Pick one of the component's recorded layouts with that many bad items uniformly at random
+   (or walk the search again to the randomly chosen layout if there were too many to record).
+4. Spread the interior's bad items uniformly, split all hidden bad items into bombs/rupoors,
+   and give every safe cell the rupee its bad neighbor count implies.
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include <random>
+
+class PosteriorSampler {
+public:
+    /*
+     * prepare
+     * -------
+     * Solves `grid` once and precomputes everything sample() needs.
+     * Returns false if the board is contradictory (no consistent hidden board exists).
+     */
+    bool prepare(const std::array<CellContent, TOTAL_CELLS>& grid) {
+        solver.reset();
+        solver.recordSolutions = true;
+        solver.grid = grid;
+        solver.solve();
+        ready = solver.totalWays > 0.0;
+        if (!ready) return false;
+
+        bombsLeft = TOTAL_BOMBS;
+        for (CellContent c : grid) {
+            if (c == CellContent::Bomb) bombsLeft--;
+        }
+
+        // suffix[i] = ways for components i..end plus the interior to hold j bad items
+        const auto& comps = solver.componentResults;
+        int numInterior = (int)solver.interiorCells.size();
+        std::vector<double> interiorPoly(numInterior + 1);
+        if (const double* row = binomialRow(numInterior)) {
+            std::copy(row, row + numInterior + 1, interiorPoly.begin());
+        } else {
+            for (int m = 0; m <= numInterior; m++) interiorPoly[m] = binomial(numInterior, m);
+        }
+
+        suffix.assign(comps.size() + 1, {});
+        suffix[comps.size()] = interiorPoly;
+        for (int i = (int)comps.size() - 1; i >= 0; i--) {
+            suffix[i] = comps[i].hasCounts
+                ? ThrillDiggerSolver::convolve(solver.countsOf(comps[i]), suffix[i + 1])
+                : suffix[i + 1];
+        }
+        return true;
+    }
+
+    // The solver used for the last prepare() (its badProb is handy for policies)
+    const ThrillDiggerSolver& solved() const { return solver; }
+
+    /*
+     * sample
+     * ------
+     * Fills `board` with one complete hidden board drawn uniformly from all boards
+     * consistent with the prepared grid. Revealed cells are copied as they are.
+     * Safe to call from several threads at once (it only reads shared state).
+     */
+    bool sample(std::mt19937_64& rng, std::array<CellContent, TOTAL_CELLS>& board) const {
+        if (!ready) return false;
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::array<bool, TOTAL_CELLS> bad{};
+        std::vector<int> hiddenBad;
+
+        const auto& comps = solver.componentResults;
+        int rest = solver.remainingBadCount;
+
+        // Step 1: Choose each component's bad count, then one of its layouts
+        for (size_t ci = 0; ci < comps.size(); ci++) {
+            const ComponentResult& cr = comps[ci];
+            if (!cr.hasCounts) continue;
+            CountSpan counts = solver.countsOf(cr);
+            const std::vector<double>& after = suffix[ci + 1];
+
+            double total = 0.0;
+            for (int k = 0; k <= cr.size && k <= rest; k++) {
+                if (rest - k < (int)after.size()) total += counts[k] * after[rest - k];
+            }
+            double pick = uniform(rng) * total;
+            int chosenK = -1;
+            for (int k = 0; k <= cr.size && k <= rest; k++) {
+                if (rest - k >= (int)after.size()) continue;
+                double w = counts[k] * after[rest - k];
+                if (w <= 0.0) continue;
+                chosenK = k;
+                if (pick < w) break;
+                pick -= w;
+            }
+            if (chosenK < 0) return false;
+
+            uint64_t mask = pickLayout(cr, counts[chosenK], chosenK, rng);
+            for (int li = 0; li < cr.size; li++) {
+                if (mask >> li & 1) { bad[cr.cells[li]] = true; hiddenBad.push_back(cr.cells[li]); }
+            }
+            rest -= chosenK;
+        }
+
+        // Step 2: The interior takes the rest, spread uniformly (partial Fisher-Yates shuffle)
+        std::vector<int> interior = solver.interiorCells;
+        if (rest > (int)interior.size()) return false;
+        for (int m = 0; m < rest; m++) {
+            std::uniform_int_distribution<int> pickIdx(m, (int)interior.size() - 1);
+            std::swap(interior[m], interior[pickIdx(rng)]);
+            bad[interior[m]] = true;
+            hiddenBad.push_back(interior[m]);
+        }
+
+        // Step 3: Decide which hidden bad items are bombs (the rest are rupoors)
+        std::shuffle(hiddenBad.begin(), hiddenBad.end(), rng);
+        board = solver.grid;
+        for (int i = 0; i < (int)hiddenBad.size(); i++) {
+            board[hiddenBad[i]] = (i < bombsLeft) ? CellContent::Bomb : CellContent::Rupoor;
+        }
+
+        // Step 4: Every remaining hidden cell is a rupee matching its bad neighbors
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            if (board[i] != CellContent::Undug) continue;
+            int badNeighbors = 0;
+            for (int n : ThrillDiggerSolver::getNeighbors(i)) {
+                if (bad[n] || isRevealedBad(board[n])) badNeighbors++;
+            }
+            board[i] = rupeeForBadNeighbors(badNeighbors);
+        }
+        return true;
+    }
+
+private:
+    ThrillDiggerSolver solver;
+    std::vector<std::vector<double>> suffix;
+    int bombsLeft = TOTAL_BOMBS;
+    bool ready = false;
+
+    /*
+     * pickLayout
+     * ----------
+     * Uniformly picks one of the component's `layouts` layouts with exactly `k` bad items.
+     * Uses the recorded list when available, otherwise re-runs the backtracker and
+     * stops at a randomly chosen layout (slow, but only for huge components).
+     */
+    static uint64_t pickLayout(const ComponentResult& cr, double layouts, int k, std::mt19937_64& rng) {
+        if (cr.solutionsComplete) {
+            const auto& list = cr.solutions[k];
+            std::uniform_int_distribution<size_t> pickIdx(0, list.size() - 1);
+            return list[pickIdx(rng)];
+        }
+
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        double target = std::floor(uniform(rng) * layouts);
+        double seen = 0.0;
+        uint64_t found = 0;
+        auto onLeaf = [&](int numBad, uint64_t mask) {
+            if (numBad != k) return true;
+            if (seen++ < target) return true;
+            found = mask;
+            return false; // Found it: stop searching
+        };
+        std::pmr::vector<int> assignment(cr.size, 0);
+        ThrillDiggerSolver::enumerateComponent(0, 0, 0, cr.size, k,
+            cr.order, cr.orderPos, assignment, cr.cellConstraints,
+            cr.localConstraints, onLeaf);
+        return found;
+    }
+};
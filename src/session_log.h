@@ -0,0 +1,173 @@
+/*
+=================================================================================================
+FILE: src/session_log.h
+
+DESCRIPTION:
+This file records what a user does with the board (every reset and every cell change, with
+timing) into a small binary log file, and replays such logs through the solver as fast as
+possible to measure how long each update takes.
+
+IMPORTANCE:
+Real sessions are the most honest benchmark: they contain the boards people actually enter,
+in the order they enter them. A replay also gives a result digest, so a solver change that
+alters any probability on any recorded board is noticed immediately.
+
+INTERACTION:
+- `SessionLog` is a `BoardObserver` (solver.h): attach it to a solver and every reset() and
+  setCell() is appended to the log. The GUI does this when the THRILLDIGGER_SESSION_LOG
+  environment variable names a log file.
+- Includes "sketch.h" for the latency histogram, "mapped_file.h" to read logs and
+  "boardgen.h" for its hash function.
+- Driven by the `session` command of `src/cli.cpp` (record / replay).
+
+FILE FORMAT (append-only, little-endian):
+- "TDSLOG01" (8 bytes), written once when the file is created.
+- 8-byte events: time since the previous event in microseconds (uint32, saturating), type,
+  cell, content, reserved. An Open event starts each program run (the board is empty then).
+=================================================================================================
+*/
+
+#pragma once
+#include "solver.h"
+#include "boardgen.h"
+#include "sketch.h"
+#include "mapped_file.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+enum class SessionEventType : uint8_t {
+    Open = 1,     // A program started logging (empty board)
+    Reset = 2,    // reset()
+    SetCell = 3   // setCell(cell, content)
+};
+
+struct SessionEvent {
+    uint32_t deltaUs;  // Microseconds since the previous event of this run (saturates)
+    uint8_t type;      // SessionEventType
+    uint8_t cell;      // Board index (SetCell only)
+    uint8_t content;   // CellContent (SetCell only)
+    uint8_t reserved;
+};
+static_assert(sizeof(SessionEvent) == 8, "session event layout");
+
+// =================================================================================================
+// RECORDING
+// =================================================================================================
+
+class SessionLog : public BoardObserver {
+public:
+    SessionLog() = default;
+    ~SessionLog() { close(); }
+    SessionLog(const SessionLog&) = delete;
+    SessionLog& operator=(const SessionLog&) = delete;
+
+    // Opens (or creates) the log for appending and writes an Open event
+    bool open(const std::string& path) {
+        close();
+        file = std::fopen(path.c_str(), "ab");
+        if (!file) return false;
+        std::fseek(file, 0, SEEK_END);
+        if (std::ftell(file) == 0) std::fwrite("TDSLOG01", 1, 8, file);
+        last = std::chrono::steady_clock::now();
+        write(SessionEventType::Open, 0, CellContent::Undug);
+        return true;
+    }
+
+    void close() {
+        if (file) std::fclose(file);
+        file = nullptr;
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    void onReset() override { write(SessionEventType::Reset, 0, CellContent::Undug); }
+    void onSetCell(int idx, CellContent content) override { write(SessionEventType::SetCell, idx, content); }
+
+private:
+    FILE* file = nullptr;
+    std::chrono::steady_clock::time_point last;
+
+    void write(SessionEventType type, int cell, CellContent content) {
+        if (!file) return;
+        auto now = std::chrono::steady_clock::now();
+        long long us = std::chrono::duration_cast<std::chrono::microseconds>(now - last).count();
+        last = now;
+        SessionEvent e = {};
+        e.deltaUs = static_cast<uint32_t>(std::min<long long>(std::max(0LL, us), UINT32_MAX));
+        e.type = static_cast<uint8_t>(type);
+        e.cell = static_cast<uint8_t>(cell);
+        e.content = static_cast<uint8_t>(content);
+        std::fwrite(&e, sizeof(e), 1, file);
+        std::fflush(file); // A crash must not lose the session that led to it
+    }
+};
+
+// =================================================================================================
+// REPLAY
+// =================================================================================================
+
+// A log file mapped into memory.
+class SessionLogFile {
+public:
+    bool open(const std::string& path) {
+        if (!file.open(path)) return false;
+        if (file.size() < 8 || std::memcmp(file.data(), "TDSLOG01", 8) != 0) {
+            file.close();
+            return false;
+        }
+        return true;
+    }
+
+    // A partly written last event (crash while writing) is ignored
+    size_t size() const { return file.isOpen() ? (file.size() - 8) / sizeof(SessionEvent) : 0; }
+    const SessionEvent* events() const { return reinterpret_cast<const SessionEvent*>(file.data() + 8); }
+
+private:
+    MappedFile file;
+};
+
+struct ReplayResult {
+    long long events = 0;          // Events replayed
+    long long skipped = 0;         // Malformed events (bad type, cell or content)
+    double seconds = 0.0;          // Total replay time
+    double recordedSeconds = 0.0;  // Time the users spent, according to the log
+    HdrHistogram latencyNs;        // Per event: applying it and solving the board
+    uint64_t digest = 0;           // Hash of every solve's results (changes if any result changes)
+};
+
+/*
+ * replayEvents
+ * ------------
+ * Applies the events to `solver` exactly like a front-end would (change, then solve()) and
+ * adds the timings to `result`.
+ */
+inline void replayEvents(const SessionEvent* events, size_t count, ThrillDiggerSolver& solver, ReplayResult& result) {
+    auto runStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) {
+        const SessionEvent& e = events[i];
+        auto type = static_cast<SessionEventType>(e.type);
+        bool isReset = type == SessionEventType::Open || type == SessionEventType::Reset;
+        bool isSet = type == SessionEventType::SetCell && e.cell < TOTAL_CELLS &&
+                     e.content <= static_cast<uint8_t>(CellContent::Bomb);
+        if (!isReset && !isSet) {
+            result.skipped++;
+            continue;
+        }
+        if (type != SessionEventType::Open) result.recordedSeconds += e.deltaUs * 1e-6;
+
+        auto start = std::chrono::steady_clock::now();
+        if (isReset) solver.reset();
+        else solver.setCell(e.cell / COLS, e.cell % COLS, static_cast<CellContent>(e.content));
+        solver.solve();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        result.latencyNs.record(static_cast<uint64_t>(ns.count()));
+        result.events++;
+
+        // Results are rounded so that harmless last-bit differences don't change the digest
+        uint64_t h = mix64(result.digest ^ static_cast<uint64_t>(std::llround(std::log2(solver.totalWays + 1.0) * 1e6)));
+        for (double p : solver.badProb) h = mix64(h ^ static_cast<uint64_t>(std::llround(p * 1e9)));
+        result.digest = h;
+    }
+    result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+}
@@ -0,0 +1,434 @@
+/*
+=================================================================================================
+FILE: src/shard.h
+
+DESCRIPTION:
+This file splits a long simulation (see tournament.h) across several processes on one machine.
+Each process plays a range of games and writes one small fixed-size record per game and
+strategy into its own memory-mapped "shard" file. A merge step then reads all shards and
+computes the same summary as the in-process tournament.
+
+IMPORTANCE:
+Overnight evaluations run for hours. Separate processes keep one crash from taking the whole run
+down, each process has its own address space, and because every finished record is already in
+a file, an interrupted or killed worker simply resumes where it stopped.
+
+INTERACTION:
+- Includes "tournament.h" for boards, strategies and statistics.
+- Includes "mapped_file.h" to map shard files.
+- Driven by the `shard` command of `src/cli.cpp` (run / launch / merge).
+
+HOW IT WORKS:
+1. Shard file = ShardHeader + (games x strategies) ShardRecords of 16 bytes. The file is created
+   at full size up front (all zeros), so record (game, strategy) has a fixed position.
+2. A worker fills in each record and sets its `done` byte last. When a worker restarts on an
+   existing shard with the same parameters, games whose records are all done are skipped.
+   (Writes into a shared mapping live in the OS page cache, so they survive the process dying.)
+3. The coordinator starts up to N worker processes, one shard each. When a worker exits with
+   an error or is killed, its shard goes back in the queue and a new worker resumes it.
+4. Merge maps each shard read-only and streams through the records in game order: memory use
+   does not depend on the number of games.
+=================================================================================================
+*/
+
+#pragma once
+#include "tournament.h"
+#include "mapped_file.h"
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <map>
+
+#ifdef _WIN32
+// <windows.h> already comes with mapped_file.h
+#else
+#include <sys/wait.h>
+#endif
+
+// =================================================================================================
+// FILE FORMAT
+// =================================================================================================
+
+constexpr int SHARD_MAX_STRATEGIES = 16;
+
+// Shard file layout (little-endian, as written by the machine that ran it)
+struct ShardHeader {
+    char magic[8];            // "TDSHARD1"
+    uint32_t recordSize;      // sizeof(ShardRecord), guards against layout changes
+    uint32_t numStrategies;
+    uint64_t seed;            // Board stream (see generateBoard)
+    uint64_t firstGame;       // Games firstGame .. firstGame + numGames - 1
+    uint64_t numGames;
+    char strategies[96];      // Strategy names, comma separated (zero padded)
+};
+
+// One game of one strategy
+struct ShardRecord {
+    uint64_t game;            // Game number (for checking)
+    int32_t rupees;           // Final haul
+    uint8_t digs;             // Cells dug
+    uint8_t flags;            // SHARD_BOMBED | SHARD_CLEARED
+    uint8_t strategy;         // Index into the header's strategy list
+    uint8_t done;             // Written last: 1 = the record is complete
+};
+
+constexpr uint8_t SHARD_BOMBED = 1;
+constexpr uint8_t SHARD_CLEARED = 2;
+
+static_assert(sizeof(ShardHeader) == 136, "shard header layout");
+static_assert(sizeof(ShardRecord) == 16, "shard record layout");
+
+// The header's strategy list (the field is zero padded, not necessarily zero terminated)
+inline std::string shardStrategyList(const ShardHeader& h) {
+    const char* end = std::find(h.strategies, h.strategies + sizeof(h.strategies), '\0');
+    return std::string(h.strategies, end);
+}
+
+// Parameters of one shard.
+struct ShardSpec {
+    uint64_t seed = 1;
+    uint64_t firstGame = 0;
+    uint64_t numGames = 0;
+    std::vector<std::string> strategies;
+
+    std::string strategyList() const {
+        std::string s;
+        for (size_t i = 0; i < strategies.size(); i++) s += (i ? "," : "") + strategies[i];
+        return s;
+    }
+    size_t fileSize() const {
+        return sizeof(ShardHeader) + static_cast<size_t>(numGames) * strategies.size() * sizeof(ShardRecord);
+    }
+};
+
+// =================================================================================================
+// WORKER
+// =================================================================================================
+
+/*
+ * runShard
+ * --------
+ * Plays games spec.firstGame.. of every strategy and records them in the shard at `path`,
+ * resuming a previous run of the same spec. `factories` must match spec.strategies.
+ * Returns false (with a message in `error`) if the file can't be used.
+ */
+inline bool runShard(const std::string& path, const ShardSpec& spec,
+                     const std::vector<StrategyFactory>& factories, std::string& error)
+{
+    int numStrategies = (int)spec.strategies.size();
+    std::string list = spec.strategyList();
+    if (numStrategies == 0 || numStrategies > SHARD_MAX_STRATEGIES || list.size() >= sizeof(ShardHeader::strategies)) {
+        error = "between 1 and 16 strategies, with short names, fit in a shard";
+        return false;
+    }
+
+    // Existing shard: only resume the very same job (checked before anything is resized)
+    MappedFile file;
+    if (file.open(path, true)) {
+        const ShardHeader* old = reinterpret_cast<const ShardHeader*>(file.data());
+        if (file.size() >= sizeof(ShardHeader) && std::memcmp(old->magic, "TDSHARD1", 8) == 0) {
+            if (old->recordSize != sizeof(ShardRecord) || old->seed != spec.seed || old->firstGame != spec.firstGame ||
+                old->numGames != spec.numGames || list != shardStrategyList(*old) || file.size() != spec.fileSize()) {
+                error = path + " belongs to a different job";
+                return false;
+            }
+        } else {
+            file.close(); // Not a shard (e.g. empty): start over
+        }
+    }
+    if (!file.isOpen() && !file.open(path, true, spec.fileSize())) {
+        error = "cannot create " + path;
+        return false;
+    }
+    ShardHeader* h = reinterpret_cast<ShardHeader*>(file.data());
+    ShardRecord* records = reinterpret_cast<ShardRecord*>(file.data() + sizeof(ShardHeader));
+
+    if (std::memcmp(h->magic, "TDSHARD1", 8) != 0) {
+        std::memset(file.data(), 0, file.size());
+        std::memcpy(h->magic, "TDSHARD1", 8);
+        h->recordSize = sizeof(ShardRecord);
+        h->numStrategies = numStrategies;
+        h->seed = spec.seed;
+        h->firstGame = spec.firstGame;
+        h->numGames = spec.numGames;
+        std::memcpy(h->strategies, list.c_str(), list.size());
+    }
+
+    std::vector<std::unique_ptr<Strategy>> players;
+    for (const auto& f : factories) players.push_back(f());
+
+    for (uint64_t i = 0; i < spec.numGames; i++) {
+        ShardRecord* rec = &records[i * numStrategies];
+        uint64_t game = spec.firstGame + i;
+        BitBoard hidden;
+        bool generated = false;
+        for (int s = 0; s < numStrategies; s++) {
+            if (rec[s].done) continue;
+            if (!generated) {
+                hidden = generateBoard(spec.seed, game);
+                generated = true;
+            }
+            // Same per-game seed as the in-process tournament, so the results match
+            GameRecord g = playGame(*players[s], hidden, mix64(spec.seed ^ mix64(game)));
+            rec[s].game = game;
+            rec[s].rupees = g.rupees;
+            rec[s].digs = static_cast<uint8_t>(g.digs);
+            rec[s].flags = (g.bombed ? SHARD_BOMBED : 0) | (g.cleared ? SHARD_CLEARED : 0);
+            rec[s].strategy = static_cast<uint8_t>(s);
+            std::atomic_thread_fence(std::memory_order_release);
+            rec[s].done = 1;
+        }
+    }
+    return true;
+}
+
+// =================================================================================================
+// MERGE
+// =================================================================================================
+
+/*
+ * mergeShards
+ * -----------
+ * Adds up the shards into one report (same statistics as Tournament::run).
+ * Only games whose records are complete for every strategy count; the others are reported in
+ * `unfinished`. All shards must come from the same seed and strategy list, and no game may
+ * appear in two shards (that would count it twice).
+ */
+inline bool mergeShards(const std::vector<std::string>& paths, double confidence,
+                        TournamentReport& report, long long& unfinished, std::string& error)
+{
+    report = TournamentReport();
+    unfinished = 0;
+    std::string list;
+    uint64_t seed = 0;
+    std::map<uint64_t, std::pair<uint64_t, std::string>> ranges; // firstGame -> (end, path)
+    for (const std::string& path : paths) {
+        MappedFile file;
+        if (!file.open(path)) {
+            error = "cannot open " + path;
+            return false;
+        }
+        const ShardHeader* h = reinterpret_cast<const ShardHeader*>(file.data());
+        if (file.size() < sizeof(ShardHeader) || std::memcmp(h->magic, "TDSHARD1", 8) != 0 ||
+            h->recordSize != sizeof(ShardRecord)) {
+            error = path + " is not a shard file";
+            return false;
+        }
+        std::string names = shardStrategyList(*h);
+        size_t nameCount = std::count(names.begin(), names.end(), ',') + 1;
+        if (h->numStrategies == 0 || h->numStrategies > SHARD_MAX_STRATEGIES || h->numStrategies != nameCount) {
+            error = path + " has a damaged header (strategy count does not match the names)";
+            return false;
+        }
+        int numStrategies = (int)h->numStrategies;
+        // Divide instead of multiplying: a damaged numGames must not wrap around
+        uint64_t fits = (file.size() - sizeof(ShardHeader)) / (numStrategies * sizeof(ShardRecord));
+        if (h->numGames > fits) {
+            error = path + " is not a complete shard file";
+            return false;
+        }
+
+        // Game range [firstGame, end): must not overlap any shard seen before
+        if (h->numGames > UINT64_MAX - h->firstGame) {
+            error = path + " has a damaged header (game range overflows)";
+            return false;
+        }
+        uint64_t end = h->firstGame + h->numGames;
+        if (h->numGames > 0) {
+            auto next = ranges.lower_bound(h->firstGame);
+            const std::string* other = nullptr;
+            if (next != ranges.end() && next->first < end) other = &next->second.second;
+            if (next != ranges.begin() && std::prev(next)->second.first > h->firstGame) other = &std::prev(next)->second.second;
+            if (other) {
+                error = path + " repeats games of " + *other;
+                return false;
+            }
+            ranges.emplace(h->firstGame, std::make_pair(end, path));
+        }
+
+        if (report.strategies.empty()) {
+            list = names;
+            seed = h->seed;
+            size_t pos = 0;
+            while (pos <= names.size()) {
+                size_t comma = std::min(names.find(',', pos), names.size());
+                report.strategies.emplace_back();
+                report.strategies.back().name = names.substr(pos, comma - pos);
+                pos = comma + 1;
+            }
+            for (int a = 0; a < numStrategies; a++) {
+                for (int b = a + 1; b < numStrategies; b++) {
+                    report.pairs.emplace_back();
+                    report.pairs.back().a = a;
+                    report.pairs.back().b = b;
+                }
+            }
+        } else if (names != list || h->seed != seed) {
+            error = path + " comes from a different job";
+            return false;
+        }
+
+        const ShardRecord* records = reinterpret_cast<const ShardRecord*>(file.data() + sizeof(ShardHeader));
+        for (uint64_t i = 0; i < h->numGames; i++) {
+            const ShardRecord* g = &records[i * numStrategies];
+            bool complete = true;
+            for (int s = 0; s < numStrategies; s++) {
+                complete = complete && g[s].done;
+                if (g[s].done && (g[s].game != h->firstGame + i || g[s].strategy != s)) {
+                    error = path + " has a damaged record for game " + std::to_string(h->firstGame + i);
+                    return false;
+                }
+            }
+            if (!complete) {
+                unfinished++;
+                continue;
+            }
+            for (int s = 0; s < numStrategies; s++) {
+                StrategyStats& st = report.strategies[s];
+                st.rupees.add(g[s].rupees);
+                st.bombed += (g[s].flags & SHARD_BOMBED) != 0;
+                st.cleared += (g[s].flags & SHARD_CLEARED) != 0;
+                st.digs += g[s].digs;
+            }
+            for (PairStats& p : report.pairs) p.diff.add(g[p.a].rupees - g[p.b].rupees);
+            report.games++;
+        }
+    }
+
+    double z = zForConfidence(confidence);
+    for (PairStats& p : report.pairs) {
+        double se = p.diff.stdErr();
+        p.low = p.diff.mean - z * se;
+        p.high = p.diff.mean + z * se;
+        p.significant = se > 0.0 && (p.low > 0.0 || p.high < 0.0);
+    }
+    return true;
+}
+
+// =================================================================================================
+// COORDINATOR
+// =================================================================================================
+
+/*
+ * ShardCoordinator
+ * ----------------
+ * Runs one worker process per shard, at most `processes` at a time. `commandFor(shard)` gives
+ * the worker's command line (argv[0] first). A worker that fails is restarted (it resumes its
+ * shard) up to `maxAttempts` times.
+ */
+class ShardCoordinator {
+public:
+    int processes = 1;
+    int maxAttempts = 3;
+    std::function<std::vector<std::string>(int shard)> commandFor;
+    std::function<void(int shard, int attempt, bool ok)> onExit; // Optional progress report
+    std::string error; // Set when the coordinator itself fails (not a worker)
+
+    // Returns true if every shard finished successfully
+    bool run(int numShards) {
+        std::deque<int> queue;
+        for (int s = 0; s < numShards; s++) queue.push_back(s);
+        std::vector<int> attempts(numShards, 0);
+        std::map<Process, int> running; // Process -> shard
+        bool allOk = true;
+
+        while (!queue.empty() || !running.empty()) {
+            while (!queue.empty() && (int)running.size() < processes) {
+                int shard = queue.front();
+                queue.pop_front();
+                attempts[shard]++;
+                Process p = launch(commandFor(shard));
+                if (p == NO_PROCESS) {
+                    if (onExit) onExit(shard, attempts[shard], false);
+                    allOk = false;
+                    continue;
+                }
+                running[p] = shard;
+            }
+            if (running.empty()) break;
+
+            bool ok = false;
+            Process done = waitAny(running, ok);
+            if (done == NO_PROCESS) {
+                // Lost track of the workers: relaunching a shard now could give it two writers
+                error = "waiting for workers failed: " + waitError();
+                return false;
+            }
+            int shard = running[done];
+            running.erase(done);
+            if (onExit) onExit(shard, attempts[shard], ok);
+            if (ok) continue;
+            if (attempts[shard] < maxAttempts) queue.push_back(shard); // Resume it in a new process
+            else allOk = false;
+        }
+        return allOk;
+    }
+
+private:
+#ifdef _WIN32
+    using Process = HANDLE;
+    static constexpr HANDLE NO_PROCESS = NULL;
+
+    static Process launch(const std::vector<std::string>& args) {
+        std::string cmd;
+        for (const auto& a : args) cmd += "\"" + a + "\" ";
+        STARTUPINFOA si = {};
+        si.cb = sizeof(si);
+        PROCESS_INFORMATION pi = {};
+        if (!CreateProcessA(NULL, &cmd[0], NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) return NO_PROCESS;
+        CloseHandle(pi.hThread);
+        return pi.hProcess;
+    }
+
+    static Process waitAny(const std::map<Process, int>& running, bool& ok) {
+        std::vector<HANDLE> handles;
+        for (const auto& r : running) handles.push_back(r.first);
+        DWORD i = WaitForMultipleObjects((DWORD)handles.size(), handles.data(), FALSE, INFINITE) - WAIT_OBJECT_0;
+        if (i >= handles.size()) { // WAIT_FAILED
+            ok = false;
+            return NO_PROCESS;
+        }
+        DWORD code = 1;
+        GetExitCodeProcess(handles[i], &code);
+        CloseHandle(handles[i]);
+        ok = code == 0;
+        return handles[i];
+    }
+
+    static std::string waitError() { return "error " + std::to_string(GetLastError()); }
+#else
+    using Process = pid_t;
+    static constexpr pid_t NO_PROCESS = -1;
+
+    static Process launch(const std::vector<std::string>& args) {
+        std::vector<char*> argv;
+        for (const auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+        argv.push_back(nullptr);
+        pid_t pid = fork();
+        if (pid == 0) {
+            execvp(argv[0], argv.data());
+            _exit(127); // exec failed
+        }
+        return pid < 0 ? NO_PROCESS : pid;
+    }
+
+    static std::string waitError() { return std::strerror(errno); }
+
+    static Process waitAny(const std::map<Process, int>& running, bool& ok) {
+        for (;;) {
+            int status = 0;
+            pid_t pid = waitpid(-1, &status, 0);
+            if (pid < 0) {
+                if (errno == EINTR) continue; // A signal arrived; the workers are still running
+                // ECHILD: no children although `running` has some. Not a shard failure.
+                ok = false;
+                return NO_PROCESS;
+            }
+            if (running.count(pid)) {
+                ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+                return pid;
+            }
+        }
+    }
+#endif
+};
@@ -0,0 +1,259 @@
+/*
+=================================================================================================
+FILE: src/sketch.h
+
+DESCRIPTION:
+This file contains small fixed-size summaries ("sketches") of long streams of numbers: how long
+each move took to decide, how risky the chosen cells were, which rupees came up, and how many
+rupees each game earned. Percentiles can be read from a sketch without keeping the raw values.
+
+IMPORTANCE:
+A long simulation makes billions of moves. Keeping every value to sort them later would need
+gigabytes; a sketch needs a few kilobytes no matter how long the run is, and two sketches can
+be added together, so every thread keeps its own and they are merged at the end.
+
+INTERACTION:
+- Includes "planner.h" for the outcome list (Green..Gold, Rupoor, Bomb).
+- Filled in by `playGame()` in `src/tournament.h`, printed by the `tournament` command.
+
+THE SKETCHES:
+1. HdrHistogram (latencies): log-linear buckets. Every power of two is split into 2^(bits-1)
+   equal buckets, so any percentile is exact up to a relative error of 2^-(bits-1)
+   (0.2% with the default 10 bits) over the whole range of 64-bit values.
+2. TDigest (rupees, probabilities): a sorted list of weighted "centroids". Centroids near the
+   median may hold many values, centroids in the tails only a few, so extreme percentiles
+   stay accurate. New values are buffered and merged in sorted passes.
+3. OutcomeCounts: one exact counter per outcome colour.
+=================================================================================================
+*/
+
+#pragma once
+#include "planner.h"
+#include <limits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the highest set bit of v (v > 0)
+inline int highestBit(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return (int)idx;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+// =================================================================================================
+// HDR HISTOGRAM
+// =================================================================================================
+
+class HdrHistogram {
+public:
+    explicit HdrHistogram(int precisionBits = 10)
+        : bits(precisionBits), counts((size_t(1) << bits) + size_t(64 - bits) * (size_t(1) << (bits - 1)), 0) {}
+
+    void record(uint64_t value, uint64_t count = 1) {
+        counts[bucketOf(value)] += count;
+        total += count;
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+        sum += static_cast<double>(value) * count;
+    }
+
+    // Adds another histogram of the same precision
+    void merge(const HdrHistogram& o) {
+        if (o.bits != bits) return;
+        for (size_t i = 0; i < counts.size(); i++) counts[i] += o.counts[i];
+        total += o.total;
+        minValue = std::min(minValue, o.minValue);
+        maxValue = std::max(maxValue, o.maxValue);
+        sum += o.sum;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? minValue : 0; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return total ? sum / total : 0.0; }
+
+    // Smallest value v such that `percentile`% of the recorded values are <= v (within precision)
+    uint64_t valueAtPercentile(double percentile) const {
+        if (total == 0) return 0;
+        uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * total));
+        target = std::max<uint64_t>(1, std::min(target, total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= target) return std::min(bucketHigh(i), maxValue);
+        }
+        return maxValue;
+    }
+
+private:
+    int bits;
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t minValue = std::numeric_limits<uint64_t>::max();
+    uint64_t maxValue = 0;
+    double sum = 0.0;
+
+    // Values below 2^bits have their own bucket. Above, `shift` low bits are dropped, leaving
+    // a mantissa in [2^(bits-1), 2^bits).
+    size_t bucketOf(uint64_t v) const {
+        if (v < (uint64_t(1) << bits)) return static_cast<size_t>(v);
+        int shift = highestBit(v) - bits + 1;
+        uint64_t half = uint64_t(1) << (bits - 1);
+        return static_cast<size_t>((uint64_t(1) << bits) + (shift - 1) * half + ((v >> shift) - half));
+    }
+
+    // Largest value that lands in bucket i
+    uint64_t bucketHigh(size_t i) const {
+        uint64_t full = uint64_t(1) << bits, half = full >> 1;
+        if (i < full) return i;
+        uint64_t shift = (i - full) / half + 1;
+        uint64_t mantissa = (i - full) % half + half;
+        return ((mantissa + 1) << shift) - 1;
+    }
+};
+
+// =================================================================================================
+// T-DIGEST
+// =================================================================================================
+
+class TDigest {
+public:
+    explicit TDigest(double compression = 200.0) : compression(compression) {}
+
+    void add(double x, double weight = 1.0) {
+        buffer.push_back({x, weight});
+        minValue = std::min(minValue, x);
+        maxValue = std::max(maxValue, x);
+        if (buffer.size() >= static_cast<size_t>(8 * compression)) flush();
+    }
+
+    // Adds another digest
+    void merge(const TDigest& o) {
+        buffer.insert(buffer.end(), o.centroids.begin(), o.centroids.end());
+        buffer.insert(buffer.end(), o.buffer.begin(), o.buffer.end());
+        minValue = std::min(minValue, o.minValue);
+        maxValue = std::max(maxValue, o.maxValue);
+        flush();
+    }
+
+    double count() const {
+        double w = 0.0;
+        for (const Centroid& c : centroids) w += c.weight;
+        for (const Centroid& c : buffer) w += c.weight;
+        return w;
+    }
+
+    // Estimated q-quantile (0 <= q <= 1), interpolating between centroid centers
+    double quantile(double q) const {
+        flush();
+        if (centroids.empty()) return 0.0;
+        if (centroids.size() == 1) return centroids[0].mean;
+        double total = 0.0;
+        for (const Centroid& c : centroids) total += c.weight;
+        double index = std::min(std::max(q, 0.0), 1.0) * total;
+
+        // Before the first center: between the minimum and it
+        const Centroid& first = centroids.front();
+        if (index < first.weight / 2.0) {
+            return minValue + (first.mean - minValue) * (index / (first.weight / 2.0));
+        }
+        double seen = first.weight / 2.0; // Weight up to the current center
+        for (size_t i = 0; i + 1 < centroids.size(); i++) {
+            double gap = (centroids[i].weight + centroids[i + 1].weight) / 2.0;
+            if (index < seen + gap) {
+                double t = (index - seen) / gap;
+                return centroids[i].mean + t * (centroids[i + 1].mean - centroids[i].mean);
+            }
+            seen += gap;
+        }
+        // After the last center: between it and the maximum
+        const Centroid& last = centroids.back();
+        double t = std::min(1.0, (index - seen) / (last.weight / 2.0));
+        return last.mean + t * (maxValue - last.mean);
+    }
+
+private:
+    struct Centroid {
+        double mean, weight;
+    };
+
+    double compression;
+    // Mutable: reading a quantile merges the buffer first, which doesn't change the contents
+    mutable std::vector<Centroid> centroids; // Sorted by mean
+    mutable std::vector<Centroid> buffer;    // Values not merged in yet
+    double minValue = std::numeric_limits<double>::infinity();
+    double maxValue = -std::numeric_limits<double>::infinity();
+
+    // Sorts everything and merges neighbors while the merged centroid stays under its size
+    // limit, 4 * total * q * (1 - q) / compression: small in the tails, large near the median.
+    void flush() const {
+        if (buffer.empty()) return;
+        buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+        std::sort(buffer.begin(), buffer.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+        double total = 0.0;
+        for (const Centroid& c : buffer) total += c.weight;
+
+        centroids.clear();
+        Centroid cur = buffer[0];
+        double before = 0.0; // Weight of the finished centroids
+        for (size_t i = 1; i < buffer.size(); i++) {
+            const Centroid& x = buffer[i];
+            double w = cur.weight + x.weight;
+            double q0 = before / total, q2 = (before + w) / total;
+            double limit = 4.0 * total * std::min(q0 * (1.0 - q0), q2 * (1.0 - q2)) / compression;
+            if (w <= std::max(limit, 1.0)) {
+                cur.mean += (x.mean - cur.mean) * x.weight / w;
+                cur.weight = w;
+            } else {
+                centroids.push_back(cur);
+                before += cur.weight;
+                cur = x;
+            }
+        }
+        centroids.push_back(cur);
+        buffer.clear();
+    }
+};
+
+// =================================================================================================
+// PER-MOVE STATISTICS
+// =================================================================================================
+
+// Exact count of each dig outcome (Green..Gold, Rupoor, Bomb)
+struct OutcomeCounts {
+    std::array<uint64_t, NUM_OUTCOMES> n{};
+
+    void record(CellContent c) {
+        int o = static_cast<int>(c) - 1;
+        if (o >= 0 && o < NUM_OUTCOMES) n[o]++;
+    }
+    void merge(const OutcomeCounts& o) {
+        for (int i = 0; i < NUM_OUTCOMES; i++) n[i] += o.n[i];
+    }
+    uint64_t total() const {
+        uint64_t t = 0;
+        for (uint64_t c : n) t += c;
+        return t;
+    }
+};
+
+// Everything recorded about one strategy's moves and games.
+struct MoveStats {
+    HdrHistogram decideNs;   // Time to choose each move, in nanoseconds
+    TDigest chosenBadProb;   // badProb of each chosen cell (strategies that report it)
+    OutcomeCounts outcomes;  // What each dig revealed
+    TDigest gameRupees;      // Final haul of each game
+
+    void merge(const MoveStats& o) {
+        decideNs.merge(o.decideNs);
+        chosenBadProb.merge(o.chosenBadProb);
+        outcomes.merge(o.outcomes);
+        gameRupees.merge(o.gameRupees);
+    }
+};
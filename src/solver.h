@@ -12,9 +12,11 @@ This is the core "brain" of the software. Without this file, the UI would have n
 It transforms the state of the board (what the user has seen) into actionable probabilities.
 
 INTERACTION:
-- Included by `src/main.cpp`.
+- Included by `src/main.cpp` and by the engines built on top of it (e.g. `src/planner.h`).
 - The `ThrillDiggerSolver` class is instantiated as a global object in main.cpp.
 - The `solve()` method is called every time the user updates a cell.
+- Optional hooks for tools: `memory` (where solve() allocates), `stageObserver`,
+  `searchProfile` and `observer` (see alloc_stats.h, perf_counters.h, stress.h, session_log.h).
 
 ALGORITHM OVERVIEW:
 This is a constraint satisfaction problem solver.
@@ -34,10 +36,18 @@ This is a constraint satisfaction problem solver.
 #include <algorithm>
 #include <numeric>
 #include <functional>
+#include <limits>
 #include <unordered_map>
 #include <unordered_set>
 #include <cassert>
 #include <cmath>
+#include <memory_resource>
+#include <string>
+#include "poly_product.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 // =================================================================================================
 // CONFIGURATION
@@ -47,7 +57,9 @@ This is a constraint satisfaction problem solver.
 constexpr int ROWS = 5;
 constexpr int COLS = 8;
 constexpr int TOTAL_CELLS = ROWS * COLS; // Total 40 cells
-constexpr int TOTAL_BAD = 16;            // Expert mode has 8 bombs + 8 rupoors = 16 bad items
+constexpr int TOTAL_BOMBS = 8;           // Expert mode hides 8 bombs...
+constexpr int TOTAL_RUPOORS = 8;         // ...and 8 rupoors
+constexpr int TOTAL_BAD = TOTAL_BOMBS + TOTAL_RUPOORS; // = 16 bad items
 
 // =================================================================================================
 // DATA STRUCTURES
@@ -84,6 +96,20 @@ inline std::pair<int,int> badNeighborRange(CellContent c) {
     }
 }
 
+/*
+ * rupeeForBadNeighbors
+ * --------------------
+ * The reverse of badNeighborRange: which rupee a safe cell shows when it has
+ * `badNeighbors` bad items around it (used when building complete hidden boards).
+ */
+inline CellContent rupeeForBadNeighbors(int badNeighbors) {
+    if (badNeighbors <= 0) return CellContent::Green;
+    if (badNeighbors <= 2) return CellContent::Blue;
+    if (badNeighbors <= 4) return CellContent::Red;
+    if (badNeighbors <= 6) return CellContent::Silver;
+    return CellContent::Gold;
+}
+
 // Checks if the content is a Rupee (Green through Gold)
 inline bool isRevealedGood(CellContent c) {
     return c >= CellContent::Green && c <= CellContent::Gold;
@@ -99,6 +125,138 @@ inline bool isRevealed(CellContent c) {
     return c != CellContent::Undug;
 }
 
+/*
+ * Board Text
+ * ----------
+ * One character per cell, used by the command line tool and log files:
+ * '.' Undug, 'G' Green, 'B' Blue, 'R' Red, 'S' Silver, 'Y' Gold (yellow), 'P' Rupoor (purple), 'X' Bomb.
+ */
+inline char cellContentChar(CellContent c) {
+    static const char chars[] = ".GBRSYPX";
+    return chars[static_cast<int>(c) & 7];
+}
+
+// Returns false for characters that are not a cell (lowercase letters are accepted too)
+inline bool cellContentFromChar(char ch, CellContent& out) {
+    switch (ch) {
+        case '.': case '?': out = CellContent::Undug;  return true;
+        case 'G': case 'g': out = CellContent::Green;  return true;
+        case 'B': case 'b': out = CellContent::Blue;   return true;
+        case 'R': case 'r': out = CellContent::Red;    return true;
+        case 'S': case 's': out = CellContent::Silver; return true;
+        case 'Y': case 'y': out = CellContent::Gold;   return true;
+        case 'P': case 'p': out = CellContent::Rupoor; return true;
+        case 'X': case 'x': out = CellContent::Bomb;   return true;
+        default: return false;
+    }
+}
+
+/*
+ * boardFromText
+ * -------------
+ * Reads a board written as 40 cell characters (row by row). Spaces and '/' row separators
+ * are skipped. Returns false if the text has a bad character or the wrong number of cells.
+ */
+inline bool boardFromText(const std::string& text, std::array<CellContent, TOTAL_CELLS>& grid) {
+    int n = 0;
+    for (char ch : text) {
+        if (ch == ' ' || ch == '/' || ch == '\t' || ch == '\r' || ch == '\n') continue;
+        CellContent c;
+        if (n >= TOTAL_CELLS || !cellContentFromChar(ch, c)) return false;
+        grid[n++] = c;
+    }
+    return n == TOTAL_CELLS;
+}
+
+inline std::string boardToText(const std::array<CellContent, TOTAL_CELLS>& grid) {
+    std::string text(TOTAL_CELLS, '.');
+    for (int i = 0; i < TOTAL_CELLS; i++) text[i] = cellContentChar(grid[i]);
+    return text;
+}
+
+/*
+ * PackedBoard
+ * -----------
+ * The whole board squeezed into 128 bits (3 bits per cell, 40 cells = 120 bits).
+ * Cells 0..20 live in `lo`, cells 21..39 live in `hi`.
+ * Cheap to copy, compare and hash, so it is used as a key for caches (e.g. the planner).
+ */
+struct PackedBoard {
+    uint64_t lo = 0, hi = 0;
+    bool operator==(const PackedBoard& o) const { return lo == o.lo && hi == o.hi; }
+    bool operator!=(const PackedBoard& o) const { return !(*this == o); }
+    bool operator<(const PackedBoard& o) const { return hi != o.hi ? hi < o.hi : lo < o.lo; }
+};
+
+// Hash functor so PackedBoard can be used in std::unordered_map
+struct PackedBoardHash {
+    size_t operator()(const PackedBoard& b) const {
+        // Mix both halves (constant from splitmix64) so similar boards spread out
+        uint64_t h = b.lo * 0x9E3779B97F4A7C15ull ^ (b.hi + 0x632BE59BD9B4E019ull + (b.lo >> 17));
+        return static_cast<size_t>(h ^ (h >> 31));
+    }
+};
+
+constexpr int PACK_BITS = 3;   // Bits per cell (8 CellContent values)
+constexpr int PACK_LO_CELLS = 21; // 21 * 3 = 63 bits fit in the low word
+
+inline PackedBoard packBoard(const std::array<CellContent, TOTAL_CELLS>& grid) {
+    PackedBoard b;
+    for (int i = 0; i < TOTAL_CELLS; i++) {
+        uint64_t v = static_cast<uint64_t>(grid[i]);
+        if (i < PACK_LO_CELLS) b.lo |= v << (i * PACK_BITS);
+        else                   b.hi |= v << ((i - PACK_LO_CELLS) * PACK_BITS);
+    }
+    return b;
+}
+
+inline std::array<CellContent, TOTAL_CELLS> unpackBoard(const PackedBoard& b) {
+    std::array<CellContent, TOTAL_CELLS> grid;
+    for (int i = 0; i < TOTAL_CELLS; i++) {
+        uint64_t v = (i < PACK_LO_CELLS) ? (b.lo >> (i * PACK_BITS))
+                                         : (b.hi >> ((i - PACK_LO_CELLS) * PACK_BITS));
+        grid[i] = static_cast<CellContent>(v & 7);
+    }
+    return grid;
+}
+
+/*
+ * Board Symmetries
+ * ----------------
+ * A 5x8 rectangle has 4 symmetries: identity, left-right mirror, top-bottom mirror
+ * and 180 degree rotation. Boards that are mirror images have mirrored probabilities,
+ * so caches only need to store one "canonical" version of each.
+ * Every symmetry is its own inverse, which makes mapping results back trivial.
+ */
+constexpr int NUM_SYMMETRIES = 4;
+
+inline int symmetryCell(int idx, int sym) {
+    int r = idx / COLS, c = idx % COLS;
+    if (sym & 1) c = COLS - 1 - c; // Mirror left-right
+    if (sym & 2) r = ROWS - 1 - r; // Mirror top-bottom
+    return r * COLS + c;
+}
+
+/*
+ * canonicalBoard
+ * --------------
+ * Returns the smallest packed form among the 4 symmetric versions of `grid`.
+ * `symOut` receives the symmetry that produced it: cell `i` of the original board
+ * is cell `symmetryCell(i, symOut)` of the canonical board (and vice versa).
+ */
+inline PackedBoard canonicalBoard(const std::array<CellContent, TOTAL_CELLS>& grid, int* symOut = nullptr) {
+    PackedBoard best = packBoard(grid);
+    int bestSym = 0;
+    std::array<CellContent, TOTAL_CELLS> t;
+    for (int sym = 1; sym < NUM_SYMMETRIES; sym++) {
+        for (int i = 0; i < TOTAL_CELLS; i++) t[symmetryCell(i, sym)] = grid[i];
+        PackedBoard p = packBoard(t);
+        if (p < best) { best = p; bestSym = sym; }
+    }
+    if (symOut) *symOut = bestSym;
+    return best;
+}
+
 /*
  * UnionFind
  * ---------
@@ -107,8 +265,9 @@ inline bool isRevealed(CellContent c) {
  * If Cell A is near Clue 1, and Cell B is near Clue 1, A and B are connected.
  */
 struct UnionFind {
-    std::vector<int> parent;
-    UnionFind(int n) : parent(n) { std::iota(parent.begin(), parent.end(), 0); }
+    std::pmr::vector<int> parent;
+    UnionFind(int n, std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : parent(n, mr) { std::iota(parent.begin(), parent.end(), 0); }
     
     // Find representative of the set
     int find(int x) { return parent[x] == x ? x : parent[x] = find(parent[x]); }
@@ -117,6 +276,38 @@ struct UnionFind {
     void unite(int a, int b) { a = find(a); b = find(b); if (a != b) parent[a] = b; }
 };
 
+/*
+ * InlineVector
+ * ------------
+ * A vector with a fixed capacity N that keeps its items inside the object (no heap).
+ * Used for the short lists of the solver: a cell has at most 8 neighbors, so a clue
+ * touches at most 8 cells.
+ */
+template <class T, int N>
+class InlineVector {
+public:
+    void push_back(const T& v) {
+        assert(count < N);
+        items[count++] = v;
+    }
+    void clear() { count = 0; }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    T& operator[](int i) { return items[i]; }
+    const T& operator[](int i) const { return items[i]; }
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+
+private:
+    T items[N];
+    int count = 0;
+};
+
+using NeighborList = InlineVector<int, 8>;
+
 /*
  * Constraint Structures
  * ---------------------
@@ -125,29 +316,253 @@ struct UnionFind {
 
 // A constraint derived from a revealed rupee on the board.
 struct Constraint {
-    std::vector<int> frontierLocalIdx; // Indices of the unknown neighbors involved
-    int minBad, maxBad;                // The rule (e.g., must have 1 to 2 bad items)
+    NeighborList frontierLocalIdx; // Indices of the unknown neighbors involved
+    int minBad, maxBad;            // The rule (e.g., must have 1 to 2 bad items)
 };
 
 // Same as Constraint, but remapped to be specific to a connected component.
 struct LocalConstraint {
-    std::vector<int> localIdx;
+    NeighborList localIdx;
     int minBad, maxBad;
 };
 
+/*
+ * CellConstraintIndex
+ * -------------------
+ * For each cell of a component, the constraints that touch it, stored "CSR" style (compressed
+ * sparse rows): all lists back to back in `list`, cell i's list being list[start[i] .. start[i+1]).
+ * Two arrays instead of one heap vector per cell. The vectors take their memory from a
+ * std::pmr::memory_resource (the solver's `memory`), like the rest of a solve's working data.
+ */
+struct CellConstraintIndex {
+    std::pmr::vector<int> start;
+    std::pmr::vector<int> list;
+
+    explicit CellConstraintIndex(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : start(mr), list(mr) {}
+
+    void build(int cells, const std::pmr::vector<LocalConstraint>& constraints) {
+        start.assign(cells + 1, 0);
+        for (const LocalConstraint& lc : constraints) {
+            for (int li : lc.localIdx) start[li + 1]++;
+        }
+        for (int i = 0; i < cells; i++) start[i + 1] += start[i];
+        list.resize(start[cells]);
+        std::pmr::vector<int> fill(start.begin(), start.end() - 1, start.get_allocator());
+        for (int ci = 0; ci < (int)constraints.size(); ci++) {
+            for (int li : constraints[ci].localIdx) list[fill[li]++] = ci;
+        }
+    }
+
+    int count(int cell) const { return start[cell + 1] - start[cell]; }
+    const int* begin(int cell) const { return list.data() + start[cell]; }
+    const int* end(int cell) const { return list.data() + start[cell + 1]; }
+};
+
+/*
+ * CountBuffer
+ * -----------
+ * An array of doubles that starts on a 64-byte boundary (one cache line), taken from a memory
+ * resource. The solver keeps the count tables of every component of a solve in one of these
+ * (see ComponentResult). It only grows, so a warmed-up solver reuses the same block.
+ */
+class CountBuffer {
+public:
+    static constexpr size_t ALIGN = 64;
+
+    CountBuffer() = default;
+    CountBuffer(const CountBuffer& o) { copyFrom(o); }
+    CountBuffer& operator=(const CountBuffer& o) {
+        if (this != &o) copyFrom(o);
+        return *this;
+    }
+    ~CountBuffer() { release(); }
+
+    // Makes the buffer n doubles long, all zero (the old contents are dropped)
+    void resetZeros(size_t n, std::pmr::memory_resource* mr) {
+        if (n > cap || mr != resource) {
+            release();
+            resource = mr;
+            cap = std::max<size_t>(n, 64);
+            p = static_cast<double*>(resource->allocate(cap * sizeof(double), ALIGN));
+        }
+        std::fill(p, p + n, 0.0);
+        len = n;
+    }
+
+    double* data() { return p; }
+    const double* data() const { return p; }
+    size_t size() const { return len; }
+
+private:
+    double* p = nullptr;
+    size_t len = 0, cap = 0;
+    std::pmr::memory_resource* resource = nullptr;
+
+    void release() {
+        if (p) resource->deallocate(p, cap * sizeof(double), ALIGN);
+        p = nullptr;
+        len = cap = 0;
+    }
+    // Copies (e.g. of a whole solver) take their memory from the default resource
+    void copyFrom(const CountBuffer& o) {
+        resetZeros(o.len, std::pmr::get_default_resource());
+        if (o.len) std::copy(o.p, o.p + o.len, p);
+    }
+};
+
+// Index of the lowest set bit of v (v > 0)
+inline int lowestBit(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, v);
+    return (int)idx;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+/*
+ * LeafHistogram
+ * -------------
+ * Counts which cells are bad over many layouts without touching each bad cell's counter for
+ * every layout. A layout's bad cells come as a bitmask; the mask is cut into bytes and the
+ * histogram counts how often each byte value shows up at each byte position, per bad count k.
+ * That is one addition per byte (at most 5 for 40 cells) instead of one per bad cell.
+ * flush() turns the histogram into per-cell counts once, after the search.
+ */
+class LeafHistogram {
+public:
+    // Prepares for a component of `cells` cells whose layouts have 0..maxBad bad items
+    void reset(int cells, int maxBad, std::pmr::memory_resource* mr) {
+        chunks = (cells + 7) / 8;
+        kCount = maxBad + 1;
+        hist.resetZeros(static_cast<size_t>(kCount) * chunks * 256, mr);
+    }
+
+    void add(int k, uint64_t mask) {
+        double* h = hist.data() + static_cast<size_t>(k) * chunks * 256;
+        for (int c = 0; c < chunks; c++, h += 256) h[(mask >> (8 * c)) & 255] += 1.0;
+    }
+
+    // Adds the counted layouts to per-cell rows: bad[cell * stride + k]
+    void flush(double* bad, size_t stride) const {
+        const double* h = hist.data();
+        for (int k = 0; k < kCount; k++) {
+            for (int c = 0; c < chunks; c++, h += 256) {
+                for (int v = 1; v < 256; v++) {
+                    if (h[v] == 0.0) continue;
+                    for (unsigned m = v; m; m &= m - 1) bad[(c * 8 + lowestBit(m)) * stride + k] += h[v];
+                }
+            }
+        }
+    }
+
+private:
+    CountBuffer hist; // hist[(k * chunks + chunk) * 256 + byte value]
+    int chunks = 0, kCount = 0;
+};
+
+/*
+ * CountSpan
+ * ---------
+ * Read-only view of a run of doubles, e.g. one component's `counts` table. Has the size(),
+ * empty() and [] of a vector, so it can be passed to convolve().
+ */
+struct CountSpan {
+    const double* ptr = nullptr;
+    size_t n = 0;
+
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    double operator[](size_t i) const { return ptr[i]; }
+    const double* begin() const { return ptr; }
+    const double* end() const { return ptr + n; }
+};
+
 // The result of analyzing one connected component.
+// Its count tables live in the solver's `countTable` (read them with countsOf / badCountsOf):
+// from `tableOffset` on, counts[k] (k = 0..size) = number of ways to place exactly k bad items
+// in this component, then one row per cell, badCounts[i][k] = how many of those ways have
+// cell i bad. Rows are cell-major because the final probability loop reads one cell at a time.
 struct ComponentResult {
-    int size;                                      // Number of unknown cells in this component
-    std::vector<double> counts;                    // counts[k] = number of ways to place exactly k bad items in this component
-    std::vector<std::vector<double>> badCounts;    // badCounts[i][k] = how many times cell i is bad when total bad is k
-    std::vector<int> globalIndices;                // Maps local index back to the global board index
+    int size;                                            // Number of unknown cells in this component
+    bool hasCounts = false;                              // False if the component was too big to enumerate
+    size_t tableOffset = 0;                              // Start of the count tables in the solver's countTable
+    std::pmr::vector<int> globalIndices;                 // Maps local index back to the frontier index
+    std::pmr::vector<int> cells;                         // Maps local index back to the board index (0..39)
+
+    // The search setup, kept so the component can be walked again later (e.g. by the sampler)
+    std::pmr::vector<LocalConstraint> localConstraints;
+    CellConstraintIndex cellConstraints;                 // Constraints touching each local cell
+    std::pmr::vector<int> order, orderPos;               // Cell visiting order of the backtracker
+
+    // Optional: every valid layout as a bitmask (bit i = local cell i is bad), grouped by
+    // bad count: solutions[k] holds the layouts with exactly k bad items.
+    // Only filled when the solver's `recordSolutions` is on; `solutionsComplete` is false
+    // if there were too many layouts to keep.
+    std::pmr::vector<std::pmr::vector<uint64_t>> solutions;
+    bool solutionsComplete = false;
+
+    explicit ComponentResult(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : globalIndices(mr), cells(mr), localConstraints(mr),
+          cellConstraints(mr), order(mr), orderPos(mr), solutions(mr) {}
+};
+
+/*
+ * Binomial Tables
+ * ---------------
+ * "n choose k" is needed all the time (interior cells, trivial boards), so it comes from
+ * Pascal's triangle built at compile time: exact 64-bit integers up to n = 64 (they would
+ * overflow from n = 68 on), and the same values as doubles for the probability code.
+ * Far bigger boards can't use exact values at all (C(400, 200) is about 1e119), so there
+ * is also log(n choose k) for any n.
+ */
+constexpr int BINOMIAL_TABLE_N = 64;
+
+struct PascalTable {
+    uint64_t exact[BINOMIAL_TABLE_N + 1][BINOMIAL_TABLE_N + 1];
+    double value[BINOMIAL_TABLE_N + 1][BINOMIAL_TABLE_N + 1];
+
+    constexpr PascalTable() : exact(), value() {
+        for (int n = 0; n <= BINOMIAL_TABLE_N; n++) {
+            exact[n][0] = 1;
+            for (int k = 1; k <= n; k++) exact[n][k] = exact[n - 1][k - 1] + (k < n ? exact[n - 1][k] : 0);
+            for (int k = 0; k <= n; k++) value[n][k] = static_cast<double>(exact[n][k]);
+        }
+    }
 };
+inline constexpr PascalTable PASCAL{};
+static_assert(PASCAL.exact[40][20] == 137846528820ULL, "Pascal table");
+
+// Row n of the double table (C(n, 0..n)), or nullptr if n is beyond the table
+inline const double* binomialRow(int n) {
+    return (n >= 0 && n <= BINOMIAL_TABLE_N) ? PASCAL.value[n] : nullptr;
+}
+
+// log(k!), from a table for the first few thousand values
+inline double logFactorial(int n) {
+    constexpr int TABLE_N = 4096;
+    static const std::array<double, TABLE_N> table = [] {
+        std::array<double, TABLE_N> t{};
+        for (int i = 1; i < TABLE_N; i++) t[i] = t[i - 1] + std::log(static_cast<double>(i));
+        return t;
+    }();
+    return n < TABLE_N ? table[n] : std::lgamma(n + 1.0);
+}
+
+// log(n choose k); -infinity when k is out of range (zero ways)
+inline double logBinomial(int n, int k) {
+    if (k < 0 || k > n) return -std::numeric_limits<double>::infinity();
+    return logFactorial(n) - logFactorial(k) - logFactorial(n - k);
+}
 
 // Helper: Calculate combinations "n choose k"
 static double binomial(int n, int k) {
     if (k < 0 || k > n) return 0.0;
+    if (n <= BINOMIAL_TABLE_N) return PASCAL.value[n][k];
     if (k == 0 || k == n) return 1.0;
-    double result = 1.0;
+    double result = 1.0; // Beyond the table: multiplicative formula in doubles
     if (k > n - k) k = n - k;
     for (int i = 0; i < k; i++) {
         result *= (n - i);
@@ -156,6 +571,74 @@ static double binomial(int n, int k) {
     return result;
 }
 
+/*
+ * SolveStage / SolveStageObserver
+ * -------------------------------
+ * solve() works in stages. An observer attached to the solver's `stageObserver` member is told
+ * when each stage starts (and when the solve is over, with SolveStage::Done), e.g. to read
+ * hardware performance counters per stage (see perf_counters.h).
+ */
+enum class SolveStage : int {
+    Classify = 0,  // Steps 1-2: sort cells into clues / known bad / frontier / interior
+    Constraints,   // Steps 3-4: build the clue constraints and split them into components
+    Enumerate,     // Step 5: backtracking over every component (enumerateComponent)
+    Combine,       // Steps 6-8: convolutions and final probabilities
+    Done
+};
+constexpr int NUM_SOLVE_STAGES = 4; // Not counting Done
+
+inline const char* solveStageName(int stage) {
+    static const char* const names[NUM_SOLVE_STAGES] = {"classify", "constraints", "enumerate", "combine"};
+    return names[stage];
+}
+
+class SolveStageObserver {
+public:
+    virtual ~SolveStageObserver() = default;
+    virtual void onStage(SolveStage stage) = 0;
+};
+
+/*
+ * BoardObserver
+ * -------------
+ * Gets told about every change made through ThrillDiggerSolver::reset() and setCell(), e.g. to
+ * record a session (see session_log.h). Attach one with the solver's `observer` member.
+ */
+class BoardObserver {
+public:
+    virtual ~BoardObserver() = default;
+    virtual void onReset() = 0;
+    virtual void onSetCell(int idx, CellContent content) = 0;
+};
+
+/*
+ * SearchProfile
+ * -------------
+ * Optional instrumentation of the backtracking search (enumerateComponent): what happened at
+ * each depth of each component's search tree. The cells are assigned in a fixed order, so
+ * "depth d" also names a cell (the d-th one of `cells`). Attach one with the solver's
+ * `searchProfile` member; stress.h turns it into tables and flamegraph input.
+ */
+struct SearchDepthStats {
+    long long nodes = 0;     // Nodes entered with d cells assigned
+    long long budget = 0;    // ...of which cut off: more bad items than are left on the board
+    long long leaves = 0;    // ...of which complete, valid layouts
+    long long overMax = 0;   // Assignments of cell d-1 rejected: a clue got too many bad items
+    long long underMin = 0;  // Assignments of cell d-1 rejected: a clue can no longer get enough
+};
+
+struct SearchProfile {
+    struct Component {
+        std::string position;           // Caller's label of the board being solved
+        std::vector<int> cells;         // Board index of the cell assigned at each depth
+        std::vector<SearchDepthStats> depth; // Indexed by the number of cells assigned (0..size)
+    };
+    std::string position;               // Set by the caller before solve()
+    std::vector<Component> components;  // Every component searched so far
+
+    SearchDepthStats& at(int d) { return components.back().depth[d]; }
+};
+
 // =================================================================================================
 // MAIN SOLVER CLASS
 // =================================================================================================
@@ -167,6 +650,56 @@ public:
     // The calculated output: probability (0.0 to 1.0) of each cell being Bad
     std::array<double, TOTAL_CELLS> badProb;
 
+    // Number of hidden layouts (ways to place the remaining bad items) that agree with
+    // every clue. 0 means the board is contradictory. Ratios of this value between a board
+    // and a "what if" copy of it give exact outcome probabilities (used by the planner).
+    double totalWays = 0.0;
+
+    // log(totalWays), also valid when totalWays is too big for a double (+infinity) on
+    // large boards; -infinity for a contradictory board.
+    double logTotalWays = 0.0;
+
+    // Working state of the last solve(), kept for engines that need more than badProb
+    // (e.g. the posterior sampler): the frontier components, the unconstrained "interior"
+    // cells and how many bad items are still hidden.
+    std::vector<ComponentResult> componentResults;
+    CountBuffer countTable; // Count tables of all components (see ComponentResult), 64-byte aligned blocks
+    LeafHistogram leafHistogram; // Scratch for big components' per-cell counts (see solve())
+    std::vector<int> interiorCells;
+    int remainingBadCount = TOTAL_BAD;
+
+    // When on, solve() also stores every valid component layout (see ComponentResult::solutions),
+    // up to `maxRecordedSolutions` layouts per solve.
+    bool recordSolutions = false;
+    size_t maxRecordedSolutions = size_t(1) << 21;
+
+    // Backtracking nodes visited by the last solve() (a machine-independent measure of its cost)
+    long long searchNodes = 0;
+
+    // Boards with more unknown cells than this are combined in scaled arithmetic (see
+    // combineScaled); `forceScaledCombine` uses it on every board (to check it against the
+    // plain path).
+    static constexpr int SCALED_COMBINE_MIN_CELLS = 900;
+    bool forceScaledCombine = false;
+
+    // Components with more cells than this count bad cells through a LeafHistogram
+    static constexpr int LEAF_HISTOGRAM_MIN_CELLS = 16;
+
+    // Where solve() takes its working memory from (not owned by the solver). The default is
+    // plain new/delete; plug in a counting resource (alloc_stats.h) to measure allocations,
+    // or a pool to avoid them. Set it before the first solve(): results of earlier solves
+    // keep the resource they were made with.
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource();
+
+    // Optional: detailed search statistics, added to by every solve() (not owned by the solver)
+    SearchProfile* searchProfile = nullptr;
+
+    // Optional: notified of every reset() / setCell() (not owned by the solver)
+    BoardObserver* observer = nullptr;
+
+    // Optional: notified when each stage of solve() starts (not owned by the solver)
+    SolveStageObserver* stageObserver = nullptr;
+
     ThrillDiggerSolver() { reset(); }
 
     /*
@@ -178,11 +711,30 @@ public:
         grid.fill(CellContent::Undug);
         double prior = static_cast<double>(TOTAL_BAD) / TOTAL_CELLS; // e.g., 16/40 = 0.4
         badProb.fill(prior);
+        totalWays = binomial(TOTAL_CELLS, TOTAL_BAD);
+        logTotalWays = logBinomial(TOTAL_CELLS, TOTAL_BAD);
+        componentResults.clear();
+        interiorCells.resize(TOTAL_CELLS);
+        std::iota(interiorCells.begin(), interiorCells.end(), 0);
+        remainingBadCount = TOTAL_BAD;
+        if (observer) observer->onReset();
     }
 
     // Update a single cell's content
     void setCell(int row, int col, CellContent content) {
         grid[row * COLS + col] = content;
+        if (observer) observer->onSetCell(row * COLS + col, content);
+    }
+
+    // A component's counts[k] table (empty if it wasn't enumerated)
+    CountSpan countsOf(const ComponentResult& cr) const {
+        if (!cr.hasCounts) return CountSpan();
+        return CountSpan{countTable.data() + cr.tableOffset, static_cast<size_t>(cr.size) + 1};
+    }
+
+    // badCounts[cell][k] of a component, k = 0..size (the component must have counts)
+    const double* badCountsOf(const ComponentResult& cr, int cell) const {
+        return countTable.data() + cr.tableOffset + static_cast<size_t>(cell + 1) * (cr.size + 1);
     }
 
     /*
@@ -191,18 +743,41 @@ public:
      * Returns a list of cell indices (0..39) surrounding a specific cell.
      * Handles boundary checks (corners, edges).
      */
-    static std::vector<int> getNeighbors(int idx) {
-        int r = idx / COLS, c = idx % COLS;
-        std::vector<int> nbrs;
-        nbrs.reserve(8);
-        for (int dr = -1; dr <= 1; dr++)
-            for (int dc = -1; dc <= 1; dc++) {
-                if (dr == 0 && dc == 0) continue; // Skip self
-                int nr = r + dr, nc = c + dc;
-                if (nr >= 0 && nr < ROWS && nc >= 0 && nc < COLS)
-                    nbrs.push_back(nr * COLS + nc);
+    static const NeighborList& getNeighbors(int idx) {
+        // Computed once: the board never changes shape
+        static const std::array<NeighborList, TOTAL_CELLS> table = [] {
+            std::array<NeighborList, TOTAL_CELLS> t;
+            for (int i = 0; i < TOTAL_CELLS; i++) {
+                int r = i / COLS, c = i % COLS;
+                for (int dr = -1; dr <= 1; dr++)
+                    for (int dc = -1; dc <= 1; dc++) {
+                        if (dr == 0 && dc == 0) continue; // Skip self
+                        int nr = r + dr, nc = c + dc;
+                        if (nr >= 0 && nr < ROWS && nc >= 0 && nc < COLS)
+                            t[i].push_back(nr * COLS + nc);
+                    }
+            }
+            return t;
+        }();
+        return table[idx];
+    }
+
+    /*
+     * cluesSatisfiedByKnownBad
+     * ------------------------
+     * Checks that every clue agrees with the revealed bad items alone,
+     * i.e. assuming every undug cell is safe.
+     */
+    bool cluesSatisfiedByKnownBad(const std::pmr::vector<int>& constraintCells) const {
+        for (int ci : constraintCells) {
+            auto range = badNeighborRange(grid[ci]);
+            int knownBadN = 0;
+            for (int n : getNeighbors(ci)) {
+                if (isRevealedBad(grid[n])) knownBadN++;
             }
-        return nbrs;
+            if (knownBadN < range.first || knownBadN > range.second) return false;
+        }
+        return true;
     }
 
     /*
@@ -212,30 +787,36 @@ public:
      * It tries every possible combination of Bad/Safe for the cells in a component
      * to see if they satisfy the local clues.
      * 
-     * If a valid configuration is found, it records stats in `counts` and `badCnts`.
+     * If a valid configuration is found, it is handed to `onLeaf(numBad, badMask)` (bit i of
+     * badMask = local cell i is bad; the mask is built up along the way), which records
+     * whatever the caller needs (solve() records stats in the component's count tables).
+     * `onLeaf` returns false to stop the whole search early; so does this function.
      */
-    static void enumerateComponent(
-        int pos, int numBad, int compSize, int remainingBad,
-        const std::vector<int>& order,
-        const std::vector<int>& orderPos,
-        std::vector<int>& assignment,
-        const std::vector<std::vector<int>>& cellConstraints,
-        const std::vector<LocalConstraint>& localConstraints,
-        std::vector<double>& counts,
-        std::vector<std::vector<double>>& badCnts)
+    template <class OnLeaf>
+    static bool enumerateComponent(
+        int pos, int numBad, uint64_t badMask, int compSize, int remainingBad,
+        const std::pmr::vector<int>& order,
+        const std::pmr::vector<int>& orderPos,
+        std::pmr::vector<int>& assignment,
+        const CellConstraintIndex& cellConstraints,
+        const std::pmr::vector<LocalConstraint>& localConstraints,
+        OnLeaf& onLeaf,
+        long long* nodes = nullptr,
+        SearchProfile* profile = nullptr)
     {
+        if (nodes) (*nodes)++; // Search statistics (see searchNodes)
+        if (profile) profile->at(pos).nodes++;
+
         // Optimization: Stop if we've already used more bad items than exist globally
-        if (numBad > remainingBad) return;
+        if (numBad > remainingBad) {
+            if (profile) profile->at(pos).budget++;
+            return true;
+        }
 
         // Base Case: All cells in component assigned
         if (pos == compSize) {
-            counts[numBad] += 1.0; // Valid configuration found with `numBad` items
-            for (int i = 0; i < compSize; i++) {
-                if (assignment[i]) {
-                    badCnts[i][numBad] += 1.0; // Record that cell i was bad in this config
-                }
-            }
-            return;
+            if (profile) profile->at(pos).leaves++;
+            return onLeaf(numBad, badMask); // Valid configuration found with `numBad` items
         }
 
         int cell = order[pos]; // Pick next cell to assign based on optimization order
@@ -247,8 +828,8 @@ public:
 
             // Check if this assignment violates any constraints immediately
             bool valid = true;
-            for (int ci : cellConstraints[cell]) {
-                const auto& lc = localConstraints[ci];
+            for (const int* cp = cellConstraints.begin(cell), *ce = cellConstraints.end(cell); cp != ce; ++cp) {
+                const auto& lc = localConstraints[*cp];
                 int badCount = 0, unassignedCount = 0;
                 
                 // Count bad items among neighbors processed so far
@@ -262,24 +843,31 @@ public:
                 
                 // Pruning:
                 // 1. Too many bad items? (Already exceeded max)
-                if (badCount > lc.maxBad) { valid = false; break; }
+                if (badCount > lc.maxBad) {
+                    if (profile) profile->at(pos + 1).overMax++;
+                    valid = false;
+                    break;
+                }
                 
                 // 2. Too few bad items? (Even if all remaining neighbors are bad, can't reach min)
-                if (unassignedCount == 0) {
-                    if (badCount < lc.minBad) { valid = false; break; }
-                } else {
-                    if (badCount + unassignedCount < lc.minBad) { valid = false; break; }
+                if (badCount + unassignedCount < lc.minBad) {
+                    if (profile) profile->at(pos + 1).underMin++;
+                    valid = false;
+                    break;
                 }
             }
 
             if (valid) {
                 // Recurse
-                enumerateComponent(pos + 1, newBad, compSize, remainingBad,
-                    order, orderPos, assignment, cellConstraints,
-                    localConstraints, counts, badCnts);
+                if (!enumerateComponent(pos + 1, newBad, badMask | (uint64_t(val) << cell), compSize, remainingBad,
+                        order, orderPos, assignment, cellConstraints,
+                        localConstraints, onLeaf, nodes, profile)) {
+                    return false; // Caller asked to stop
+                }
             }
         }
         assignment[cell] = 0; // Backtrack cleanup
+        return true;
     }
 
     /*
@@ -290,12 +878,16 @@ public:
      * If Component A has ways {1, 2} to have {0, 1} bombs,
      * and Component B has ways {3, 1} to have {0, 1} bombs,
      * convolve gives the ways for the combined set.
+     * Works on any vector type; the result has type `Out` and is made with `alloc`.
      */
-    static std::vector<double> convolve(const std::vector<double>& a, const std::vector<double>& b) {
-        if (a.empty() || b.empty()) return {};
-        std::vector<double> result(a.size() + b.size() - 1, 0.0);
-        for (size_t i = 0; i < a.size(); i++)
-            for (size_t j = 0; j < b.size(); j++)
+    template <class Out = std::vector<double>, class A, class B>
+    static Out convolve(const A& a, const B& b, const typename Out::allocator_type& alloc = typename Out::allocator_type(),
+                        size_t maxSize = std::numeric_limits<size_t>::max()) {
+        if (a.empty() || b.empty()) return Out(alloc);
+        // Only the first maxSize coefficients (degrees the caller will read) are computed
+        Out result(std::min(a.size() + b.size() - 1, maxSize), 0.0, alloc);
+        for (size_t i = 0; i < a.size() && i < result.size(); i++)
+            for (size_t j = 0; j < b.size() && i + j < result.size(); j++)
                 result[i + j] += a[i] * b[j];
         return result;
     }
@@ -306,10 +898,21 @@ public:
      * The main entry point for calculation.
      */
     void solve() {
+        searchNodes = 0;
+
+        // Stage reports for the profiling hook; Done is sent however solve() returns
+        struct StageGuard {
+            SolveStageObserver* obs;
+            void mark(SolveStage s) { if (obs) obs->onStage(s); }
+            ~StageGuard() { mark(SolveStage::Done); }
+        } stages{stageObserver};
+        stages.mark(SolveStage::Classify);
+
         // Step 1: Classification
         // Identify which cells are definitely bad, which are clues, and which are unknown.
-        std::vector<int> unknownCells;
-        std::vector<int> constraintCells; // Cells that provide clues
+        std::pmr::memory_resource* mr = memory;
+        std::pmr::vector<int> unknownCells(mr);
+        std::pmr::vector<int> constraintCells(mr); // Cells that provide clues
         int knownBad = 0;
 
         for (int i = 0; i < TOTAL_CELLS; i++) {
@@ -325,26 +928,34 @@ public:
         }
 
         int remainingBad = TOTAL_BAD - knownBad;
+        componentResults.clear();
+        interiorCells.assign(unknownCells.begin(), unknownCells.end());
+        remainingBadCount = remainingBad;
 
         // Trivial cases
-        if (unknownCells.empty()) return; // Nothing to solve
-        if (remainingBad <= 0) {
-            // Found all bad items! Everything else is safe.
+        if (unknownCells.empty() || remainingBad <= 0) {
+            // Found all bad items (or nothing left to dig)! Everything else is safe.
+            // The board is only valid if every clue is happy with the bad items already found.
             for (int idx : unknownCells) badProb[idx] = 0.0;
+            totalWays = (remainingBad == 0 && cluesSatisfiedByKnownBad(constraintCells)) ? 1.0 : 0.0;
+            logTotalWays = std::log(totalWays);
             return;
         }
         if (constraintCells.empty()) {
             // No clues? Just use uniform probability.
             double p = static_cast<double>(remainingBad) / unknownCells.size();
-            for (int idx : unknownCells) badProb[idx] = p;
+            for (int idx : unknownCells) badProb[idx] = std::min(p, 1.0);
+            totalWays = binomial((int)unknownCells.size(), remainingBad);
+            logTotalWays = logBinomial((int)unknownCells.size(), remainingBad);
             return;
         }
 
         // Step 2: Separation
         // "Frontier" cells = unknown cells touching a clue.
         // "Interior" cells = unknown cells NOT touching any clue.
-        std::unordered_set<int> unknownSet(unknownCells.begin(), unknownCells.end());
-        std::unordered_set<int> frontierSet;
+        std::pmr::unordered_set<int> unknownSet(unknownCells.begin(), unknownCells.end(), 0,
+                                                std::hash<int>(), std::equal_to<int>(), mr);
+        std::pmr::unordered_set<int> frontierSet(mr);
 
         for (int ci : constraintCells) {
             for (int n : getNeighbors(ci)) {
@@ -352,9 +963,10 @@ public:
             }
         }
 
-        std::vector<int> frontier(frontierSet.begin(), frontierSet.end());
+        std::pmr::vector<int> frontier(frontierSet.begin(), frontierSet.end(), mr);
         std::sort(frontier.begin(), frontier.end());
-        std::vector<int> interior;
+        std::vector<int>& interior = interiorCells;
+        interior.clear();
         for (int idx : unknownCells) {
             if (!frontierSet.count(idx)) interior.push_back(idx);
         }
@@ -362,15 +974,18 @@ public:
         int numFrontier = (int)frontier.size();
         int numInterior = (int)interior.size();
 
+        stages.mark(SolveStage::Constraints);
+
         // Step 3: Build Constraints
         // Convert the board state into mathematical rules (minBad, maxBad for lists of cells).
-        std::vector<Constraint> constraints;
+        std::pmr::vector<Constraint> constraints(mr);
+        bool contradiction = false; // A clue that can never be satisfied
         for (int ci : constraintCells) {
             auto range = badNeighborRange(grid[ci]);
             int minB = range.first, maxB = range.second;
-            auto nbrs = getNeighbors(ci);
+            const NeighborList& nbrs = getNeighbors(ci);
             int knownBadN = 0;
-            std::vector<int> fnbrs;
+            NeighborList fnbrs;
             
             for (int n : nbrs) {
                 if (isRevealedBad(grid[n])) {
@@ -382,6 +997,10 @@ public:
                 }
             }
             
+            // A clue already surrounded by too many bad items, or with too few
+            // unknown neighbors left to reach its minimum, can never be satisfied.
+            if (knownBadN > maxB || knownBadN + (int)fnbrs.size() < minB) contradiction = true;
+
             // Adjust requirements based on already found bad items
             int adjMin = std::max(0, minB - knownBadN);
             int adjMax = maxB - knownBadN;
@@ -402,20 +1021,37 @@ public:
 
         // Step 4: Partition into Components
         // Use Union-Find to group variables that interact with each other.
-        UnionFind uf(numFrontier);
+        UnionFind uf(numFrontier, mr);
         for (const auto& con : constraints) {
             for (int i = 1; i < (int)con.frontierLocalIdx.size(); i++) {
                 uf.unite(con.frontierLocalIdx[0], con.frontierLocalIdx[i]);
             }
         }
 
-        std::unordered_map<int, std::vector<int>> components;
+        std::pmr::unordered_map<int, std::pmr::vector<int>> components(mr);
         for (int i = 0; i < numFrontier; i++) {
             components[uf.find(i)].push_back(i);
         }
 
+        stages.mark(SolveStage::Enumerate);
+
         // Step 5: Solve Each Component Independently
-        std::vector<ComponentResult> compResults;
+        std::vector<ComponentResult>& compResults = componentResults;
+        size_t recordedSolutions = 0;
+
+        // All count tables go into one buffer: per component, (size + 1) rows of size + 1
+        // doubles (counts, then one row per cell), each component starting on a cache line.
+        const size_t lineDoubles = CountBuffer::ALIGN / sizeof(double);
+        auto tableSize = [&](int compSize) {
+            size_t n = static_cast<size_t>(compSize + 1) * (compSize + 1);
+            return (n + lineDoubles - 1) / lineDoubles * lineDoubles;
+        };
+        size_t tableTotal = 0;
+        for (auto& kv : components) {
+            if (kv.second.size() <= 40) tableTotal += tableSize((int)kv.second.size());
+        }
+        countTable.resetZeros(tableTotal, mr);
+        size_t nextTable = 0;
 
         for (auto& kv : components) {
             int root = kv.first;
@@ -423,13 +1059,13 @@ public:
             int compSize = (int)members.size();
 
             // Create a local mapping (0..compSize) for the backtrack solver
-            std::unordered_map<int, int> globalToLocal;
+            std::pmr::unordered_map<int, int> globalToLocal(mr);
             for (int i = 0; i < compSize; i++) {
                 globalToLocal[members[i]] = i;
             }
 
             // Filter constraints relevant to this component
-            std::vector<LocalConstraint> localConstraints;
+            std::pmr::vector<LocalConstraint> localConstraints(mr);
             for (const auto& con : constraints) {
                 bool relevant = false;
                 for (int fi : con.frontierLocalIdx) {
@@ -449,53 +1085,105 @@ public:
                 localConstraints.push_back(lc);
             }
 
-            // Prepare for enumeration
-            std::vector<double> counts(compSize + 1, 0.0);
-            std::vector<std::vector<double>> badCnts(compSize, std::vector<double>(compSize + 1, 0.0));
+            ComponentResult cr(mr);
+            cr.size = compSize;
+            cr.globalIndices = members;
+            for (int m : members) cr.cells.push_back(frontier[m]);
 
             // Heuristic optimization: Sort cells by how constrained they are
             if (compSize <= 40) { 
-                std::vector<int> assignment(compSize, 0);
+                // Prepare for enumeration: this component's (zeroed) count tables
+                cr.hasCounts = true;
+                cr.tableOffset = nextTable;
+                nextTable += tableSize(compSize);
+                double* counts = countTable.data() + cr.tableOffset;
+                double* badCnts = counts + (compSize + 1); // badCnts[i * (compSize + 1) + k]
 
-                std::vector<std::vector<int>> cellConstraints(compSize);
-                for (int ci = 0; ci < (int)localConstraints.size(); ci++) {
-                    for (int li : localConstraints[ci].localIdx) {
-                        cellConstraints[li].push_back(ci);
-                    }
-                }
+                std::pmr::vector<int> assignment(compSize, 0, mr);
 
-                std::vector<int> order(compSize);
+                CellConstraintIndex cellConstraints(mr);
+                cellConstraints.build(compSize, localConstraints);
+
+                std::pmr::vector<int> order(compSize, mr);
                 std::iota(order.begin(), order.end(), 0);
                 std::sort(order.begin(), order.end(), [&](int a, int b) {
-                    return cellConstraints[a].size() > cellConstraints[b].size();
+                    return cellConstraints.count(a) > cellConstraints.count(b);
                 });
 
-                std::vector<int> orderPos(compSize);
+                std::pmr::vector<int> orderPos(compSize, mr);
                 for (int i = 0; i < compSize; i++) orderPos[order[i]] = i;
 
+                if (recordSolutions) {
+                    cr.solutions.resize(compSize + 1);
+                    cr.solutionsComplete = true;
+                }
+
+                // At every valid layout: count it, and remember it if asked to.
+                // Big components can have millions of layouts: their per-cell counts go
+                // through the byte histogram (one addition per 8 cells), small ones directly.
+                const size_t stride = compSize + 1;
+                const bool batched = compSize > LEAF_HISTOGRAM_MIN_CELLS;
+                if (batched) leafHistogram.reset(compSize, std::min(compSize, remainingBad), mr);
+                auto onLeaf = [&](int numBad, uint64_t mask) {
+                    counts[numBad] += 1.0;
+                    if (batched) {
+                        leafHistogram.add(numBad, mask);
+                    } else {
+                        for (uint64_t m = mask; m; m &= m - 1) {
+                            badCnts[lowestBit(m) * stride + numBad] += 1.0; // Record that cell i was bad in this config
+                        }
+                    }
+                    if (recordSolutions && cr.solutionsComplete) {
+                        if (recordedSolutions < maxRecordedSolutions) {
+                            cr.solutions[numBad].push_back(mask);
+                            recordedSolutions++;
+                        } else {
+                            cr.solutionsComplete = false; // Too many: the sampler will walk instead
+                            cr.solutions.clear();
+                        }
+                    }
+                    return true;
+                };
+
+                if (searchProfile) {
+                    SearchProfile::Component pc;
+                    pc.position = searchProfile->position;
+                    for (int li : order) pc.cells.push_back(frontier[members[li]]);
+                    pc.depth.resize(compSize + 1);
+                    searchProfile->components.push_back(std::move(pc));
+                }
+
                 // RUN BACKTRACKING
-                enumerateComponent(0, 0, compSize, remainingBad,
+                enumerateComponent(0, 0, 0, compSize, remainingBad,
                     order, orderPos, assignment, cellConstraints,
-                    localConstraints, counts, badCnts);
+                    localConstraints, onLeaf, &searchNodes, searchProfile);
+                if (batched) leafHistogram.flush(badCnts, stride);
+
+                cr.cellConstraints = std::move(cellConstraints);
+                cr.order = std::move(order);
+                cr.orderPos = std::move(orderPos);
             } else {
                 // Should not happen on standard board, but fallback just in case
                 double p = static_cast<double>(remainingBad) / (int)unknownCells.size();
                 for (int i = 0; i < compSize; i++) {
                     badProb[frontier[members[i]]] = p;
                 }
-                ComponentResult cr;
-                cr.size = compSize;
-                cr.globalIndices = members;
-                compResults.push_back(cr);
+                compResults.push_back(std::move(cr));
                 continue;
             }
 
-            ComponentResult cr;
-            cr.size = compSize;
-            cr.counts = counts;
-            cr.badCounts = badCnts;
-            cr.globalIndices = members;
-            compResults.push_back(cr);
+            cr.localConstraints = std::move(localConstraints);
+            compResults.push_back(std::move(cr));
+        }
+
+        stages.mark(SolveStage::Combine);
+
+        // Big boards have more layouts than a double can count: combine in scaled arithmetic.
+        // Every count below is at most 2^(unknown cells), so plain doubles are safe up to
+        // SCALED_COMBINE_MIN_CELLS unknown cells (2^900 is about 1e271).
+        if (forceScaledCombine || (int)unknownCells.size() > SCALED_COMBINE_MIN_CELLS) {
+            combineScaled(frontier, (int)unknownCells.size(), remainingBad, contradiction);
+            return;
         }
 
         // Step 6: Global Combination
@@ -504,22 +1192,43 @@ public:
         int numComps = (int)compResults.size();
 
         // Calculate distribution for interior (free) cells using binomial coeffs
-        std::vector<double> interiorPoly(numInterior + 1);
-        for (int m = 0; m <= numInterior; m++) {
-            interiorPoly[m] = binomial(numInterior, m);
+        using Poly = std::pmr::vector<double>;
+        Poly interiorPoly(numInterior + 1, mr);
+        if (const double* row = binomialRow(numInterior)) {
+            std::copy(row, row + numInterior + 1, interiorPoly.begin());
+        } else {
+            for (int m = 0; m <= numInterior; m++) interiorPoly[m] = binomial(numInterior, m);
         }
 
-        // Convolve everything together to get total valid configurations
-        std::vector<double> compProd = {1.0};
+        // Convolve everything together to get total valid configurations.
+        // A product tree (poly_product.h) with the interior as leaf 0 and one leaf per component
+        // also gives every leaf the product of all the OTHER leaves, which Steps 7 and 8 need,
+        // in O(n log n) convolutions instead of one full product per component.
+        // The counts are integers below 2^53, so the order of the products doesn't change them.
+        // Only degree remainingBad of the total is read: products stop there.
+        const size_t keep = static_cast<size_t>(std::max(remainingBad, 0)) + 1;
+        auto mul = [mr, keep](const Poly& a, const Poly& b) { return convolve<Poly>(a, b, mr, keep); };
+        auto middle = [mr](const Poly& a, const Poly& b, size_t offset, size_t count) {
+            Poly r(count, 0.0, mr);
+            middleProduct(a, b, offset, r, [](double sum, double x, double y) { return sum + x * y; });
+            return r;
+        };
+        std::pmr::vector<Poly> leaves(mr);
+        std::pmr::vector<int> leafOfComp(numComps, -1, mr);
+        leaves.push_back(std::move(interiorPoly));
         for (int i = 0; i < numComps; i++) {
-            if (compResults[i].counts.empty()) continue;
-            compProd = convolve(compProd, compResults[i].counts);
+            if (!compResults[i].hasCounts) continue;
+            CountSpan counts = countsOf(compResults[i]);
+            leafOfComp[i] = (int)leaves.size();
+            leaves.emplace_back(counts.begin(), counts.end());
         }
-
-        std::vector<double> totalPoly = convolve(interiorPoly, compProd);
+        PolyProductTree<Poly> tree(mr);
+        tree.build(leaves, mul);
+        const Poly& totalPoly = tree.product();
 
         // How many valid worlds exist with exactly `remainingBad` items?
-        double totalWays = (remainingBad < (int)totalPoly.size()) ? totalPoly[remainingBad] : 0.0;
+        totalWays = (remainingBad < (int)totalPoly.size() && !contradiction) ? totalPoly[remainingBad] : 0.0;
+        logTotalWays = std::log(totalWays);
 
         if (totalWays <= 0.0) {
             // Contradiction detected (user made a mistake?). Fallback.
@@ -527,30 +1236,29 @@ public:
             for (int idx : unknownCells) badProb[idx] = p;
             return;
         }
+        tree.buildLeaveOneOut(middle, Poly(1, 1.0, mr), remainingBad);
 
         // Step 7: Final Probability Calculation for Frontier Cells
         for (int ci = 0; ci < numComps; ci++) {
             auto& cr = compResults[ci];
-            if (cr.counts.empty()) continue;
+            if (!cr.hasCounts) continue;
 
-            // Calculate combinations for "everything EXCEPT this component"
-            std::vector<double> withoutComp = {1.0};
-            for (int j = 0; j < numComps; j++) {
-                if (j == ci || compResults[j].counts.empty()) continue;
-                withoutComp = convolve(withoutComp, compResults[j].counts);
-            }
-            std::vector<double> totalWithout = convolve(withoutComp, interiorPoly);
+            // Combinations for "everything EXCEPT this component" (interior included),
+            // from degree `low` on
+            const Poly& totalWithout = tree.without(leafOfComp[ci]);
+            int low = (int)tree.withoutLow(leafOfComp[ci]);
 
             for (int li = 0; li < cr.size; li++) {
                 int frontierIdx = cr.globalIndices[li];
                 int globalIdx = frontier[frontierIdx];
+                const double* cellBad = badCountsOf(cr, li);
 
                 double numerator = 0.0;
                 // Sum configurations where this cell is bad
                 for (int k = 0; k <= cr.size && k <= remainingBad; k++) {
                     int rest = remainingBad - k; // Items remaining for rest of board
-                    if (rest >= 0 && rest < (int)totalWithout.size()) {
-                        numerator += cr.badCounts[li][k] * totalWithout[rest];
+                    if (rest >= low && rest - low < (int)totalWithout.size()) {
+                        numerator += cellBad[k] * totalWithout[rest - low];
                     }
                 }
                 badProb[globalIdx] = numerator / totalWays;
@@ -559,12 +1267,16 @@ public:
 
         // Step 8: Probability for Interior Cells
         if (numInterior > 0) {
+            const Poly& compProd = tree.without(0); // All components, no interior
+            int low = (int)tree.withoutLow(0);
             double interiorNumerator = 0.0;
+            const double* row = binomialRow(numInterior - 1);
             for (int m = 1; m <= numInterior && m <= remainingBad; m++) {
                 int rest = remainingBad - m;
-                if (rest >= 0 && rest < (int)compProd.size()) {
+                if (rest >= low && rest - low < (int)compProd.size()) {
                     // interior cells pick m items, rest pick remainder
-                    interiorNumerator += binomial(numInterior - 1, m - 1) * compProd[rest];
+                    double ways = row ? row[m - 1] : binomial(numInterior - 1, m - 1);
+                    interiorNumerator += ways * compProd[rest - low];
                 }
             }
             double interiorProb = interiorNumerator / totalWays;
@@ -579,4 +1291,111 @@ public:
             if (badProb[i] > 1.0) badProb[i] = 1.0;
         }
     }
+
+    /*
+     * combineScaled
+     * -------------
+     * Steps 6-8 of solve() in ScaledPoly arithmetic, for boards whose layout counts overflow a
+     * double. Same formulas and the same product tree; each probability is a ratio of two
+     * scaled sums.
+     *
+     * Every polynomial is first "tilted": coefficient i is multiplied by t^i. Tilting commutes
+     * with multiplication and the t's cancel in every probability, but it moves the bulk of the
+     * total polynomial to the coefficient we read (remainingBad) when t = p / (1 - p) with p the
+     * average bad density. Rounding (and the FFT, see poly_product.h) is relative to the
+     * largest coefficient, so this keeps the coefficients we need accurate.
+     * Every polynomial is also cut off after degree remainingBad (no layout can use more bad
+     * items), so normalizing never divides by a coefficient that is never read. Without these
+     * two steps the interior polynomial's peak at numInterior / 2 is what gets scaled to 1:
+     * with 3000 interior cells and 300 bad items the coefficient we need would be
+     * C(3000, 300) / C(3000, 1500), about e^-1104, which is 0 as a double.
+     */
+    void combineScaled(const std::pmr::vector<int>& frontier, int numUnknown, int remainingBad, bool contradiction) {
+        std::pmr::memory_resource* mr = memory;
+        const std::vector<ComponentResult>& compResults = componentResults;
+        const std::vector<int>& interior = interiorCells;
+        int numComps = (int)compResults.size();
+        int numInterior = (int)interior.size();
+        const double NEG_INF = -std::numeric_limits<double>::infinity();
+
+        double p = std::clamp((double)remainingBad / numUnknown, 0.5 / numUnknown, 1.0 - 0.5 / numUnknown);
+        double logTilt = std::log(p / (1.0 - p));
+
+        // Step 6: tilted leaves (interior first) and their product tree, all cut off after
+        // degree remainingBad
+        const size_t keep = static_cast<size_t>(std::max(remainingBad, 0)) + 1;
+        std::pmr::vector<ScaledPoly> leaves(mr);
+        std::pmr::vector<int> leafOfComp(numComps, -1, mr);
+        leaves.push_back(ScaledPoly::fromLogs(std::min<size_t>(numInterior + 1, keep), [&](size_t m) {
+            return logBinomial(numInterior, (int)m) + m * logTilt;
+        }, mr));
+        for (int i = 0; i < numComps; i++) {
+            if (!compResults[i].hasCounts) continue;
+            CountSpan counts = countsOf(compResults[i]);
+            leafOfComp[i] = (int)leaves.size();
+            leaves.push_back(ScaledPoly::fromLogs(std::min(counts.size(), keep), [&](size_t k) {
+                return counts[k] > 0.0 ? std::log(counts[k]) + k * logTilt : NEG_INF;
+            }, mr));
+        }
+        auto mul = [mr, keep](const ScaledPoly& a, const ScaledPoly& b) { return ScaledPoly::product(a, b, mr, keep); };
+        PolyProductTree<ScaledPoly> tree(mr);
+        tree.build(leaves, mul);
+        const ScaledPoly& totalPoly = tree.product();
+
+        double logTotal = contradiction ? NEG_INF : totalPoly.logAt(remainingBad);
+        logTotalWays = logTotal - remainingBad * logTilt;
+        totalWays = std::exp(logTotalWays);
+        if (!(logTotal > NEG_INF)) {
+            logTotalWays = NEG_INF;
+            totalWays = 0.0;
+            double fallback = static_cast<double>(remainingBad) / numUnknown;
+            for (int i = 0; i < TOTAL_CELLS; i++) {
+                if (grid[i] == CellContent::Undug) badProb[i] = fallback;
+            }
+            return;
+        }
+        double totalCoef = totalPoly.c[remainingBad];
+        auto middle = [mr](const ScaledPoly& a, const ScaledPoly& b, size_t offset, size_t count) {
+            return ScaledPoly::middle(a, b, offset, count, mr);
+        };
+        tree.buildLeaveOneOut(middle, ScaledPoly::fromLogs(1, [](size_t) { return 0.0; }, mr), remainingBad);
+
+        // Step 7: frontier cells. The per-cell counts are not tilted, hence the t^k.
+        for (int ci = 0; ci < numComps; ci++) {
+            const ComponentResult& cr = compResults[ci];
+            if (!cr.hasCounts) continue;
+            const ScaledPoly& totalWithout = tree.without(leafOfComp[ci]);
+            int low = (int)tree.withoutLow(leafOfComp[ci]);
+            double logFactor = totalWithout.logScale - totalPoly.logScale;
+
+            for (int li = 0; li < cr.size; li++) {
+                const double* cellBad = badCountsOf(cr, li);
+                double numerator = 0.0;
+                for (int k = 0; k <= cr.size && k <= remainingBad; k++) {
+                    int rest = remainingBad - k;
+                    if (cellBad[k] <= 0.0 || rest < low || rest - low >= (int)totalWithout.c.size()) continue;
+                    numerator += std::exp(std::log(cellBad[k]) + k * logTilt + logFactor) * totalWithout.c[rest - low];
+                }
+                badProb[frontier[cr.globalIndices[li]]] = std::min(1.0, std::max(0.0, numerator / totalCoef));
+            }
+        }
+
+        // Step 8: interior cells. C(n - 1, m - 1) = C(n, m) * m / n, so the interior sum
+        // reuses the interior polynomial (both sides tilted by t^m: they cancel).
+        if (numInterior > 0) {
+            const ScaledPoly& interiorPoly = tree.leaf(0);
+            const ScaledPoly& compProd = tree.without(0);
+            int low = (int)tree.withoutLow(0);
+            double numerator = 0.0;
+            for (int m = 1; m <= numInterior && m <= remainingBad; m++) {
+                int rest = remainingBad - m;
+                if (rest >= low && rest - low < (int)compProd.c.size()) {
+                    numerator += interiorPoly.c[m] * m * compProd.c[rest - low];
+                }
+            }
+            double factor = std::exp(interiorPoly.logScale + compProd.logScale - totalPoly.logScale) / totalCoef;
+            double interiorProb = std::min(1.0, std::max(0.0, numerator / numInterior * factor));
+            for (int idx : interior) badProb[idx] = interiorProb;
+        }
+    }
 };
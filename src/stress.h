@@ -0,0 +1,286 @@
+/*
+=================================================================================================
+FILE: src/stress.h
+
+DESCRIPTION:
+This file hunts for the positions that are hardest for the solver: boards where the backtracking
+search (`enumerateComponent`) visits the most nodes or takes the longest. It also keeps these
+positions in a small text "corpus" and benchmarks the solver on them.
+
+IMPORTANCE:
+Most positions solve in microseconds; a few with big, loosely constrained frontiers take
+milliseconds or more, and those few decide how slow the app feels (the p99 latency). An
+optimization is only worth it if it helps on these worst cases, so they need to be found and
+kept around as a benchmark.
+
+INTERACTION:
+- Includes "boardgen.h" for real random boards (so every position found is consistent).
+- Uses `ThrillDiggerSolver::searchNodes` as the machine-independent cost of a solve.
+- Includes "sketch.h" for the benchmark's latency histogram.
+- Driven by the `stress` command of `src/cli.cpp`. The default corpus is bench/worst_boards.txt.
+- Turns a `SearchProfile` (solver.h) into per-depth / per-cell tables and flamegraph input.
+
+ALGORITHM OVERVIEW (simulated annealing over reveal sets):
+1. Take a generated board. A position is a set of its cells that are "revealed" (showing their
+   true content); bombs are never revealed, since that would end the game.
+2. Cost of a position = search nodes of a fresh solve (or the best of 3 solve times).
+3. Move: reveal or hide one or two random cells. Better positions are always kept; worse ones
+   are kept with probability exp(log(cost ratio) / T), where the temperature T slowly drops
+   (with the step count or the board's time budget, whichever is further along).
+   Early on the search wanders widely; at the end it only climbs.
+4. Restart on several boards and keep the overall worst positions (mirror images count once).
+
+CORPUS FORMAT:
+One position per line: the 40-character board text (see `boardToText`), then optionally
+"# comment" (cost when found, origin). Blank lines and lines starting with # are ignored.
+=================================================================================================
+*/
+
+#pragma once
+#include "boardgen.h"
+#include "sketch.h"
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <set>
+
+// One hard position.
+struct WorstCase {
+    std::array<CellContent, TOTAL_CELLS> grid;
+    long long nodes = 0;     // Search nodes of one solve
+    double micros = 0.0;     // Best of 3 solve times, in microseconds
+    std::string origin;      // Where it came from (e.g. "seed 1 game 4")
+};
+
+// Nodes and best-of-`runs` time of solving `grid` from scratch
+inline void measureSolve(ThrillDiggerSolver& solver, const std::array<CellContent, TOTAL_CELLS>& grid,
+                         int runs, long long& nodes, double& micros)
+{
+    micros = 1e300;
+    for (int r = 0; r < runs; r++) {
+        solver.reset();
+        solver.grid = grid;
+        auto start = std::chrono::steady_clock::now();
+        solver.solve();
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        micros = std::min(micros, us);
+    }
+    nodes = solver.searchNodes;
+}
+
+struct WorstCaseConfig {
+    uint64_t seed = 1;
+    int boards = 20;               // Generated boards to start from (restarts)
+    long long iterations = 2000;   // Annealing steps per board...
+    double secondsPerBoard = 30.0; // ...or fewer, when a board's time budget runs out
+    double startTemperature = 1.0; // In units of log(cost)
+    double endTemperature = 0.01;
+    bool byTime = false;           // Maximize solve time instead of search nodes
+    size_t keep = 10;              // Worst positions returned
+};
+
+class WorstCaseSearch {
+public:
+    // Called whenever a board's best position improves (for progress output)
+    std::function<void(int board, const WorstCase&)> onImprove;
+
+    // Returns the `keep` worst positions found, worst first
+    std::vector<WorstCase> run(const WorstCaseConfig& cfg) {
+        std::vector<WorstCase> best;
+        std::set<PackedBoard> seen; // Canonical boards already in `best`
+
+        for (int b = 0; b < cfg.boards; b++) {
+            std::array<CellContent, TOTAL_CELLS> answer = generateBoard(cfg.seed, static_cast<uint64_t>(b)).toGrid();
+            std::vector<int> revealable;
+            for (int i = 0; i < TOTAL_CELLS; i++) {
+                if (answer[i] != CellContent::Bomb) revealable.push_back(i);
+            }
+            std::mt19937_64 rng(mix64(cfg.seed ^ mix64(static_cast<uint64_t>(b) + 1)));
+            std::uniform_real_distribution<double> uni(0.0, 1.0);
+
+            // Start from a random quarter of the revealable cells
+            std::array<CellContent, TOTAL_CELLS> grid;
+            grid.fill(CellContent::Undug);
+            for (int i : revealable) {
+                if (uni(rng) < 0.25) grid[i] = answer[i];
+            }
+            auto start = std::chrono::steady_clock::now();
+            double cost = costOf(grid, cfg);
+            WorstCase boardBest = makeCase(grid, cfg.seed, b);
+
+            for (long long it = 0; it < cfg.iterations; it++) {
+                // Hard positions take seconds to solve, so the schedule follows the clock too
+                double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (elapsed > cfg.secondsPerBoard) break;
+                double progress = std::max(static_cast<double>(it) / std::max(1LL, cfg.iterations),
+                                           elapsed / cfg.secondsPerBoard);
+                double temperature = cfg.startTemperature * std::pow(cfg.endTemperature / cfg.startTemperature, progress);
+
+                std::array<CellContent, TOTAL_CELLS> next = grid;
+                int flips = uni(rng) < 0.5 ? 1 : 2;
+                for (int f = 0; f < flips; f++) {
+                    int cell = revealable[rng() % revealable.size()];
+                    next[cell] = next[cell] == CellContent::Undug ? answer[cell] : CellContent::Undug;
+                }
+                double nextCost = costOf(next, cfg);
+                double delta = std::log(nextCost + 1.0) - std::log(cost + 1.0);
+                if (delta >= 0.0 || uni(rng) < std::exp(delta / temperature)) {
+                    grid = next;
+                    cost = nextCost;
+                    if (cost > (cfg.byTime ? boardBest.micros : static_cast<double>(boardBest.nodes))) {
+                        boardBest = makeCase(grid, cfg.seed, b);
+                        if (onImprove) onImprove(b, boardBest);
+                    }
+                }
+            }
+
+            PackedBoard key = canonicalBoard(boardBest.grid, nullptr);
+            if (seen.insert(key).second) best.push_back(boardBest);
+            std::sort(best.begin(), best.end(), [&](const WorstCase& x, const WorstCase& y) {
+                return cfg.byTime ? x.micros > y.micros : x.nodes > y.nodes;
+            });
+            if (best.size() > cfg.keep) best.resize(cfg.keep);
+        }
+        return best;
+    }
+
+private:
+    ThrillDiggerSolver solver;
+
+    double costOf(const std::array<CellContent, TOTAL_CELLS>& grid, const WorstCaseConfig& cfg) {
+        long long nodes;
+        double micros;
+        measureSolve(solver, grid, cfg.byTime ? 3 : 1, nodes, micros);
+        return cfg.byTime ? micros : static_cast<double>(nodes);
+    }
+
+    WorstCase makeCase(const std::array<CellContent, TOTAL_CELLS>& grid, uint64_t seed, int board) {
+        WorstCase w;
+        w.grid = grid;
+        measureSolve(solver, grid, 3, w.nodes, w.micros);
+        w.origin = "seed " + std::to_string(seed) + " game " + std::to_string(board);
+        return w;
+    }
+};
+
+// Ordinary mid-game positions for comparison with the worst cases: on each generated board a
+// random share (up to a half) of the non-bomb cells is revealed.
+inline void typicalPositions(uint64_t seed, int count, std::vector<WorstCase>& cases) {
+    std::mt19937_64 rng(mix64(seed ^ 0x7479706963616cULL));
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    for (int g = 0; g < count; g++) {
+        std::array<CellContent, TOTAL_CELLS> answer = generateBoard(seed, static_cast<uint64_t>(g)).toGrid();
+        double share = 0.5 * uni(rng);
+        WorstCase w;
+        w.grid.fill(CellContent::Undug);
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            if (answer[i] != CellContent::Bomb && uni(rng) < share) w.grid[i] = answer[i];
+        }
+        w.origin = "seed " + std::to_string(seed) + " game " + std::to_string(g);
+        cases.push_back(w);
+    }
+}
+
+// =================================================================================================
+// CORPUS
+// =================================================================================================
+
+// Appends positions to a corpus file (creating it if needed)
+inline bool appendCorpus(const std::string& path, const std::vector<WorstCase>& cases) {
+    std::ofstream out(path, std::ios::app);
+    if (!out) return false;
+    for (const WorstCase& w : cases) {
+        char info[128];
+        std::snprintf(info, sizeof(info), "  # nodes=%lld us=%.0f %s", w.nodes, w.micros, w.origin.c_str());
+        out << boardToText(w.grid) << info << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+// Reads every position of a corpus file. Returns false if the file can't be read or has a bad line.
+inline bool readCorpus(const std::string& path, std::vector<WorstCase>& cases, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot read " + path;
+        return false;
+    }
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        std::string text = line.substr(0, line.find('#'));
+        text.erase(std::remove(text.begin(), text.end(), '\r'), text.end());
+        if (text.find_first_not_of(" \t") == std::string::npos) continue;
+        WorstCase w;
+        if (!boardFromText(text, w.grid)) {
+            error = path + ":" + std::to_string(lineNo) + ": not a board";
+            return false;
+        }
+        w.origin = path + ":" + std::to_string(lineNo);
+        cases.push_back(w);
+    }
+    return true;
+}
+
+// =================================================================================================
+// SEARCH PROFILE OUTPUT
+// =================================================================================================
+
+// Cell name used in profiles, 1-based like the GUI: "r2c5"
+inline std::string profileCellName(int idx) {
+    return "r" + std::to_string(idx / COLS + 1) + "c" + std::to_string(idx % COLS + 1);
+}
+
+/*
+ * writeFoldedStacks
+ * -----------------
+ * Writes a profile in the "folded stacks" format of flamegraph.pl / speedscope / inferno:
+ * one line per stack, frames separated by ';', then a count. A stack is
+ * position;component;first cell;second cell;...;[outcome], so the width of a cell's frame is
+ * the number of search nodes spent below it. Outcomes: [leaf], [over budget], [over max],
+ * [under min]; nodes that went on to deeper cells count for their own frame.
+ */
+inline bool writeFoldedStacks(const std::string& path, const SearchProfile& profile) {
+    std::map<std::string, long long> stacks; // Identical stacks (same position solved again) add up
+    std::map<std::string, int> componentNumber;
+    for (const SearchProfile::Component& c : profile.components) {
+        int number = ++componentNumber[c.position];
+        std::string stack = (c.position.empty() ? std::string("solve") : c.position) + ";component " +
+                            std::to_string(number) + " (" + std::to_string(c.cells.size()) + " cells)";
+        for (size_t d = 0; d < c.depth.size(); d++) {
+            const SearchDepthStats& s = c.depth[d];
+            if (d > 0) stack += ";" + profileCellName(c.cells[d - 1]);
+            long long inner = s.nodes - s.budget - s.leaves;
+            if (inner > 0) stacks[stack] += inner;
+            if (s.leaves) stacks[stack + ";[leaf]"] += s.leaves;
+            if (s.budget) stacks[stack + ";[over budget]"] += s.budget;
+            if (s.overMax) stacks[stack + ";[over max]"] += s.overMax;
+            if (s.underMin) stacks[stack + ";[under min]"] += s.underMin;
+        }
+    }
+    std::ofstream out(path);
+    for (const auto& kv : stacks) out << kv.first << " " << kv.second << "\n";
+    return static_cast<bool>(out);
+}
+
+// Totals of a profile by depth and by board cell
+inline void summarizeProfile(const SearchProfile& profile, std::vector<SearchDepthStats>& byDepth,
+                             std::array<SearchDepthStats, TOTAL_CELLS>& byCell)
+{
+    auto add = [](SearchDepthStats& to, const SearchDepthStats& s) {
+        to.nodes += s.nodes;
+        to.budget += s.budget;
+        to.leaves += s.leaves;
+        to.overMax += s.overMax;
+        to.underMin += s.underMin;
+    };
+    for (const SearchProfile::Component& c : profile.components) {
+        if (byDepth.size() < c.depth.size()) byDepth.resize(c.depth.size());
+        for (size_t d = 0; d < c.depth.size(); d++) {
+            add(byDepth[d], c.depth[d]);
+            if (d > 0) add(byCell[c.cells[d - 1]], c.depth[d]); // What assigning this cell led to
+        }
+    }
+}
@@ -0,0 +1,192 @@
+/*
+=================================================================================================
+FILE: src/thrilldigger.cpp
+
+DESCRIPTION:
+This file implements the C interface declared in `src/thrilldigger.h` on top of the C++
+solver. It is the only source file of the `thrilldigger` shared library.
+
+IMPORTANCE:
+Everything C++ stays in here: exceptions are caught before they reach a C caller, and the
+solver's memory comes from an arena owned by the scratch handle, so solving through a handle
+never calls the heap.
+
+INTERACTION:
+- Includes "thrilldigger.h" (the interface), "solver.h" (the solver) and "alloc_stats.h"
+  (CountingResource, to count the allocations that miss the arena).
+
+HOW IT WORKS:
+A td_scratch holds, in this order:
+1. `heap`: a counting resource over new/delete. Only used when the arena is full.
+2. `arena`: one block of memory, given out front to back by a monotonic_buffer_resource.
+3. `pool`: an unsynchronized_pool_resource on top of the arena. The solver frees and takes
+   back the same sizes on every solve, and the pool keeps the freed blocks for the next one,
+   so after the first few boards no new arena memory is used either. (Its default options
+   matter: bigger pool blocks make it reserve chunks of several blocks at once, megabytes for
+   the solver's large count tables, which the few large requests don't need.)
+4. The solver, with `memory` = the pool, and its result vectors reserved for the largest board.
+=================================================================================================
+*/
+
+#define TD_BUILDING_LIBRARY
+#include "thrilldigger.h"
+#include "solver.h"
+#include "alloc_stats.h"
+#include <memory>
+#include <new>
+
+static_assert(sizeof(td_board) == sizeof(PackedBoard), "td_board must match PackedBoard");
+static_assert(TD_CELLS == TOTAL_CELLS && TD_ROWS == ROWS && TD_COLS == COLS, "board size");
+static_assert(TD_BOMB == static_cast<int>(CellContent::Bomb), "cell codes must match CellContent");
+
+// Default arena. Solving every board of bench/worst_boards.txt plus 3000 random mid-game
+// positions through one handle uses about 360 KiB of it.
+constexpr size_t TD_DEFAULT_ARENA_BYTES = size_t(1) << 20;
+
+struct td_scratch {
+    CountingResource heap;
+    std::unique_ptr<unsigned char[]> arenaMemory;
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::unsynchronized_pool_resource pool;
+    ThrillDiggerSolver solver;
+
+    explicit td_scratch(size_t arenaBytes)
+        : heap(std::pmr::new_delete_resource()),
+          arenaMemory(new unsigned char[arenaBytes]),
+          arena(arenaMemory.get(), arenaBytes, &heap),
+          pool(&arena) {
+        solver.memory = &pool;
+        // Room for one component per cell, so these never grow during a solve
+        solver.componentResults.reserve(TOTAL_CELLS);
+        solver.interiorCells.reserve(TOTAL_CELLS);
+    }
+};
+
+namespace {
+
+// Bits of a td_board that don't belong to any cell (lo: bit 63; hi: bits 57..63)
+constexpr uint64_t UNUSED_LO_BITS = ~uint64_t(0) << (PACK_LO_CELLS * PACK_BITS);
+constexpr uint64_t UNUSED_HI_BITS = ~uint64_t(0) << ((TOTAL_CELLS - PACK_LO_CELLS) * PACK_BITS);
+
+// The scratch of the calling thread when NULL is passed; made (one allocation of the default
+// arena plus the solver) by its first call, freed when the thread exits
+td_scratch* threadScratch() {
+    thread_local std::unique_ptr<td_scratch> scratch;
+    if (!scratch) scratch.reset(new (std::nothrow) td_scratch(TD_DEFAULT_ARENA_BYTES));
+    return scratch.get();
+}
+
+bool validBoard(const td_board& board) {
+    return !(board.lo & UNUSED_LO_BITS) && !(board.hi & UNUSED_HI_BITS);
+}
+
+// Solves one (valid) board into out[0..TOTAL_CELLS-1]; float or double output
+template <class T>
+int solveInto(td_scratch* scratch, const td_board& board, T* out, double* totalWays) {
+    ThrillDiggerSolver& solver = scratch->solver;
+    solver.grid = unpackBoard(PackedBoard{board.lo, board.hi});
+    solver.solve();
+    for (int i = 0; i < TOTAL_CELLS; i++) out[i] = static_cast<T>(solver.badProb[i]);
+    if (totalWays) *totalWays = solver.totalWays;
+    return solver.totalWays > 0.0 ? TD_OK : TD_CONTRADICTORY;
+}
+
+template <class T>
+int solveBatch(td_scratch* scratch, const td_board* boards, size_t count, T* probs, size_t stride,
+               double* totalWays) {
+    if (count > 0 && (!boards || !probs)) return TD_ERROR_ARGUMENT;
+    if (stride == 0) stride = TOTAL_CELLS;
+    if (stride < static_cast<size_t>(TOTAL_CELLS)) return TD_ERROR_ARGUMENT;
+    // Every board is checked before the first is solved, so a bad one leaves all outputs alone
+    for (size_t i = 0; i < count; i++) {
+        if (!validBoard(boards[i])) return TD_ERROR_ARGUMENT;
+    }
+    if (!scratch) scratch = threadScratch();
+    if (!scratch) return TD_ERROR_OUT_OF_MEMORY;
+    int status = TD_OK;
+    try {
+        for (size_t i = 0; i < count; i++) {
+            int s = solveInto(scratch, boards[i], probs + i * stride, totalWays ? totalWays + i : nullptr);
+            if (s == TD_CONTRADICTORY) status = TD_CONTRADICTORY;
+        }
+    } catch (const std::bad_alloc&) {
+        return TD_ERROR_OUT_OF_MEMORY;
+    }
+    return status;
+}
+
+} // namespace
+
+// =================================================================================================
+// EXPORTED FUNCTIONS
+// =================================================================================================
+
+extern "C" {
+
+uint32_t td_api_version(void) { return TD_API_VERSION; }
+
+int td_pack_cells(const uint8_t* cells, td_board* out) {
+    if (!cells || !out) return TD_ERROR_ARGUMENT;
+    std::array<CellContent, TOTAL_CELLS> grid;
+    for (int i = 0; i < TOTAL_CELLS; i++) {
+        if (cells[i] > TD_BOMB) return TD_ERROR_ARGUMENT;
+        grid[i] = static_cast<CellContent>(cells[i]);
+    }
+    PackedBoard b = packBoard(grid);
+    out->lo = b.lo;
+    out->hi = b.hi;
+    return TD_OK;
+}
+
+int td_parse_board(const char* text, size_t length, td_board* out) {
+    if ((!text && length > 0) || !out) return TD_ERROR_ARGUMENT;
+    // Same rules as boardFromText (solver.h), without making a std::string
+    std::array<CellContent, TOTAL_CELLS> grid;
+    int n = 0;
+    for (size_t i = 0; i < length; i++) {
+        char ch = text[i];
+        if (ch == ' ' || ch == '/' || ch == '\t' || ch == '\r' || ch == '\n') continue;
+        CellContent c;
+        if (n >= TOTAL_CELLS || !cellContentFromChar(ch, c)) return TD_ERROR_ARGUMENT;
+        grid[n++] = c;
+    }
+    if (n != TOTAL_CELLS) return TD_ERROR_ARGUMENT;
+    PackedBoard b = packBoard(grid);
+    out->lo = b.lo;
+    out->hi = b.hi;
+    return TD_OK;
+}
+
+td_scratch* td_scratch_create(size_t arena_bytes) {
+    try {
+        return new td_scratch(arena_bytes ? arena_bytes : TD_DEFAULT_ARENA_BYTES);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void td_scratch_destroy(td_scratch* scratch) { delete scratch; }
+
+uint64_t td_scratch_heap_allocations(const td_scratch* scratch) {
+    return scratch ? static_cast<uint64_t>(scratch->heap.total.count) : 0;
+}
+
+int td_solve(td_scratch* scratch, td_board board, double* probs, double* total_ways) {
+    return solveBatch(scratch, &board, 1, probs, 0, total_ways);
+}
+
+int td_solve_f32(td_scratch* scratch, td_board board, float* probs, double* total_ways) {
+    return solveBatch(scratch, &board, 1, probs, 0, total_ways);
+}
+
+int td_solve_batch(td_scratch* scratch, const td_board* boards, size_t count, double* probs, size_t stride,
+                   double* total_ways) {
+    return solveBatch(scratch, boards, count, probs, stride, total_ways);
+}
+
+int td_solve_batch_f32(td_scratch* scratch, const td_board* boards, size_t count, float* probs, size_t stride,
+                       double* total_ways) {
+    return solveBatch(scratch, boards, count, probs, stride, total_ways);
+}
+
+} // extern "C"
@@ -0,0 +1,169 @@
+/*
+=================================================================================================
+FILE: src/thrilldigger.h
+
+DESCRIPTION:
+This file is the C interface of the solver, built as a shared library (libthrilldigger.so on
+Linux, thrilldigger.dll on Windows). It is plain C: no classes, no exceptions, no std:: types,
+so any language that can call a C function (Python ctypes/cffi, C#, Rust, Lua, ...) can use it.
+
+IMPORTANCE:
+Overlay tools and scripts written in other languages need the probabilities of many boards.
+Going through the command line tool or the daemon means formatting and parsing text or
+messages for every board, and linking the C++ headers directly ties them to one compiler's
+C++ ABI. Here a board is two 64-bit integers, and the answers are written straight into an
+array the caller owns (e.g. the memory of a NumPy array), with nothing copied in between.
+
+INTERACTION:
+- Implemented in `src/thrilldigger.cpp` on top of `ThrillDiggerSolver` (solver.h).
+- Built by the `thrilldigger` target of CMakeLists.txt (and by build.bat).
+- The board encoding is the same as PackedBoard (solver.h) and the daemon protocol (daemon.h).
+
+HOW TO USE IT:
+1. Make a board: td_pack_cells() from 40 cell codes, td_parse_board() from text like
+   "..B......R......G.......B...............", or fill in td_board yourself
+   (3 bits per cell: cells 0..20 in `lo`, cells 21..39 in `hi`, cell i = row * 8 + column).
+2. Create a scratch handle with td_scratch_create() and keep it. It holds a solver and all
+   the working memory a solve needs, allocated once, here. A solve that goes through a
+   scratch allocates nothing (td_scratch_heap_allocations() tells if it ever had to).
+3. Call td_solve() / td_solve_f32() (one board) or td_solve_batch() / td_solve_batch_f32()
+   (many boards) with output arrays you own. Passing NULL as the scratch uses one per thread
+   instead: the first call on each thread allocates it (1 MiB arena plus a solver, the same as
+   td_scratch_create(0)), and it is freed when the thread exits. Later calls on that thread
+   allocate nothing.
+4. td_scratch_destroy() when done.
+
+THREADS:
+A scratch handle must be used by one thread at a time. Use one handle per thread to solve
+in parallel; nothing else is shared.
+
+STABILITY:
+Only functions and types are added in later versions; existing ones keep their meaning and
+layout. TD_API_VERSION is the version of this header, td_api_version() the one of the library.
+=================================================================================================
+*/
+
+#ifndef THRILLDIGGER_H
+#define THRILLDIGGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* TD_API marks the exported functions. The library is built with TD_BUILDING_LIBRARY. */
+#if defined(_WIN32)
+#  if defined(TD_BUILDING_LIBRARY)
+#    define TD_API __declspec(dllexport)
+#  else
+#    define TD_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__)
+#  define TD_API __attribute__((visibility("default")))
+#else
+#  define TD_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TD_API_VERSION 1
+
+#define TD_ROWS 5
+#define TD_COLS 8
+#define TD_CELLS 40
+
+/* Cell codes (the same values as CellContent in solver.h) */
+enum {
+    TD_UNDUG = 0,
+    TD_GREEN = 1,  /* 0 bad neighbours */
+    TD_BLUE = 2,   /* 1-2 */
+    TD_RED = 3,    /* 3-4 */
+    TD_SILVER = 4, /* 5-6 */
+    TD_GOLD = 5,   /* 7-8 */
+    TD_RUPOOR = 6, /* Bad item */
+    TD_BOMB = 7    /* Bad item */
+};
+
+/*
+ * Return values. Negative values are errors. TD_ERROR_ARGUMENT is found before anything is
+ * solved, so the outputs are left unchanged. TD_ERROR_OUT_OF_MEMORY in the middle of a batch
+ * leaves the rows of the boards solved before it written (and the rest unchanged).
+ */
+enum {
+    TD_OK = 0,
+    TD_CONTRADICTORY = 1,       /* No hidden layout fits the board: total ways is 0 and the
+                                   probabilities are the solver's fallback guess */
+    TD_ERROR_ARGUMENT = -1,     /* NULL output, bad cell code, unused board bits set, ... */
+    TD_ERROR_OUT_OF_MEMORY = -2 /* No memory for the calling thread's scratch handle, or for a
+                                   solve that needed more than its arena */
+};
+
+/* A whole board in 128 bits: 3 bits per cell, cells 0..20 in lo, 21..39 in hi. */
+typedef struct td_board {
+    uint64_t lo;
+    uint64_t hi;
+} td_board;
+
+/* Opaque: a solver plus its working memory */
+typedef struct td_scratch td_scratch;
+
+/* TD_API_VERSION of the library (compare with the header's to detect a mismatch) */
+TD_API uint32_t td_api_version(void);
+
+/*
+ * Packs 40 cell codes (TD_UNDUG..TD_BOMB, row by row) into a board.
+ * Returns TD_OK, or TD_ERROR_ARGUMENT for a code above TD_BOMB.
+ */
+TD_API int td_pack_cells(const uint8_t* cells, td_board* out);
+
+/*
+ * Reads a board written as 40 cell characters, row by row: '.' or '?' undug, G B R S Y
+ * (gold) P (rupoor) X (bomb), either case. Spaces, tabs, newlines and '/' are skipped.
+ * `length` is the number of characters of `text`. Returns TD_OK or TD_ERROR_ARGUMENT.
+ */
+TD_API int td_parse_board(const char* text, size_t length, td_board* out);
+
+/*
+ * Creates a scratch handle with `arena_bytes` of working memory (0 = the default of 1 MiB,
+ * several times what the hardest known board needs). This is the only function that
+ * allocates. Returns NULL if the memory can't be allocated.
+ */
+TD_API td_scratch* td_scratch_create(size_t arena_bytes);
+
+/* Frees the handle (NULL is allowed) */
+TD_API void td_scratch_destroy(td_scratch* scratch);
+
+/*
+ * How many times solves through this handle needed memory beyond its arena and took it from
+ * the heap (0 when the arena is big enough). The results are right either way.
+ */
+TD_API uint64_t td_scratch_heap_allocations(const td_scratch* scratch);
+
+/*
+ * Solves one board. probs (TD_CELLS values, required) gets the probability that each cell
+ * hides a bad item: 1 for revealed bombs and rupoors, 0 for revealed rupees.
+ * total_ways (optional, may be NULL) gets the number of hidden layouts that fit the board.
+ * scratch may be NULL (see the top of this file).
+ * Returns TD_OK, TD_CONTRADICTORY or an error.
+ */
+TD_API int td_solve(td_scratch* scratch, td_board board, double* probs, double* total_ways);
+TD_API int td_solve_f32(td_scratch* scratch, td_board board, float* probs, double* total_ways);
+
+/*
+ * Solves `count` boards one after the other. The answer of board i goes to
+ * probs[i * stride .. i * stride + TD_CELLS - 1] (stride in values, 0 = TD_CELLS, so the
+ * answers can go straight into rows of a bigger table) and total_ways[i] (optional).
+ * Every board is checked first: one with unused bits set fails the whole call with
+ * TD_ERROR_ARGUMENT and nothing written. Returns TD_OK, TD_CONTRADICTORY if at least one board
+ * was contradictory (see its total_ways), or an error.
+ */
+TD_API int td_solve_batch(td_scratch* scratch, const td_board* boards, size_t count,
+                          double* probs, size_t stride, double* total_ways);
+TD_API int td_solve_batch_f32(td_scratch* scratch, const td_board* boards, size_t count,
+                              float* probs, size_t stride, double* total_ways);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THRILLDIGGER_H */
@@ -0,0 +1,402 @@
+/*
+=================================================================================================
+FILE: src/tournament.h
+
+DESCRIPTION:
+This file contains a tournament harness: it plays several digging strategies against each other
+on thousands of random boards and reports which one collects more rupees, with confidence
+intervals on the differences.
+
+IMPORTANCE:
+Good strategies differ by a fraction of a percent. Measured naively (each strategy on its own
+random boards) the luck of the boards swamps that difference and millions of games are needed.
+Playing every strategy on the *same* boards removes most of the luck from the comparison.
+
+INTERACTION:
+- Includes "boardgen.h" for reproducible random boards.
+- The built-in strategies use `ThrillDiggerSolver`, `ExpectimaxPlanner` and `MctsPlayer`.
+- Used by the `tournament` command of `src/cli.cpp`.
+
+ALGORITHM OVERVIEW:
+1. Common random numbers: game g is board `generateBoard(seed, g)` for every strategy, and any
+   randomness inside a strategy is seeded from (seed, g) too. A run is fully reproducible, and
+   the same regardless of the number of threads (except for the per-move sketches of
+   sketch.h, which are merged per thread and may differ in their last digits).
+2. Games are played in rounds. Inside a round, threads grab game numbers from a shared counter;
+   each thread owns its own strategy objects (solvers are not thread-safe).
+3. Paired differences: for strategies A and B, d_g = rupees_A(g) - rupees_B(g). The mean of d
+   has a much smaller standard error than the two separate means, because board luck cancels.
+4. Early stopping: the data is checked after every round, and a fixed-sample interval checked
+   that often would find a "significant" difference by luck far more often than 5% of the time.
+   So the intervals are asymptotic confidence sequences (Waudby-Smith et al., "Time-uniform
+   central limit theory"): they hold at every round at once, so stopping whenever they exclude
+   zero is valid. Across the pairs the error rate is split evenly (Bonferroni), so with 95% the
+   chance that ANY reported interval misses its true difference is at most 5%. The tournament
+   ends when every pair's interval excludes zero; the intervals printed are the same ones.
+=================================================================================================
+*/
+
+#pragma once
+#include "boardgen.h"
+#include "planner.h"
+#include "mcts.h"
+#include "sketch.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+// =================================================================================================
+// STRATEGIES
+// =================================================================================================
+
+/*
+ * Strategy
+ * --------
+ * A way of playing. choose() returns the cell to dig next, or -1 to stop and keep the haul.
+ * `gameSeed` is different for every game (and the same for every strategy), for strategies
+ * that use random numbers.
+ */
+class Strategy {
+public:
+    virtual ~Strategy() = default;
+    virtual int choose(const std::array<CellContent, TOTAL_CELLS>& grid, uint64_t gameSeed) = 0;
+
+    double lastBadProb = -1.0; // badProb of the last chosen cell, if the strategy knows it (else -1)
+};
+
+// Creates a fresh strategy object (one per thread)
+using StrategyFactory = std::function<std::unique_ptr<Strategy>()>;
+
+// Digs the cell with the lowest badProb (ties: lowest index). Never stops early.
+class SafestStrategy : public Strategy {
+public:
+    int choose(const std::array<CellContent, TOTAL_CELLS>& grid, uint64_t) override {
+        solver.reset();
+        solver.grid = grid;
+        solver.solve();
+        int best = -1;
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            if (grid[i] != CellContent::Undug) continue;
+            if (best < 0 || solver.badProb[i] < solver.badProb[best]) best = i;
+        }
+        lastBadProb = best >= 0 ? solver.badProb[best] : -1.0;
+        return best;
+    }
+
+private:
+    ThrillDiggerSolver solver;
+};
+
+// Digs the planner's best cell for the next `depth` digs; stops when no dig is expected to gain.
+class ExpectimaxStrategy : public Strategy {
+public:
+    explicit ExpectimaxStrategy(int depth) : depth(depth) {}
+
+    int choose(const std::array<CellContent, TOTAL_CELLS>& grid, uint64_t) override {
+        // No time limit: a fixed depth keeps the tournament reproducible
+        int cell = planner.plan(grid, depth, 1000000000).cell;
+        lastBadProb = cell >= 0 ? planner.badProb(grid, cell) : -1.0;
+        return cell;
+    }
+
+private:
+    int depth;
+    ExpectimaxPlanner planner;
+};
+
+/*
+ * InfoGainStrategy
+ * ----------------
+ * Among the cells at most `tolerance` riskier than the safest one, digs the cell whose outcome
+ * is the least predictable (highest entropy): its clue tells the most about its neighbors.
+ */
+class InfoGainStrategy : public Strategy {
+public:
+    explicit InfoGainStrategy(double tolerance) : tolerance(tolerance) {}
+
+    int choose(const std::array<CellContent, TOTAL_CELLS>& grid, uint64_t) override {
+        solver.reset();
+        solver.grid = grid;
+        solver.solve();
+        double minBad = 2.0;
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            if (grid[i] == CellContent::Undug) minBad = std::min(minBad, solver.badProb[i]);
+        }
+
+        int best = -1;
+        double bestEntropy = -1.0;
+        for (int i = 0; i < TOTAL_CELLS; i++) {
+            if (grid[i] != CellContent::Undug || solver.badProb[i] > minBad + tolerance) continue;
+            double entropy = 0.0;
+            for (double p : planner.outcomeDistribution(grid, i)) {
+                if (p > 0.0) entropy -= p * std::log2(p);
+            }
+            if (entropy > bestEntropy) {
+                bestEntropy = entropy;
+                best = i;
+            }
+        }
+        lastBadProb = best >= 0 ? solver.badProb[best] : -1.0;
+        return best;
+    }
+
+private:
+    double tolerance;
+    ThrillDiggerSolver solver;
+    ExpectimaxPlanner planner; // Only used for its cached outcome distributions
+};
+
+// Digs the MCTS player's choice after a fixed number of simulated games; stops when even the
+// best dig loses rupees on average.
+class MctsStrategy : public Strategy {
+public:
+    explicit MctsStrategy(long long iterations) : iterations(iterations) {
+        player.threads = 1; // The tournament already uses every core
+    }
+
+    int choose(const std::array<CellContent, TOTAL_CELLS>& grid, uint64_t gameSeed) override {
+        int dug = 0;
+        for (CellContent c : grid) dug += c != CellContent::Undug;
+        player.seed = mix64(gameSeed + static_cast<uint64_t>(dug));
+        MctsResult r = player.search(grid, 1000000000, iterations);
+        int cell = r.value > 0.0 ? r.cell : -1;
+        lastBadProb = cell >= 0 ? r.badProb[cell] : -1.0;
+        return cell;
+    }
+
+private:
+    long long iterations;
+    MctsPlayer player;
+};
+
+// =================================================================================================
+// GAMES
+// =================================================================================================
+
+// How one game went.
+struct GameRecord {
+    int rupees = 0;       // Final haul
+    int digs = 0;         // Cells dug
+    bool bombed = false;  // Ended on a bomb
+    bool cleared = false; // Dug every safe cell
+};
+
+// Plays `strategy` on the hidden board until it stops, hits a bomb or clears the board.
+// With `stats`, every move (decision time, risk, outcome) and the final haul are recorded.
+inline GameRecord playGame(Strategy& strategy, const BitBoard& hidden, uint64_t gameSeed,
+                           MoveStats* stats = nullptr)
+{
+    GameRecord rec;
+    std::array<CellContent, TOTAL_CELLS> answer = hidden.toGrid();
+    std::array<CellContent, TOTAL_CELLS> grid;
+    grid.fill(CellContent::Undug);
+    int safeLeft = TOTAL_CELLS - TOTAL_BAD;
+
+    while (safeLeft > 0) {
+        strategy.lastBadProb = -1.0;
+        auto start = stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        int cell = strategy.choose(grid, gameSeed);
+        if (stats) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            stats->decideNs.record(static_cast<uint64_t>(ns.count()));
+        }
+        if (cell < 0 || cell >= TOTAL_CELLS || grid[cell] != CellContent::Undug) break;
+        CellContent c = answer[cell];
+        if (stats) {
+            stats->outcomes.record(c);
+            if (strategy.lastBadProb >= 0.0) stats->chosenBadProb.add(strategy.lastBadProb);
+        }
+        grid[cell] = c;
+        rec.digs++;
+        rec.rupees += rupeeValue(c);
+        if (c == CellContent::Bomb) {
+            rec.bombed = true;
+            break;
+        }
+        if (!isRevealedBad(c)) safeLeft--;
+    }
+    rec.cleared = safeLeft == 0;
+    if (stats) stats->gameRupees.add(rec.rupees);
+    return rec;
+}
+
+// =================================================================================================
+// TOURNAMENT
+// =================================================================================================
+
+// Running mean and variance (Welford's method: stable even for long runs)
+struct RunningStats {
+    long long n = 0;
+    double mean = 0.0, m2 = 0.0;
+
+    void add(double x) {
+        n++;
+        double d = x - mean;
+        mean += d / n;
+        m2 += d * (x - mean);
+    }
+    double stdErr() const { return n > 1 ? std::sqrt(m2 / (n - 1) / n) : 0.0; }
+};
+
+// Two-sided normal quantile: the z with P(|Z| < z) = confidence (e.g. 0.95 -> 1.96)
+inline double zForConfidence(double confidence) {
+    double lo = 0.0, hi = 10.0;
+    for (int i = 0; i < 60; i++) {
+        double mid = 0.5 * (lo + hi);
+        if (std::erfc(mid / std::sqrt(2.0)) > 1.0 - confidence) lo = mid;
+        else hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+/*
+ * zForSequence
+ * ------------
+ * Like zForConfidence, but for an interval (mean +/- z * stdErr) that stays valid however many
+ * times it is looked at: with probability `confidence` it covers the true mean after every
+ * number of games at once. This is the asymptotic confidence sequence of Waudby-Smith et al.
+ * with its mixing parameter tuned to be tightest at `tuneGames` games (it is wider than the
+ * fixed-sample interval everywhere; about 1.5x at 95% and `tuneGames` games).
+ */
+inline double zForSequence(double confidence, long long games, long long tuneGames) {
+    if (games < 1) return 0.0;
+    double alpha = 1.0 - confidence;
+    double logA = -2.0 * std::log(alpha);
+    double rho2 = (logA + std::log(logA + 1.0)) / static_cast<double>(std::max(1LL, tuneGames));
+    double nr = static_cast<double>(games) * rho2;
+    return std::sqrt(2.0 * (nr + 1.0) / nr * std::log(std::sqrt(nr + 1.0) / alpha));
+}
+
+struct TournamentConfig {
+    uint64_t seed = 1;
+    long long maxGames = 100000;
+    long long minGames = 500;         // Never stop before this many games
+    long long roundGames = 500;       // Games between significance checks
+    int threads = 0;                  // 0 = one per hardware thread
+    double confidence = 0.95;         // Joint level of all pairs' intervals, valid at every round
+};
+
+// Results of one strategy.
+struct StrategyStats {
+    std::string name;
+    RunningStats rupees;
+    long long bombed = 0, cleared = 0, digs = 0;
+    MoveStats moves; // Per-move sketches (filled in at the end of Tournament::run)
+};
+
+// Paired comparison of strategies a and b (difference = a - b).
+struct PairStats {
+    int a = 0, b = 0;
+    RunningStats diff;
+    double low = 0.0, high = 0.0; // Confidence interval of the mean difference
+    bool significant = false;     // The interval excludes zero
+};
+
+struct TournamentReport {
+    long long games = 0;
+    bool stoppedEarly = false;
+    std::vector<StrategyStats> strategies;
+    std::vector<PairStats> pairs;
+};
+
+class Tournament {
+public:
+    // Called after every round with the results so far
+    std::function<void(const TournamentReport&)> onRound;
+
+    void add(const std::string& name, StrategyFactory factory) {
+        names.push_back(name);
+        factories.push_back(std::move(factory));
+    }
+
+    TournamentReport run(const TournamentConfig& cfg) {
+        TournamentReport report;
+        int numStrategies = (int)factories.size();
+        for (const auto& n : names) {
+            report.strategies.emplace_back();
+            report.strategies.back().name = n;
+        }
+        for (int a = 0; a < numStrategies; a++) {
+            for (int b = a + 1; b < numStrategies; b++) {
+                report.pairs.emplace_back();
+                report.pairs.back().a = a;
+                report.pairs.back().b = b;
+            }
+        }
+        if (numStrategies == 0) return report;
+
+        int numThreads = cfg.threads > 0 ? cfg.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::vector<std::unique_ptr<Strategy>>> players(numThreads);
+        for (auto& p : players) {
+            for (const auto& f : factories) p.push_back(f());
+        }
+        // Each thread fills its own sketches; they are merged once the tournament is over
+        std::vector<std::vector<MoveStats>> threadStats(numThreads, std::vector<MoveStats>(numStrategies));
+
+        // Bonferroni: each pair gets an equal share of the allowed error
+        double pairConfidence = 1.0 - (1.0 - cfg.confidence) / std::max<size_t>(1, report.pairs.size());
+        std::vector<GameRecord> round; // round[game * numStrategies + strategy]
+
+        while (report.games < cfg.maxGames) {
+            long long first = report.games;
+            long long count = std::min(cfg.roundGames, cfg.maxGames - first);
+            round.assign(static_cast<size_t>(count * numStrategies), GameRecord());
+
+            std::atomic<long long> next(0);
+            auto work = [&](int t) {
+                for (long long i; (i = next.fetch_add(1)) < count;) {
+                    uint64_t game = static_cast<uint64_t>(first + i);
+                    BitBoard hidden = generateBoard(cfg.seed, game);
+                    uint64_t gameSeed = mix64(cfg.seed ^ mix64(game));
+                    for (int s = 0; s < numStrategies; s++) {
+                        round[i * numStrategies + s] = playGame(*players[t][s], hidden, gameSeed, &threadStats[t][s]);
+                    }
+                }
+            };
+            std::vector<std::thread> pool;
+            for (int t = 1; t < numThreads; t++) pool.emplace_back(work, t);
+            work(0);
+            for (auto& th : pool) th.join();
+
+            // Merge in game order, so the statistics don't depend on thread timing
+            for (long long i = 0; i < count; i++) {
+                const GameRecord* g = &round[i * numStrategies];
+                for (int s = 0; s < numStrategies; s++) {
+                    StrategyStats& st = report.strategies[s];
+                    st.rupees.add(g[s].rupees);
+                    st.bombed += g[s].bombed;
+                    st.cleared += g[s].cleared;
+                    st.digs += g[s].digs;
+                }
+                for (PairStats& p : report.pairs) p.diff.add(g[p.a].rupees - g[p.b].rupees);
+            }
+            report.games += count;
+
+            bool allSignificant = true;
+            double z = zForSequence(pairConfidence, report.games, cfg.maxGames);
+            for (PairStats& p : report.pairs) {
+                double se = p.diff.stdErr();
+                p.low = p.diff.mean - z * se;
+                p.high = p.diff.mean + z * se;
+                p.significant = se > 0.0 && (p.low > 0.0 || p.high < 0.0);
+                allSignificant = allSignificant && p.significant;
+            }
+            if (onRound) onRound(report);
+            if (report.games >= cfg.minGames && allSignificant && !report.pairs.empty()) {
+                report.stoppedEarly = report.games < cfg.maxGames;
+                break;
+            }
+        }
+
+        for (const auto& perThread : threadStats) {
+            for (int s = 0; s < numStrategies; s++) report.strategies[s].moves.merge(perThread[s]);
+        }
+        return report;
+    }
+
+private:
+    std::vector<std::string> names;
+    std::vector<StrategyFactory> factories;
+};